@@ -0,0 +1,591 @@
+#include <xtb_core/core.h>
+#include <xtb_core/arena.h>
+#include <xtb_core/string.h>
+#include <xtb_core/string_builder.h>
+#include <xtb_json/json.h>
+#include <xtb_json/json_index.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/****************************************************************
+ * Parser checks
+ *
+ * Random documents, valid and corrupted, parsed two ways that
+ * have to agree: the same verdict, failures at the same offset and
+ * successes that write out the same text. Every input is copied to
+ * an allocation of exactly its size, so sanitizer builds catch a
+ * parser reading past the end.
+****************************************************************/
+static u64 g_check_rng = 0x2545F4914F6CDD1Dull;
+
+// xorshift64*, deterministic so a failure reproduces with the same iteration count
+static u64 check_random(void)
+{
+    g_check_rng ^= g_check_rng >> 12;
+    g_check_rng ^= g_check_rng << 25;
+    g_check_rng ^= g_check_rng >> 27;
+    return g_check_rng * 0x2545F4914F6CDD1Dull;
+}
+
+static int check_random_below(int n)
+{
+    return (int)(check_random() % (u64)n);
+}
+
+static void generate_whitespace(StringBuf *doc)
+{
+    int count = check_random_below(4) == 0 ? check_random_below(4) : 0;
+    for (int i = 0; i < count; i += 1)
+    {
+        doc->append((u8)" \t\n\r"[check_random_below(4)]);
+    }
+}
+
+static void generate_string(StringBuf *doc)
+{
+    doc->append('"');
+
+    int length = check_random_below(4) == 0 ? check_random_below(150) : check_random_below(10);
+    for (int i = 0; i < length; i += 1)
+    {
+        switch (check_random_below(12))
+        {
+            case 0: doc->append("\\\\"); break;
+            case 1: doc->append("\\\""); break;
+            case 2: doc->append("\\n"); break;
+            case 3: doc->append("\\u00e9"); break;
+            case 4: doc->append("\xc3\xa9"); break;
+            case 5: doc->append((u8)"{}[],:"[check_random_below(6)]); break;
+            default: doc->append((u8)('a' + check_random_below(26))); break;
+        }
+    }
+
+    doc->append('"');
+}
+
+// Short keys repeat often enough for objects to have duplicates
+static void generate_key(StringBuf *doc)
+{
+    if (check_random_below(3) == 0)
+    {
+        generate_string(doc);
+        return;
+    }
+
+    u8 key[] = { '"', 'k', (u8)('a' + check_random_below(14)), '"' };
+    doc->append(key, sizeof(key));
+}
+
+static void generate_value(StringBuf *doc, int depth)
+{
+    generate_whitespace(doc);
+
+    char buffer[32];
+    switch (depth > 5 ? check_random_below(4) : check_random_below(6))
+    {
+        case 0:
+        {
+            snprintf(buffer, sizeof(buffer), "%d%s", check_random_below(100000) - 50000,
+                     check_random_below(2) ? ".25e1" : "");
+            doc->append(String::from_cstr(buffer));
+        } break;
+
+        case 1:
+        {
+            const char *literals[] = { "true", "false", "null" };
+            doc->append(String::from_cstr(literals[check_random_below(3)]));
+        } break;
+
+        case 2:
+        case 3:
+        {
+            generate_string(doc);
+        } break;
+
+        case 4:
+        {
+            doc->append('[');
+            int count = check_random_below(6);
+            for (int i = 0; i < count; i += 1)
+            {
+                if (i > 0) doc->append(',');
+                generate_value(doc, depth + 1);
+            }
+            generate_whitespace(doc);
+            doc->append(']');
+        } break;
+
+        default:
+        {
+            // Past JSON_OBJECT_INDEX_MIN_KEYS now and then, so lookups go through the index
+            doc->append('{');
+            int count = check_random_below(3) ? check_random_below(10) : check_random_below(40);
+            for (int i = 0; i < count; i += 1)
+            {
+                if (i > 0) doc->append(',');
+                generate_whitespace(doc);
+                generate_key(doc);
+                generate_whitespace(doc);
+                doc->append(':');
+                generate_value(doc, depth + 1);
+            }
+            generate_whitespace(doc);
+            doc->append('}');
+        } break;
+    }
+
+    generate_whitespace(doc);
+}
+
+// Every hundredth document is a long array, every other one gets a few bytes
+// overwritten with JSON punctuation and every seventh is cut short
+static void generate_document(StringBuf *doc, isize iteration)
+{
+    doc->clear();
+
+    if (iteration % 100 == 0)
+    {
+        doc->append('[');
+        int count = 50 + check_random_below(300);
+        for (int i = 0; i < count; i += 1)
+        {
+            if (i > 0) doc->append(',');
+            generate_value(doc, 0);
+        }
+        doc->append(']');
+    }
+    else
+    {
+        generate_value(doc, 0);
+    }
+
+    if (iteration % 2 == 1)
+    {
+        const char *replacements = "{}[]\",:\\ 0aeu-.x\n";
+        int count = 1 + check_random_below(3);
+        for (int i = 0; i < count && doc->size() > 0; i += 1)
+        {
+            (*doc)[check_random_below((int)doc->size())] = (u8)replacements[check_random_below(17)];
+        }
+    }
+
+    if (iteration % 7 == 0 && doc->size() > 0)
+    {
+        doc->resize(check_random_below((int)doc->size()));
+    }
+}
+
+// Copy of `padding` spaces followed by `doc`, in an allocation of exactly that size
+static String check_copy_input(StringBuf *doc, isize padding)
+{
+    isize size = padding + doc->size();
+    u8 *data = (u8 *)malloc(Max(size, (isize)1));
+    memset(data, ' ', padding);
+    MemoryCopy(data + padding, doc->data(), doc->size());
+    return String(data, size);
+}
+
+static String check_write_value(const JsonValue *value, Arena *arena)
+{
+    StringBuilder builder = StringBuilder::init(arena);
+    json_write_value(value, &builder);
+    return builder.flatten(&arena->allocator);
+}
+
+static void check_report(const char *what, StringBuf *doc)
+{
+    printf("%s in:\n%.*s\n", what, (int)doc->size(), (const char *)doc->data());
+}
+
+/****************************************************************
+ * Known documents
+ *
+ * Inputs at the edges of the grammar, each with the verdict every
+ * parser has to reach: plain, indexed (behind JSON_INDEX_MIN_SIZE
+ * spaces, where stage 1 is vectorized) and tape. Accepted ones
+ * also have to parse again once written out.
+****************************************************************/
+struct KnownDocument
+{
+    const char *text;
+    bool valid;
+};
+
+static const KnownDocument known_documents[] = {
+    { "0", true }, { "-0", true }, { "10", true }, { "-12.5", true }, { "0.5e-3", true },
+    { "1E+2", true }, { "[1e308, -1e-400]", true }, { "1.7976931348623157e308", true },
+    { "01", false }, { "-01", false }, { "+1", false }, { ".5", false }, { "1.", false },
+    { "-", false }, { "-.5", false }, { "1e", false }, { "1e+", false }, { "1.e5", false },
+    { "1-2", false }, { "0x10", false }, { "[1,01]", false }, { "{\"a\":1.}", false },
+    { "1e999", false }, { "-1e999", false }, { "[1.8e308]", false },
+    { "Infinity", false }, { "-Infinity", false }, { "NaN", false },
+    { "[\"a\tb\"]", false }, { "\"a\\u0000b\"", true },
+};
+
+static bool check_known_verdict(const char *parser, const KnownDocument *known, bool parsed, JsonParseError *error)
+{
+    if (parsed == known->valid) return true;
+
+    printf("%s: \"%s\" should %s, got %s\n", parser, known->text, known->valid ? "parse" : "fail",
+           parsed ? "a value" : error->message);
+    return false;
+}
+
+static int check_known_documents(void)
+{
+    StringBuf doc = StringBuf::init(allocator_get_heap());
+    int failures = 0;
+
+    for (const KnownDocument& known : known_documents)
+    {
+        doc.clear();
+        doc.append(String::from_cstr(known.text));
+
+        String input = check_copy_input(&doc, 0);
+        String padded_input = check_copy_input(&doc, JSON_INDEX_MIN_SIZE);
+        Arena *arena = arena_new(Kilobytes(16));
+
+        JsonParseError error = {};
+        JsonValue *value = json_parse(input, arena, 0, &error);
+        failures += !check_known_verdict("plain", &known, value != NULL, &error);
+
+        if (json_index_is_vectorized())
+        {
+            JsonValue *indexed = json_parse(padded_input, arena, 0, &error);
+            failures += !check_known_verdict("indexed", &known, indexed != NULL, &error);
+        }
+
+        JsonTape *tape = json_tape_parse(input, arena, &error);
+        failures += !check_known_verdict("tape", &known, tape != NULL, &error);
+
+        if (value != NULL)
+        {
+            String written = check_write_value(value, arena);
+            if (json_parse(written, arena, 0, &error) == NULL)
+            {
+                printf("\"%s\" was written as \"%.*s\", which doesn't parse: %s\n",
+                       known.text, (int)written.len(), (const char *)written.data(), error.message);
+                failures += 1;
+            }
+        }
+
+        arena_release(arena);
+        free(input.data());
+        free(padded_input.data());
+    }
+
+    doc.deinit();
+
+    printf("known documents: %lli, %d mismatches\n", (lli)(sizeof(known_documents) / sizeof(known_documents[0])), failures);
+    return failures;
+}
+
+/****************************************************************
+ * Indexed vs plain parser
+ *
+ * json_parse indexes inputs of JSON_INDEX_MIN_SIZE bytes or more,
+ * so each document is parsed as is and again behind that many
+ * spaces, which moves every offset by the same amount. Only on
+ * machines with a vectorized stage 1, the scalar one is never used
+ * for parsing.
+****************************************************************/
+static int check_indexed_parser(isize iterations)
+{
+    if (!json_index_is_vectorized())
+    {
+        printf("indexed: skipped, the %s backend is never used\n", json_index_backend());
+        return 0;
+    }
+
+    StringBuf doc = StringBuf::init(allocator_get_heap());
+    isize parsed = 0;
+    isize rejected = 0;
+    isize skipped = 0;
+    int failures = check_known_documents();
+
+    for (isize iteration = 0; iteration < iterations && failures == 0; iteration += 1)
+    {
+        generate_document(&doc, iteration);
+        if (doc.size() >= JSON_INDEX_MIN_SIZE)
+        {
+            // Would be indexed both times
+            skipped += 1;
+            continue;
+        }
+
+        String plain_input = check_copy_input(&doc, 0);
+        String indexed_input = check_copy_input(&doc, JSON_INDEX_MIN_SIZE);
+        Arena *arena = arena_new(Kilobytes(16));
+
+        JsonParseError plain_error = {};
+        JsonParseError indexed_error = {};
+        JsonValue *plain = json_parse(plain_input, arena, 0, &plain_error);
+        JsonValue *indexed = json_parse(indexed_input, arena, 0, &indexed_error);
+
+        if ((plain == NULL) != (indexed == NULL)
+            || (plain == NULL && plain_error.offset + JSON_INDEX_MIN_SIZE != indexed_error.offset))
+        {
+            printf("plain: %s at %lli, indexed: %s at %lli\n",
+                   plain ? "ok" : plain_error.message, (lli)plain_error.offset,
+                   indexed ? "ok" : indexed_error.message, (lli)(indexed_error.offset - JSON_INDEX_MIN_SIZE));
+            check_report("Verdicts differ", &doc);
+            failures += 1;
+        }
+        else if (plain != NULL)
+        {
+            if (!(check_write_value(plain, arena) == check_write_value(indexed, arena)))
+            {
+                check_report("Documents differ", &doc);
+                failures += 1;
+            }
+            parsed += 1;
+        }
+        else
+        {
+            // The indexed parser checks what follows a number or literal right away,
+            // the plain one leaves that to whatever expects a separator next
+            if (strcmp(plain_error.message, indexed_error.message) != 0
+                && strcmp(indexed_error.message, "unexpected character after value") != 0)
+            {
+                printf("plain: %s, indexed: %s\n", plain_error.message, indexed_error.message);
+                check_report("Messages differ", &doc);
+                failures += 1;
+            }
+            rejected += 1;
+        }
+
+        arena_release(arena);
+        free(plain_input.data());
+        free(indexed_input.data());
+    }
+
+    doc.deinit();
+
+    printf("indexed: %lli parsed, %lli rejected, %lli too big, %d mismatches\n",
+           (lli)parsed, (lli)rejected, (lli)skipped, failures);
+    return failures;
+}
+
+/****************************************************************
+ * Tape vs tree
+ *
+ * Each document goes through json_parse and json_tape_parse. Both
+ * have to fail at the same place, and a tape has to hold the same
+ * document as the tree: written out, walked value by value, looked
+ * up by every key and index, and every path json_query can spell
+ * has to lead to the same value in both.
+****************************************************************/
+struct TapeCheck
+{
+    Arena *arena;
+    StringBuf *doc;
+    // json_query path to the value being walked, NUL terminated by check_tape_query
+    StringBuf path;
+    isize lookups;
+    isize queries;
+    int failures;
+};
+
+static String check_write_cursor(JsonCursor cursor, Arena *arena)
+{
+    StringBuilder builder = StringBuilder::init(arena);
+    json_write_cursor(cursor, &builder);
+    return builder.flatten(&arena->allocator);
+}
+
+static bool check_same_value(TapeCheck *check, const JsonValue *value, JsonCursor cursor)
+{
+    return value != NULL && json_cursor_is_valid(cursor)
+        && check_write_value(value, check->arena) == check_write_cursor(cursor, check->arena);
+}
+
+static void check_tape_fail(TapeCheck *check, const char *what)
+{
+    if (check->failures == 0)
+    {
+        printf("%s at \"%.*s\"\n", what, (int)check->path.size(), (const char *)check->path.data());
+        check_report("Tape differs", check->doc);
+    }
+    check->failures += 1;
+}
+
+// The query has to land on the value being walked, in the tree and in the tape
+static void check_tape_query(TapeCheck *check, const JsonValue *root, JsonCursor root_cursor,
+                             const JsonValue *value, JsonCursor cursor)
+{
+    isize path_size = check->path.size();
+    check->path.append('\0');
+
+    const char *query = (const char *)check->path.data();
+    JsonCursor found_cursor = json_cursor_query(root_cursor, query);
+    if (json_query((JsonValue *)root, query) != value || !json_cursor_is_valid(found_cursor)
+        || found_cursor.entry != cursor.entry)
+    {
+        check_tape_fail(check, "Query differs");
+    }
+    check->queries += 1;
+
+    check->path.resize(path_size);
+}
+
+// `queryable` is false below a key json_query can't spell or that an earlier equal
+// key shadows
+static void check_tape_walk(TapeCheck *check, const JsonValue *root, JsonCursor root_cursor,
+                            const JsonValue *value, JsonCursor cursor, bool queryable)
+{
+    if (!json_cursor_is_valid(cursor) || json_cursor_type(cursor) != value->type)
+    {
+        check_tape_fail(check, "Type differs");
+        return;
+    }
+
+    if (queryable) check_tape_query(check, root, root_cursor, value, cursor);
+
+    isize path_size = check->path.size();
+    char buffer[32];
+
+    if (value->type != JSON_ARRAY && value->type != JSON_OBJECT)
+    {
+        if (!check_same_value(check, value, cursor)) check_tape_fail(check, "Value differs");
+    }
+    else if (value->type == JSON_ARRAY)
+    {
+        size_t length = json_array_get_length(value);
+        if (json_cursor_array_get_length(cursor) != length) check_tape_fail(check, "Length differs");
+        if (json_cursor_is_valid(json_cursor_array_get_index(cursor, length))) check_tape_fail(check, "Index past the end");
+        if (json_cursor_is_valid(json_cursor_object_get_key(cursor, "ka"))) check_tape_fail(check, "Key in an array");
+
+        for (size_t i = 0; i < length && check->failures == 0; i += 1)
+        {
+            snprintf(buffer, sizeof(buffer), "[%zu]", i);
+            check->path.append(String::from_cstr(buffer));
+            check_tape_walk(check, root, root_cursor, json_array_get_index((JsonValue *)value, i),
+                            json_cursor_array_get_index(cursor, i), queryable);
+            check->path.resize(path_size);
+        }
+    }
+    else if (value->type == JSON_OBJECT)
+    {
+        if (json_cursor_object_get_num_keys(cursor) != json_object_get_num_keys(value))
+        {
+            check_tape_fail(check, "Key count differs");
+        }
+        if (json_cursor_is_valid(json_cursor_array_get_index(cursor, 0))) check_tape_fail(check, "Index in an object");
+
+        size_t i = 0;
+        for (JsonPair *pair = value->as.object.first; pair != NULL && check->failures == 0; pair = pair->next, i += 1)
+        {
+            if (!(json_cursor_object_key_at(cursor, i) == pair->key)) check_tape_fail(check, "Key differs");
+
+            // The first of several equal keys wins in both, containers compare by entry
+            // since walking them compares their content
+            JsonValue *found = json_object_get_key_lt((JsonValue *)value, (const char *)pair->key.data(), (int)pair->key.len());
+            JsonCursor found_cursor = json_cursor_object_get_key(cursor, pair->key);
+            bool same = found == pair->value
+                ? json_cursor_is_valid(found_cursor) && found_cursor.entry == json_cursor_object_value_at(cursor, i).entry
+                : check_same_value(check, found, found_cursor);
+            if (!same) check_tape_fail(check, "Lookup differs");
+            check->lookups += 1;
+
+            bool key_queryable = queryable && found == pair->value
+                && memchr(pair->key.data(), '"', pair->key.len()) == NULL
+                && memchr(pair->key.data(), '\0', pair->key.len()) == NULL;
+
+            check->path.append(String("[\""));
+            check->path.append(pair->key);
+            check->path.append(String("\"]"));
+            check_tape_walk(check, root, root_cursor, pair->value, json_cursor_object_value_at(cursor, i), key_queryable);
+            check->path.resize(path_size);
+        }
+
+        // Keys the generator uses, the ones that are present were looked up above
+        for (char letter = 'a'; letter < 'a' + 14; letter += 1)
+        {
+            char key[] = { 'k', letter, '\0' };
+            bool in_tree = json_object_get_key((JsonValue *)value, key) != NULL;
+            if (in_tree != json_cursor_is_valid(json_cursor_object_get_key(cursor, key)))
+            {
+                check_tape_fail(check, "Lookup differs");
+            }
+        }
+    }
+}
+
+static int check_tape(isize iterations)
+{
+    StringBuf doc = StringBuf::init(allocator_get_heap());
+
+    TapeCheck check = {};
+    check.failures = check_known_documents();
+    check.doc = &doc;
+    check.path = StringBuf::init(allocator_get_heap());
+
+    isize parsed = 0;
+    isize rejected = 0;
+
+    for (isize iteration = 0; iteration < iterations && check.failures == 0; iteration += 1)
+    {
+        generate_document(&doc, iteration);
+
+        String input = check_copy_input(&doc, 0);
+        check.arena = arena_new(Kilobytes(16));
+
+        JsonParseError tree_error = {};
+        JsonParseError tape_error = {};
+        JsonValue *tree = json_parse(input, check.arena, 0, &tree_error);
+        JsonTape *tape = json_tape_parse(input, allocator_get_heap(), &tape_error);
+
+        if ((tree == NULL) != (tape == NULL)
+            || (tree == NULL && (tree_error.offset != tape_error.offset
+                                 || tree_error.line != tape_error.line || tree_error.column != tape_error.column)))
+        {
+            printf("tree: %s at %lli, tape: %s at %lli\n",
+                   tree ? "ok" : tree_error.message, (lli)tree_error.offset,
+                   tape ? "ok" : tape_error.message, (lli)tape_error.offset);
+            check_report("Verdicts differ", &doc);
+            check.failures += 1;
+        }
+        else if (tree != NULL)
+        {
+            // Neither may point into the input
+            memset(input.data(), 'X', input.len());
+
+            JsonCursor root = json_tape_root(tape);
+            if (!check_same_value(&check, tree, root)) check_tape_fail(&check, "Document differs");
+
+            check.path.clear();
+            check_tape_walk(&check, tree, root, tree, root, true);
+
+            if (json_cursor_is_valid(json_cursor_query(root, "[9999].zz[\"q\"]")))
+            {
+                check_tape_fail(&check, "Missing path found");
+            }
+            parsed += 1;
+        }
+        else
+        {
+            // Same exception as the indexed parser, which the tape uses on big inputs
+            if (strcmp(tree_error.message, tape_error.message) != 0
+                && strcmp(tape_error.message, "unexpected character after value") != 0)
+            {
+                printf("tree: %s, tape: %s\n", tree_error.message, tape_error.message);
+                check_report("Messages differ", &doc);
+                check.failures += 1;
+            }
+            rejected += 1;
+        }
+
+        if (tape != NULL) json_tape_free(tape, allocator_get_heap());
+        arena_release(check.arena);
+        free(input.data());
+    }
+
+    check.path.deinit();
+    doc.deinit();
+
+    printf("tape: %lli parsed, %lli rejected, %lli lookups, %lli queries, %d mismatches\n",
+           (lli)parsed, (lli)rejected, (lli)check.lookups, (lli)check.queries, check.failures);
+    return check.failures;
+}
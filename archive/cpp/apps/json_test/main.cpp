@@ -11,12 +11,28 @@
 
 using namespace xtb;
 
+#include "check_parsers.cpp"
+
 int main(int argc, char **argv)
 {
     xtb::init(argc, argv);
 
     ThreadContextScope tctx;
 
+    // json_test --check-indexed [iterations]
+    if (argc >= 2 && strcmp(argv[1], "--check-indexed") == 0)
+    {
+        isize iterations = argc >= 3 ? atoll(argv[2]) : 5000;
+        return check_indexed_parser(iterations) == 0 ? 0 : 1;
+    }
+
+    // json_test --check-tape [iterations]
+    if (argc >= 2 && strcmp(argv[1], "--check-tape") == 0)
+    {
+        isize iterations = argc >= 3 ? atoll(argv[2]) : 2000;
+        return check_tape(iterations) == 0 ? 0 : 1;
+    }
+
     if (argc > 2)
     {
         fprintf(stderr, "Usage: %s <file>\n", argv[0]);
@@ -0,0 +1,195 @@
+#include <xtb_core/core.h>
+#include <xtb_core/parse_number.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/****************************************************************
+ * Number parsing check
+ *
+ * parse_number.h against libc's strtod/strtoll/strtoull in the
+ * "C" locale: the same value, bit for bit, the same length
+ * consumed and the same out of range verdict. Inputs are fixed
+ * edge cases plus random ones, shortest round-trip doubles,
+ * long mantissas, exact halfway points and subnormals.
+****************************************************************/
+static u64 g_check_rng = 0x9E3779B97F4A7C15ull;
+
+// xorshift64*, deterministic so a failure reproduces with the same iteration count
+static u64 check_random(void)
+{
+    g_check_rng ^= g_check_rng >> 12;
+    g_check_rng ^= g_check_rng << 25;
+    g_check_rng ^= g_check_rng >> 27;
+    return g_check_rng * 0x2545F4914F6CDD1Dull;
+}
+
+static int check_random_below(int n)
+{
+    return (int)(check_random() % (u64)n);
+}
+
+static bool check_f64(const char *input)
+{
+    char *end;
+    f64 expected = strtod(input, &end);
+
+    f64 value;
+    isize length;
+    ParseNumberStatus status = parse_f64_prefix((const u8 *)input, (isize)strlen(input), &value, &length);
+
+    bool same_value = (isnan(expected) && isnan(value)) || memcmp(&expected, &value, sizeof(f64)) == 0;
+    if (!same_value || length != end - input || (status == PARSE_NUMBER_INVALID) != (end == input))
+    {
+        printf("f64 \"%s\": expected %.17g (%lli bytes), got %.17g (%lli bytes)\n",
+               input, expected, (lli)(end - input), value, (lli)length);
+        return false;
+    }
+    return true;
+}
+
+static bool check_integer(const char *input, isize size)
+{
+    char *end;
+    errno = 0;
+    long long expected = strtoll(input, &end, 10);
+    bool out_of_range = errno == ERANGE;
+
+    i64 value;
+    isize length;
+    ParseNumberStatus status = parse_i64_prefix((const u8 *)input, size, &value, &length);
+    if (value != expected || length != end - input || out_of_range != (status == PARSE_NUMBER_OUT_OF_RANGE))
+    {
+        printf("i64 \"%s\": expected %lld, got %lld\n", input, expected, (long long)value);
+        return false;
+    }
+
+    if (input[0] == '-') return true;
+
+    errno = 0;
+    unsigned long long expected_unsigned = strtoull(input, &end, 10);
+    out_of_range = errno == ERANGE;
+
+    u64 unsigned_value;
+    status = parse_u64_prefix((const u8 *)input, size, &unsigned_value, &length);
+    if (unsigned_value != expected_unsigned || length != end - input
+        || out_of_range != (status == PARSE_NUMBER_OUT_OF_RANGE))
+    {
+        printf("u64 \"%s\": expected %llu, got %llu\n", input, expected_unsigned, (unsigned long long)unsigned_value);
+        return false;
+    }
+    return true;
+}
+
+// Random double in one of several textual shapes
+static void generate_f64(char *buffer, isize size, int shape)
+{
+    u64 bits = check_random();
+    f64 number;
+    memcpy(&number, &bits, sizeof(f64));
+    if (isnan(number) || isinf(number)) number = 1.0;
+
+    switch (shape)
+    {
+        case 0:
+        {
+            snprintf(buffer, size, "%.17g", number);
+        } break;
+
+        case 1:
+        {
+            snprintf(buffer, size, "%.*e", check_random_below(25), number);
+        } break;
+
+        case 2:
+        {
+            f64 fraction = (f64)check_random_below(1000000) / (f64)(1 + check_random_below(10000));
+            snprintf(buffer, size, "%.*f", check_random_below(20), fraction);
+        } break;
+
+        case 3:
+        {
+            // Up to 40 integer digits and 30 fraction digits, past what Eisel-Lemire decides alone
+            isize at = 0;
+            int digits = 1 + check_random_below(40);
+            for (int i = 0; i < digits; i += 1) buffer[at++] = '0' + check_random_below(10);
+            if (check_random_below(2))
+            {
+                buffer[at++] = '.';
+                int fraction_digits = check_random_below(30);
+                for (int i = 0; i < fraction_digits; i += 1) buffer[at++] = '0' + check_random_below(10);
+            }
+            snprintf(buffer + at, size - at, "e%d", check_random_below(700) - 350);
+        } break;
+
+        case 4:
+        {
+            // Exactly halfway between two neighbouring doubles
+            f64 low = ldexp((f64)(check_random() >> 11), check_random_below(200) - 100);
+            f64 high = nextafter(low, INFINITY);
+            long double halfway = ((long double)low + (long double)high) / 2;
+            snprintf(buffer, size, "%.40Le", halfway);
+        } break;
+
+        default:
+        {
+            f64 subnormal = ldexp((f64)(check_random() >> 12), -1074 - check_random_below(10));
+            snprintf(buffer, size, "%.*e", check_random_below(30), subnormal);
+        } break;
+    }
+}
+
+// Returns the number of mismatches, 0 when parse_number.h agrees with libc throughout
+static int check_numbers(isize iterations)
+{
+    const char *edge_cases[] = {
+        "0", "-0", "1", "1.", ".5", "-.5e-3", "1e", "1e+", "1e-x", "e5", ".", "-", "+1.5",
+        "inf", "-Infinity", "nan", "NaN", "infin",
+        "1.7976931348623157e308", "1.7976931348623159e308", "1e309",
+        "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324",
+        "2.2250738585072011e-308", "2.2250738585072014e-308", "1e-400",
+        "9007199254740993", "9007199254740992.5", "0.000000000000000000000000000001",
+        "123456789012345678901234567890",
+        "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124",
+        "1.00000000000000011102230246251565404236316680908203126",
+        "7.2057594037927933e16", "00000000000000000000000000000001.5",
+        "3.14159 rest", "12abc", "1e99999999999",
+    };
+
+    int failures = 0;
+    for (const char *input : edge_cases)
+    {
+        failures += !check_f64(input);
+    }
+
+    char buffer[512];
+    for (isize i = 0; i < iterations; i += 1)
+    {
+        generate_f64(buffer, sizeof(buffer), (int)(i % 6));
+        failures += !check_f64(buffer);
+
+        // Signed, unsigned, overflowing and followed by junk
+        isize at = 0;
+        int sign = check_random_below(3);
+        if (sign == 1) buffer[at++] = '-';
+        if (sign == 2) buffer[at++] = '+';
+        int digits = 1 + check_random_below(22);
+        for (int d = 0; d < digits; d += 1) buffer[at++] = '0' + check_random_below(10);
+        if (check_random_below(5) == 0) buffer[at++] = 'x';
+        buffer[at] = '\0';
+        failures += !check_integer(buffer, at);
+
+        if (failures >= 20)
+        {
+            printf("Stopping after %d mismatches\n", failures);
+            break;
+        }
+    }
+
+    printf("numbers: %lli random inputs, %d mismatches\n", (lli)iterations, failures);
+    return failures;
+}
@@ -13,6 +13,9 @@ using namespace xtb;
 #include <iostream>
 
 #include <stdio.h>
+#include <string.h>
+
+#include "check_numbers.cpp"
 
 int main(int argc, char **argv)
 {
@@ -20,6 +23,13 @@ int main(int argc, char **argv)
 
     ThreadContextScope tctx;
 
+    // str_test --check-numbers [iterations]
+    if (argc >= 2 && strcmp(argv[1], "--check-numbers") == 0)
+    {
+        isize iterations = argc >= 3 ? atoll(argv[2]) : 200000;
+        return check_numbers(iterations) == 0 ? 0 : 1;
+    }
+
     Arena *arena = arena_new(Kilobytes(4));
 
     String string = "hello";
@@ -14,14 +14,20 @@ namespace xtb
 /****************************
  * Utility macros
  ***************************/
-#define push_array(arena, type, count) (type *)arena_alloc((arena), sizeof(type) * (count))
+#define push_array(arena, type, count) (type *)arena_alloc_aligned((arena), sizeof(type) * (count), alignof(type))
 #define push_struct(arena, type) push_array((arena), type, 1)
 
-#define push_array_zero(arena, type, count) (type *)arena_alloc_zero((arena), sizeof(type) * (count))
+#define push_array_zero(arena, type, count) (type *)arena_alloc_aligned_zero((arena), sizeof(type) * (count), alignof(type))
 #define push_struct_zero(arena, type) push_array_zero((arena), type, 1)
 
 #define ARENA_BOOTSTRAP_OVERHEAD (sizeof(Arena) + sizeof(ArenaChunkHeader))
 
+// Alignment the arena's Allocator uses when a caller passes none
+#define ARENA_DEFAULT_ALIGNMENT (alignof(max_align_t))
+
+// Virtual arenas commit their reserved range in steps of this size
+#define ARENA_VIRTUAL_COMMIT_GRANULARITY Kilobytes(64)
+
 /****************************
  * Arena API
  ***************************/
@@ -32,24 +38,70 @@ struct ArenaChunkHeader
     ArenaChunkHeader *next;
 };
 
+enum ArenaBackend
+{
+    // Chain of malloc'd chunks, grows without bound
+    ARENA_BACKEND_MALLOC = 0,
+    // Single reserved address range with pages committed on demand, nothing in
+    // it ever moves. Once it's used up the arena carries on into malloc'd chunks
+    // of ARENA_VIRTUAL_COMMIT_GRANULARITY or more, like the malloc backend
+    ARENA_BACKEND_VIRTUAL,
+};
+
 struct Arena
 {
     Allocator allocator;
     ArenaChunkHeader *base_chunk;
     ArenaChunkHeader *current_chunk;
     size_t base_size;
+
+    // Bytes skipped to satisfy alignment, included in the chunk offsets
+    size_t padding;
+
+    ArenaBackend backend;
+
+    // ARENA_BACKEND_VIRTUAL only, measured from the start of the reservation
+    size_t reserved_size;
+    size_t committed_size;
+    // When non-zero, rewinding the arena gives committed pages more than
+    // this many bytes past the new offset back to the OS
+    size_t decommit_threshold;
+
+    // Telemetry, read through `arena_get_stats`
+    const char *name;
+    // Sum of the chunk offsets up to the current chunk, padding included
+    size_t used_size;
+    size_t peak_used_size;
+    i64 allocation_count;
+    i64 chunk_allocation_count;
+    i64 temp_release_chunk_free_count;
+
+    // Links in the process-wide arena registry
+    Arena *registry_prev;
+    Arena *registry_next;
 };
 
 Arena *arena_new(size_t buffer_size);
 Arena *arena_new_exact_size(size_t arena_size);
+// Returns NULL if the range can't be reserved. Where there's no virtual memory API
+// it's a malloc arena with ARENA_VIRTUAL_COMMIT_GRANULARITY chunks instead
+Arena *arena_new_virtual(size_t reserve_size, size_t decommit_threshold = 0);
 void arena_release(Arena *arena);
 bool arena_chunk_has_enough_capacity(ArenaChunkHeader *chunk, size_t allocation_size);
 
-// TODO: deal with alignment
+// Byte aligned, typed memory goes through push_array/push_struct or the _aligned versions
 void *arena_alloc(Arena *arena, size_t allocation_size);
 void *arena_alloc_zero(Arena *arena, size_t allocation_size);
+void *arena_alloc_aligned(Arena *arena, size_t allocation_size, size_t alignment);
+void *arena_alloc_aligned_zero(Arena *arena, size_t allocation_size, size_t alignment);
 void arena_clear(Arena *arena);
 
+// True when `ptr` is the most recent allocation of `size` bytes and nothing sits after it
+bool arena_is_last_allocation(Arena *arena, void *ptr, size_t size);
+// Moves the end of the most recent allocation, returns false if `ptr` isn't
+// that allocation or its chunk can't fit the growth
+bool arena_resize_in_place(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
 /****************************
  * Temporary Arena API
  ***************************/
@@ -57,6 +109,8 @@ struct TempArenaSnapshot
 {
     ArenaChunkHeader *chunk;
     size_t offset;
+    size_t padding;
+    size_t used_size;
 };
 
 struct TempArena
@@ -72,8 +126,60 @@ void temp_arena_release(TempArena temp);
  * Memory Usage Utilities
  ***************************/
 size_t arena_dump_memory_usage(Arena *arena);
+size_t arena_dump_padding_usage(Arena *arena);
 size_t arena_dump_memory_usage_pp(Arena *arena, char *buffer, size_t buffer_size);
 
+/****************************
+ * Arena Statistics
+ ***************************/
+struct ArenaStats
+{
+    const char *name;
+    ArenaBackend backend;
+    isize chunk_count;
+
+    // Bytes taken from the system: malloc'd chunks or committed pages
+    size_t committed_size;
+    size_t used_size;
+    size_t padding_size;
+    // Capacity left behind in chunks the arena moved past because an allocation didn't fit
+    size_t wasted_tail_size;
+    size_t largest_wasted_tail_size;
+    size_t peak_used_size;
+
+    i64 allocation_count;
+    i64 chunk_allocation_count;
+    // Chunks freed by `temp_arena_release`, grows when an arena thrashes
+    i64 temp_release_chunk_free_count;
+};
+
+struct ArenaChunkStats
+{
+    // Committed bytes only, for a virtual arena's reservation
+    size_t capacity;
+    size_t used_size;
+    // Non-zero only for chunks the arena has moved past
+    size_t wasted_tail_size;
+    bool is_current;
+};
+
+using ArenaVisitor = void(*)(Arena *arena, void *user_data);
+using ArenaChunkVisitor = void(*)(const ArenaChunkStats *chunk, void *user_data);
+
+// Label shown in telemetry, `name` must outlive the arena
+void arena_set_name(Arena *arena, const char *name);
+ArenaStats arena_get_stats(Arena *arena);
+// Visits the chunks from the base chunk onwards
+void arena_for_each_chunk(Arena *arena, ArenaChunkVisitor visitor, void *user_data);
+// Starts a new measurement window: peak drops to the current usage, counters to zero
+void arena_reset_stats(Arena *arena);
+
+// Every live arena is registered on creation. Walking the registry reads other
+// threads' arenas without synchronizing with them, so only do it while their
+// owners are not allocating (between frames, after joining workers, ...).
+void arena_registry_for_each(ArenaVisitor visitor, void *user_data);
+void arena_registry_dump(void);
+
 }
 
 #endif // _XTB_ALLOCATOR_ARENA_H_
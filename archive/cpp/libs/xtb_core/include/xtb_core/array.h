@@ -10,6 +10,8 @@
 #include <initializer_list>
 #include <algorithm>
 #include <stdio.h>
+#include <string.h>
+#include <type_traits>
 #include <utility>
 
 namespace xtb
@@ -73,7 +75,8 @@ auto enumerate(const R& range)
     return EnumerateRange<const R&>{ range };
 }
 
-// TODO: Make an OwningArray Array variant that calls destructors
+// Elements are assigned, never constructed or destroyed. See OwningArray for
+// element types that need their constructors and destructors run.
 template <typename T>
 struct Array
 {
@@ -88,10 +91,7 @@ struct Array
     explicit Array(Allocator *allocator, const T *pointer, isize size)
         : Array(allocator, size)
     {
-        for (isize i = 0; i < size; ++i)
-        {
-            this->append_assume_capacity(pointer[i]);
-        }
+        this->append_assume_capacity(pointer, size);
     }
 
     static Array<T> init(Allocator *allocator)
@@ -112,8 +112,7 @@ struct Array
     Array(std::initializer_list<T> ilist) : m_allocator(allocator_get_heap())
     {
         this->ensure_capacity(ilist.size());
-        std::copy(ilist.begin(), ilist.end(), m_data);
-        m_size = ilist.size();
+        this->append_assume_capacity(ilist);
     }
 
     static Array<T> init_with_size(Allocator *allocator, isize size)
@@ -136,9 +135,20 @@ struct Array
     void resize(isize size)
     {
         this->reserve(size);
-        for (isize i = m_size; i < size; ++i)
+        if constexpr (std::is_trivial_v<T>)
         {
-            m_data[i] = T{};
+            // Value-initializing a trivial type zeroes it
+            if (size > m_size)
+            {
+                memset((void*)(m_data + m_size), 0, (size - m_size) * sizeof(T));
+            }
+        }
+        else
+        {
+            for (isize i = m_size; i < size; ++i)
+            {
+                m_data[i] = T{};
+            }
         }
         m_size = size;
     }
@@ -170,19 +180,26 @@ struct Array
     void append_assume_capacity(const T* pointer, isize size)
     {
         Assert(m_size + size <= m_capacity);
-        for (isize i = 0; i < size; ++i)
+        if constexpr (std::is_trivially_copyable_v<T>)
         {
-            this->append_assume_capacity(pointer[i]);
+            if (size > 0)
+            {
+                memcpy((void*)(m_data + m_size), pointer, size * sizeof(T));
+            }
         }
+        else
+        {
+            for (isize i = 0; i < size; ++i)
+            {
+                m_data[m_size + i] = pointer[i];
+            }
+        }
+        m_size += size;
     }
 
     void append_assume_capacity(std::initializer_list<T> ilist)
     {
-        Assert(m_size + (isize)ilist.size() <= m_capacity);
-        for (const T& item : ilist)
-        {
-            m_data[m_size++] = item;
-        }
+        this->append_assume_capacity(ilist.begin(), (isize)ilist.size());
     }
 
     isize size() const { return m_size; }
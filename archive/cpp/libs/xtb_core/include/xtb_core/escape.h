@@ -0,0 +1,65 @@
+#ifndef _XTB_ESCAPE_H_
+#define _XTB_ESCAPE_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/string.h>
+#include <xtb_core/string_builder.h>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Escaping
+ *
+ * Turns arbitrary bytes into the body of a string literal, without
+ * the surrounding quotes. Runs of bytes that don't need escaping
+ * are found 16 at a time and copied in bulk, each byte that does
+ * is looked up in a per-dialect table.
+ *
+ * ESCAPE_C     \a \b \e \f \n \r \t \v \\ \' \" \? and three digit
+ *              octal (\001) for the other control characters and DEL
+ * ESCAPE_JSON  \" \\ \b \f \n \r \t and \u00XX for the other control
+ *              characters, as RFC 8259 requires
+ *
+ * Bytes from 0x80 up are copied as they are in both dialects.
+****************************************************************/
+enum EscapeDialect : u8
+{
+    ESCAPE_C,
+    ESCAPE_JSON,
+};
+
+// Exact number of bytes escape_to writes for `string`
+isize escape_size(String string, EscapeDialect dialect);
+
+// `out` has to hold escape_size(string) bytes, returns how many were written
+isize escape_to(u8 *out, String string, EscapeDialect dialect);
+
+// One allocation of the exact size plus a NUL terminator
+String escape(Allocator *allocator, String string, EscapeDialect dialect);
+
+void escape_append(StringBuf& buffer, String string, EscapeDialect dialect);
+void escape_append(StringBuilder *builder, String string, EscapeDialect dialect);
+
+/****************************************************************
+ * Unescaping
+ *
+ * The reverse, for the body of a literal without its quotes. The
+ * output is never longer than the input. Besides what escaping
+ * produces it understands:
+ *
+ * ESCAPE_C     octal with 1 to 3 digits, \xHH with 1 or 2 digits,
+ *              \uXXXX and \UXXXXXXXX written out as UTF-8
+ * ESCAPE_JSON  \/ and \uXXXX including surrogate pairs, written out
+ *              as UTF-8
+****************************************************************/
+// `out` has to hold string.len() bytes. Returns how many were written, or -1 for
+// a malformed escape sequence, whose offset goes to `error_offset` if it's given
+isize unescape_to(u8 *out, String string, EscapeDialect dialect, isize *error_offset = NULL);
+
+// String::invalid() if there's a malformed escape sequence
+String unescape(Allocator *allocator, String string, EscapeDialect dialect);
+
+}
+
+#endif // _XTB_ESCAPE_H_
@@ -0,0 +1,365 @@
+#ifndef _XTB_FORMAT_H_
+#define _XTB_FORMAT_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/intrinsics.h>
+#include <xtb_core/allocator.h>
+#include <xtb_core/string.h>
+
+#include <type_traits>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Formatting
+ *
+ * Type-safe replacement for the printf family:
+ *
+ *     format_to(buffer, "{} took {:.2f}ms", name, elapsed);
+ *
+ * Each `{}` takes the next argument. A spec after a colon is
+ * [[fill]align][0][width][.precision][type] with align one of
+ * `<`, `>`, `^` and type one of:
+ *
+ *     d x X b o    integers in base 10, 16, 2 or 8
+ *     c            integer as a character
+ *     f e E g G    floats, precision defaults to 6 like printf
+ *     s            strings, precision truncates
+ *     p            pointers
+ *
+ * Floats without a type print the shortest representation that
+ * reads back to the same value. `{{` and `}}` are literal braces.
+ *
+ * Arguments are type-erased into FormatArg so the engine itself is
+ * not instantiated per call. Other types are formatted by
+ * specializing Formatter<T>:
+ *
+ *     template <>
+ *     struct Formatter<Vec2>
+ *     {
+ *         static void format(FormatBuffer *out, const Vec2& v, const FormatSpec& spec)
+ *         {
+ *             format_to(out, "({}, {})", v.x, v.y);
+ *         }
+ *     };
+ *
+ * Format strings are checked against the argument count at
+ * compile time, xtb_core requires C++20 of everything using it.
+ * Built as an older standard, a mismatch panics at runtime.
+****************************************************************/
+
+// Output target: either a StringBuf that grows, or a fixed caller buffer. `length`
+// counts everything produced, so it tells how big a fixed buffer would have to be
+struct FormatBuffer
+{
+    StringBuf *string_buf;
+    u8 *data;
+    isize capacity;
+    isize length;
+
+    static FormatBuffer from_string_buf(StringBuf *string_buf)
+    {
+        return FormatBuffer { string_buf, NULL, 0, 0 };
+    }
+
+    static FormatBuffer from_pointer(void *data, isize capacity)
+    {
+        return FormatBuffer { NULL, (u8 *)data, capacity, 0 };
+    }
+};
+
+struct FormatSpec
+{
+    isize width;
+    isize precision; // -1 when not given
+    u8 fill;
+    u8 align;        // '<', '>', '^' or 0 for the type's default
+    u8 type;         // 0 for the type's default
+    bool zero_pad;
+};
+
+template <typename T, typename Enable = void>
+struct Formatter;
+
+using FormatCustomProc = void(FormatBuffer *out, const void *value, const FormatSpec& spec);
+
+struct FormatArg
+{
+    enum Type : u8
+    {
+        FORMAT_ARG_NONE,
+        FORMAT_ARG_BOOL,
+        FORMAT_ARG_CHAR,
+        FORMAT_ARG_I64,
+        FORMAT_ARG_U64,
+        FORMAT_ARG_F64,
+        FORMAT_ARG_CSTR,
+        FORMAT_ARG_STRING,
+        FORMAT_ARG_POINTER,
+        FORMAT_ARG_CUSTOM,
+    };
+
+    struct StringArg
+    {
+        const u8 *data;
+        isize len;
+    };
+
+    struct CustomArg
+    {
+        const void *value;
+        FormatCustomProc *proc;
+    };
+
+    Type type;
+    union
+    {
+        bool b;
+        char c;
+        i64 i;
+        u64 u;
+        f64 f;
+        const char *cstr;
+        StringArg string;
+        const void *pointer;
+        CustomArg custom;
+    };
+};
+
+/****************************************************************
+ * Format engine
+****************************************************************/
+// Number of characters format_u64_decimal can write
+#define FORMAT_U64_MAX_CHARS 20
+
+// Writes the decimal digits of `value` to `out` and returns how many were written
+isize format_u64_decimal(u8 *out, u64 value);
+
+void format_write(FormatBuffer *out, const void *data, isize len);
+void format_write_padded(FormatBuffer *out, String content, const FormatSpec& spec, u8 default_align);
+
+void format_write_string(FormatBuffer *out, String string, const FormatSpec& spec);
+void format_write_i64(FormatBuffer *out, i64 value, const FormatSpec& spec);
+void format_write_u64(FormatBuffer *out, u64 value, const FormatSpec& spec);
+void format_write_f64(FormatBuffer *out, f64 value, const FormatSpec& spec);
+
+void format_write_args(FormatBuffer *out, String fmt, const FormatArg *args, isize arg_count);
+
+// Formats into `stack_buffer` and only falls back to malloc when the output doesn't
+// fit, or truncates when malloc fails. The result is NUL terminated, release it with
+// format_free_temp
+struct FormatTemp
+{
+    String string;
+    bool on_heap;
+};
+
+FormatTemp format_temp(u8 *stack_buffer, isize stack_capacity, String fmt,
+                       const FormatArg *args, isize arg_count);
+void format_free_temp(FormatTemp temp);
+
+noreturn void format_string_error(const char *message);
+
+// Counts the placeholders in `fmt`, or returns -1 if its braces are unbalanced.
+// Specs are only validated while formatting
+constexpr isize format_count_placeholders(const char *fmt, isize len)
+{
+    isize count = 0;
+    for (isize i = 0; i < len; ++i)
+    {
+        if (fmt[i] == '}')
+        {
+            if (i + 1 >= len || fmt[i + 1] != '}') return -1;
+            ++i;
+            continue;
+        }
+
+        if (fmt[i] != '{') continue;
+
+        if (i + 1 < len && fmt[i + 1] == '{')
+        {
+            ++i;
+            continue;
+        }
+
+        while (i < len && fmt[i] != '}')
+        {
+            ++i;
+        }
+        if (i == len) return -1;
+
+        count += 1;
+    }
+
+    return count;
+}
+
+/****************************************************************
+ * Format strings
+****************************************************************/
+#if defined(__cpp_consteval)
+#define FORMAT_CONSTEVAL consteval
+#else
+#define FORMAT_CONSTEVAL
+#endif
+
+template <typename T>
+struct FormatIdentity
+{
+    using Type = T;
+};
+
+template <typename... Args>
+struct FormatString
+{
+    const char *data;
+    isize len;
+
+    template <isize N>
+    FORMAT_CONSTEVAL FormatString(const char (&literal)[N])
+        : data(literal), len(N - 1)
+    {
+#if defined(__cpp_consteval)
+        if (format_count_placeholders(literal, N - 1) != (isize)sizeof...(Args))
+        {
+            format_string_error("Format string doesn't match the number of arguments");
+        }
+#endif
+    }
+
+    // Strings built at runtime are only checked while formatting
+    FormatString(String string)
+        : data((const char *)string.data()), len(string.len()) {}
+
+    String view() const
+    {
+        return String((u8 *)this->data, this->len);
+    }
+};
+
+// Keeps the format string from taking part in deducing the argument types
+template <typename... Args>
+using FormatStringFor = FormatString<typename FormatIdentity<Args>::Type...>;
+
+/****************************************************************
+ * Arguments
+****************************************************************/
+template <typename T>
+FormatArg make_format_arg(const T& value)
+{
+    FormatArg arg = {};
+
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_BOOL;
+        arg.b = value;
+    }
+    else if constexpr (std::is_same_v<T, char>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_CHAR;
+        arg.c = value;
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        return make_format_arg((std::underlying_type_t<T>)value);
+    }
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_I64;
+        arg.i = (i64)value;
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_U64;
+        arg.u = (u64)value;
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_F64;
+        arg.f = (f64)value;
+    }
+    else if constexpr (std::is_same_v<std::decay_t<T>, const char *>
+                       || std::is_same_v<std::decay_t<T>, char *>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_CSTR;
+        arg.cstr = value;
+    }
+    else if constexpr (std::is_same_v<T, String>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_STRING;
+        arg.string = { value.data(), value.len() };
+    }
+    else if constexpr (std::is_same_v<T, StringBuf>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_STRING;
+        arg.string = { value.data(), value.size() };
+    }
+    else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>)
+    {
+        arg.type = FormatArg::FORMAT_ARG_POINTER;
+        arg.pointer = (const void *)value;
+    }
+    else
+    {
+        arg.type = FormatArg::FORMAT_ARG_CUSTOM;
+        arg.custom.value = &value;
+        arg.custom.proc = [](FormatBuffer *out, const void *erased, const FormatSpec& spec)
+        {
+            Formatter<T>::format(out, *(const T *)erased, spec);
+        };
+    }
+
+    return arg;
+}
+
+// One extra slot so formatting without arguments doesn't declare an empty array
+#define FORMAT_ARGS(name, args) FormatArg name[] = { make_format_arg(args)..., FormatArg {} }
+
+/****************************************************************
+ * Format API
+****************************************************************/
+// Appends to `out`, this is also how Formatter specializations compose
+template <typename... Args>
+void format_to(FormatBuffer *out, FormatStringFor<Args...> fmt, const Args&... args)
+{
+    FORMAT_ARGS(format_args, args);
+    format_write_args(out, fmt.view(), format_args, sizeof...(Args));
+}
+
+// Appends to `buffer`
+template <typename... Args>
+void format_to(StringBuf& buffer, FormatStringFor<Args...> fmt, const Args&... args)
+{
+    FormatBuffer out = FormatBuffer::from_string_buf(&buffer);
+    format_to(&out, fmt, args...);
+}
+
+// Like snprintf: writes at most `capacity - 1` characters plus a NUL and returns
+// the length the full output would have
+template <typename... Args>
+isize format_to_buffer(char *buffer, isize capacity, FormatStringFor<Args...> fmt, const Args&... args)
+{
+    FORMAT_ARGS(format_args, args);
+    FormatBuffer out = FormatBuffer::from_pointer(buffer, ClampBot(capacity - 1, 0));
+    format_write_args(&out, fmt.view(), format_args, sizeof...(Args));
+
+    if (capacity > 0)
+    {
+        buffer[Min(out.length, capacity - 1)] = '\0';
+    }
+    return out.length;
+}
+
+// Returns a NUL terminated string allocated from `allocator`
+template <typename... Args>
+String format(Allocator *allocator, FormatStringFor<Args...> fmt, const Args&... args)
+{
+    StringBuf buffer = StringBuf::init_with_capacity(allocator, fmt.len + 16 * sizeof...(Args));
+    format_to(buffer, fmt, args...);
+    return buffer.detach();
+}
+
+}
+
+#endif // _XTB_FORMAT_H_
@@ -0,0 +1,256 @@
+#ifndef _XTB_HASH_H_
+#define _XTB_HASH_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/string.h>
+
+#include <type_traits>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Hash functions
+ *
+ * Fast non-cryptographic hash (wyhash construction), don't feed it
+ * untrusted input where collisions could be forced. The result
+ * only depends on the bytes and the seed, never on the machine or
+ * on how the input was split up, so it's fine to store hashes or
+ * compare them across processes. hash_bytes, Hasher and hash_const
+ * all agree on the same input.
+****************************************************************/
+#define HASH_BLOCK_SIZE 48
+// How far the final read of a long input reaches back before its last block
+#define HASH_TAIL_SIZE 16
+
+u64 hash_bytes(const void *data, isize size, u64 seed = 0);
+
+inline u64 hash_u64(u64 x)
+{
+    // Murmur3 finalizer
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+inline u64 hash_string(String string)
+{
+    return hash_bytes(string.data(), string.len());
+}
+
+inline u64 hash(String string, u64 seed = 0)
+{
+    return hash_bytes(string.data(), string.len(), seed);
+}
+
+inline u64 hash(Slice<u8> bytes, u64 seed = 0)
+{
+    return hash_bytes(bytes.data(), bytes.size(), seed);
+}
+
+inline u64 hash(Slice<const u8> bytes, u64 seed = 0)
+{
+    return hash_bytes(bytes.data(), bytes.size(), seed);
+}
+
+inline u64 hash(const StringBuf& buffer, u64 seed = 0)
+{
+    return hash_bytes(buffer.data(), buffer.size(), seed);
+}
+
+/****************************************************************
+ * Hasher
+ *
+ * Incremental version of hash_bytes for content that arrives in
+ * pieces, e.g. a StringBuf being filled or a file read in chunks.
+ * Feeding the same bytes in any split gives the same hash as one
+ * hash_bytes call over all of them.
+****************************************************************/
+struct Hasher
+{
+    u64 seed;
+    u64 seed1;
+    u64 seed2;
+    isize size;
+
+    // [0, HASH_TAIL_SIZE) keeps the end of the last consumed block, the bytes
+    // that aren't consumed yet follow it
+    isize buffered;
+    u8 buffer[HASH_TAIL_SIZE + HASH_BLOCK_SIZE];
+
+    static Hasher init(u64 seed = 0);
+
+    void update(const void *data, isize size);
+
+    void update(String string)
+    {
+        this->update(string.data(), string.len());
+    }
+
+    // Doesn't change the hasher, more can be added afterwards
+    u64 finish() const;
+};
+
+/****************************************************************
+ * Compile-time hashing
+ *
+ * hash_bytes spelled out in constexpr, for switch labels and table
+ * keys built from literals: hash_literal("position") at compile
+ * time equals hash_string("position") at runtime. Slower than
+ * hash_bytes, keep it out of hot paths.
+****************************************************************/
+constexpr u64 hash_const_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull,
+};
+
+// 64x64 -> 128 bit multiply out of 32 bit halves, low half in `a`, high half in `b`
+constexpr void hash_const_mum(u64 *a, u64 *b)
+{
+    u64 a_hi = *a >> 32, a_lo = *a & 0xffffffff;
+    u64 b_hi = *b >> 32, b_lo = *b & 0xffffffff;
+
+    u64 hi_hi = a_hi * b_hi;
+    u64 hi_lo = a_hi * b_lo;
+    u64 lo_hi = a_lo * b_hi;
+    u64 lo_lo = a_lo * b_lo;
+
+    u64 middle = (lo_lo >> 32) + (hi_lo & 0xffffffff) + (lo_hi & 0xffffffff);
+    *a = (middle << 32) | (lo_lo & 0xffffffff);
+    *b = hi_hi + (hi_lo >> 32) + (lo_hi >> 32) + (middle >> 32);
+}
+
+constexpr u64 hash_const_mix(u64 a, u64 b)
+{
+    hash_const_mum(&a, &b);
+    return a ^ b;
+}
+
+constexpr u64 hash_const_read(const char *p, isize count)
+{
+    // Little endian, like the unaligned loads hash_bytes does
+    u64 value = 0;
+    for (isize i = count - 1; i >= 0; --i)
+    {
+        value = (value << 8) | (u8)p[i];
+    }
+    return value;
+}
+
+constexpr u64 hash_const(const char *p, isize size, u64 seed = 0)
+{
+    const u64 *secret = hash_const_secret;
+
+    seed ^= hash_const_mix(seed ^ secret[0], secret[1]);
+
+    u64 a = 0;
+    u64 b = 0;
+    if (size <= 16)
+    {
+        if (size >= 4)
+        {
+            isize middle = (size >> 3) << 2;
+            a = (hash_const_read(p, 4) << 32) | hash_const_read(p + middle, 4);
+            b = (hash_const_read(p + size - 4, 4) << 32) | hash_const_read(p + size - 4 - middle, 4);
+        }
+        else if (size > 0)
+        {
+            a = ((u64)(u8)p[0] << 16) | ((u64)(u8)p[size >> 1] << 8) | (u8)p[size - 1];
+        }
+    }
+    else
+    {
+        isize remaining = size;
+        if (remaining > HASH_BLOCK_SIZE)
+        {
+            u64 seed1 = seed;
+            u64 seed2 = seed;
+            do
+            {
+                seed = hash_const_mix(hash_const_read(p, 8) ^ secret[1], hash_const_read(p + 8, 8) ^ seed);
+                seed1 = hash_const_mix(hash_const_read(p + 16, 8) ^ secret[2], hash_const_read(p + 24, 8) ^ seed1);
+                seed2 = hash_const_mix(hash_const_read(p + 32, 8) ^ secret[3], hash_const_read(p + 40, 8) ^ seed2);
+                p += HASH_BLOCK_SIZE;
+                remaining -= HASH_BLOCK_SIZE;
+            } while (remaining > HASH_BLOCK_SIZE);
+            seed ^= seed1 ^ seed2;
+        }
+
+        while (remaining > 16)
+        {
+            seed = hash_const_mix(hash_const_read(p, 8) ^ secret[1], hash_const_read(p + 8, 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+
+        a = hash_const_read(p + remaining - 16, 8);
+        b = hash_const_read(p + remaining - 8, 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    hash_const_mum(&a, &b);
+
+    return hash_const_mix(a ^ secret[0] ^ (u64)size, b ^ secret[1]);
+}
+
+template <isize N>
+constexpr u64 hash_literal(const char (&literal)[N], u64 seed = 0)
+{
+    return hash_const(literal, N - 1, seed);
+}
+
+/****************************************************************
+ * Hash key traits
+ *
+ * How HashMap hashes and compares a key type. `cache_hash` makes
+ * the map store each key's hash next to it, worth it when hashing
+ * or comparing keys is expensive.
+****************************************************************/
+template <typename K, typename Enable = void>
+struct HashKey;
+
+template <typename K>
+struct HashKey<K, std::enable_if_t<std::is_integral_v<K> || std::is_enum_v<K> || std::is_pointer_v<K>>>
+{
+    static constexpr bool cache_hash = false;
+
+    static u64 hash(K key)
+    {
+        if constexpr (std::is_pointer_v<K>)
+        {
+            return hash_u64((u64)(uintptr_t)key);
+        }
+        else
+        {
+            return hash_u64((u64)key);
+        }
+    }
+
+    static bool equals(K a, K b)
+    {
+        return a == b;
+    }
+};
+
+template <>
+struct HashKey<String>
+{
+    static constexpr bool cache_hash = true;
+
+    static u64 hash(String key)
+    {
+        return hash_string(key);
+    }
+
+    static bool equals(String a, String b)
+    {
+        return a == b;
+    }
+};
+
+}
+
+#endif // _XTB_HASH_H_
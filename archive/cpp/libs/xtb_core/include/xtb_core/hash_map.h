@@ -0,0 +1,412 @@
+#ifndef _XTB_HASH_MAP_H_
+#define _XTB_HASH_MAP_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/allocator.h>
+#include <xtb_core/contract.h>
+#include <xtb_core/hash.h>
+
+#include <string.h>
+#include <type_traits>
+
+#if ARCH_X64 || ARCH_X86
+#include <emmintrin.h>
+#define HASH_MAP_USE_SSE2 1
+#else
+#define HASH_MAP_USE_SSE2 0
+#endif
+
+namespace xtb
+{
+
+/****************************************************************
+ * HashMap
+ *
+ * Open-addressing hash map laid out like a Swiss table: a control
+ * byte per slot holds 7 bits of the key's hash, or marks the slot
+ * empty or deleted. Slots are probed 16 at a time by comparing a
+ * whole group of control bytes at once, so most lookups touch one
+ * cache line of control bytes and a single slot.
+ *
+ * Like Array, keys and values are copied around bytewise and must
+ * be trivially copyable. Pointers to values stay valid until the
+ * next insertion.
+****************************************************************/
+#define HASH_MAP_GROUP_WIDTH 16
+
+#define HASH_MAP_CTRL_EMPTY   ((i8)-128)
+#define HASH_MAP_CTRL_DELETED ((i8)-2)
+
+template <typename K, typename V, bool CacheHash = HashKey<K>::cache_hash>
+struct HashMapSlot
+{
+    K key;
+    V value;
+};
+
+template <typename K, typename V>
+struct HashMapSlot<K, V, true>
+{
+    K key;
+    V value;
+    u64 hash;
+};
+
+// Bit N is set when control byte N of the group equals `value`
+inline u32 hash_map_group_match(const i8 *ctrl, i8 value)
+{
+#if HASH_MAP_USE_SSE2
+    __m128i group = _mm_load_si128((const __m128i *)ctrl);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+    u32 mask = 0;
+    for (i32 i = 0; i < HASH_MAP_GROUP_WIDTH; ++i)
+    {
+        mask |= (u32)(ctrl[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+// Empty and deleted slots are the ones with the top bit set
+inline u32 hash_map_group_match_free(const i8 *ctrl)
+{
+#if HASH_MAP_USE_SSE2
+    return (u32)_mm_movemask_epi8(_mm_load_si128((const __m128i *)ctrl));
+#else
+    u32 mask = 0;
+    for (i32 i = 0; i < HASH_MAP_GROUP_WIDTH; ++i)
+    {
+        mask |= (u32)(ctrl[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+template <typename K, typename V>
+struct HashMap
+{
+    using Slot = HashMapSlot<K, V>;
+    using Traits = HashKey<K>;
+
+    StaticAssert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                 "HashMap keys and values must be trivially copyable");
+
+    struct Iterator
+    {
+        const HashMap *map;
+        isize index;
+
+        void skip_free()
+        {
+            while (this->index < this->map->m_capacity && this->map->m_ctrl[this->index] < 0)
+            {
+                ++this->index;
+            }
+        }
+
+        bool operator!=(const Iterator& other) const { return this->index != other.index; }
+        void operator++() { ++this->index; this->skip_free(); }
+        Slot& operator*() const { return this->map->m_slots[this->index]; }
+    };
+
+    HashMap() = default;
+
+    explicit HashMap(Allocator *allocator, isize capacity = 0)
+        : m_allocator(allocator)
+    {
+        this->reserve(capacity);
+    }
+
+    static HashMap init(Allocator *allocator)
+    {
+        return HashMap(allocator);
+    }
+
+    static HashMap init_with_capacity(Allocator *allocator, isize capacity)
+    {
+        return HashMap(allocator, capacity);
+    }
+
+    void deinit()
+    {
+        if (m_ctrl != NULL)
+        {
+            allocator_deallocate(m_allocator, m_ctrl, buffer_size(m_capacity), buffer_alignment());
+        }
+        m_ctrl = NULL;
+        m_slots = NULL;
+        m_size = 0;
+        m_capacity = 0;
+        m_growth_left = 0;
+    }
+
+    void clear()
+    {
+        this->deinit();
+    }
+
+    // Makes room for `count` entries in total without rehashing
+    void reserve(isize count)
+    {
+        isize capacity = HASH_MAP_GROUP_WIDTH;
+        while (max_load(capacity) < count)
+        {
+            capacity *= 2;
+        }
+
+        if (count > 0 && capacity > m_capacity)
+        {
+            this->rehash(capacity);
+        }
+    }
+
+    isize size() const { return m_size; }
+    isize capacity() const { return m_capacity; }
+    Allocator* allocator() const { return m_allocator; }
+
+    V* get(K key)
+    {
+        isize index = this->find_index(key, Traits::hash(key));
+        return index >= 0 ? &m_slots[index].value : NULL;
+    }
+
+    const V* get(K key) const
+    {
+        isize index = this->find_index(key, Traits::hash(key));
+        return index >= 0 ? &m_slots[index].value : NULL;
+    }
+
+    bool contains(K key) const
+    {
+        return this->find_index(key, Traits::hash(key)) >= 0;
+    }
+
+    // Inserts or overwrites
+    V* put(K key, V value)
+    {
+        V *slot_value = this->get_or_insert(key);
+        *slot_value = value;
+        return slot_value;
+    }
+
+    // Returns the value for `key`, inserting a value-initialized one if there is none
+    V* get_or_insert(K key, bool *inserted = NULL)
+    {
+        u64 hash = Traits::hash(key);
+
+        isize index = this->find_index(key, hash);
+        if (inserted != NULL) *inserted = index < 0;
+        if (index >= 0)
+        {
+            return &m_slots[index].value;
+        }
+
+        if (m_capacity == 0)
+        {
+            this->rehash(HASH_MAP_GROUP_WIDTH);
+        }
+
+        index = this->find_free_index(hash);
+        if (m_ctrl[index] == HASH_MAP_CTRL_EMPTY && m_growth_left == 0)
+        {
+            // Mostly tombstones means a same-size rehash is enough to clean up
+            bool mostly_deleted = m_size * 2 <= max_load(m_capacity);
+            this->rehash(mostly_deleted ? m_capacity : m_capacity * 2);
+            index = this->find_free_index(hash);
+        }
+
+        if (m_ctrl[index] == HASH_MAP_CTRL_EMPTY)
+        {
+            m_growth_left -= 1;
+        }
+
+        m_ctrl[index] = h2(hash);
+        Slot *slot = &m_slots[index];
+        slot->key = key;
+        slot->value = V{};
+        if constexpr (Traits::cache_hash)
+        {
+            slot->hash = hash;
+        }
+        m_size += 1;
+
+        return &slot->value;
+    }
+
+    bool remove(K key)
+    {
+        isize index = this->find_index(key, Traits::hash(key));
+        if (index < 0) return false;
+
+        // No probe sequence ever went past a group that still has an empty
+        // slot, so the slot can be reused outright instead of leaving a tombstone
+        const i8 *group = m_ctrl + index / HASH_MAP_GROUP_WIDTH * HASH_MAP_GROUP_WIDTH;
+        if (hash_map_group_match(group, HASH_MAP_CTRL_EMPTY) != 0)
+        {
+            m_ctrl[index] = HASH_MAP_CTRL_EMPTY;
+            m_growth_left += 1;
+        }
+        else
+        {
+            m_ctrl[index] = HASH_MAP_CTRL_DELETED;
+        }
+        m_size -= 1;
+
+        return true;
+    }
+
+    Iterator begin() const
+    {
+        Iterator it = { this, 0 };
+        it.skip_free();
+        return it;
+    }
+
+    Iterator end() const
+    {
+        return Iterator { this, m_capacity };
+    }
+
+protected:
+    static i8 h2(u64 hash) { return (i8)(hash & 0x7f); }
+    static u64 h1(u64 hash) { return hash >> 7; }
+
+    // Keeps at least one empty slot in every probe sequence
+    static isize max_load(isize capacity) { return capacity - capacity / 8; }
+
+    static isize slots_offset(isize capacity)
+    {
+        return (capacity + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+    }
+
+    static isize buffer_size(isize capacity)
+    {
+        return slots_offset(capacity) + capacity * sizeof(Slot);
+    }
+
+    static isize buffer_alignment()
+    {
+        return Max((isize)HASH_MAP_GROUP_WIDTH, (isize)alignof(Slot));
+    }
+
+    u64 slot_hash(const Slot *slot) const
+    {
+        if constexpr (Traits::cache_hash)
+        {
+            return slot->hash;
+        }
+        else
+        {
+            return Traits::hash(slot->key);
+        }
+    }
+
+    bool slot_matches(const Slot *slot, K key, u64 hash) const
+    {
+        if constexpr (Traits::cache_hash)
+        {
+            if (slot->hash != hash) return false;
+        }
+        return Traits::equals(slot->key, key);
+    }
+
+    isize find_index(K key, u64 hash) const
+    {
+        if (m_size == 0) return -1;
+
+        isize group_mask = m_capacity / HASH_MAP_GROUP_WIDTH - 1;
+        isize group_index = (isize)(h1(hash) & (u64)group_mask);
+
+        // Triangular probing visits every group once when the count is a power of two
+        for (isize step = 1; ; ++step)
+        {
+            const i8 *group = m_ctrl + group_index * HASH_MAP_GROUP_WIDTH;
+
+            u32 candidates = hash_map_group_match(group, h2(hash));
+            while (candidates != 0)
+            {
+                isize index = group_index * HASH_MAP_GROUP_WIDTH + __builtin_ctz(candidates);
+                if (this->slot_matches(&m_slots[index], key, hash))
+                {
+                    return index;
+                }
+                candidates &= candidates - 1;
+            }
+
+            if (hash_map_group_match(group, HASH_MAP_CTRL_EMPTY) != 0)
+            {
+                return -1;
+            }
+
+            group_index = (group_index + step) & group_mask;
+        }
+    }
+
+    isize find_free_index(u64 hash) const
+    {
+        isize group_mask = m_capacity / HASH_MAP_GROUP_WIDTH - 1;
+        isize group_index = (isize)(h1(hash) & (u64)group_mask);
+
+        for (isize step = 1; ; ++step)
+        {
+            u32 free_slots = hash_map_group_match_free(m_ctrl + group_index * HASH_MAP_GROUP_WIDTH);
+            if (free_slots != 0)
+            {
+                return group_index * HASH_MAP_GROUP_WIDTH + __builtin_ctz(free_slots);
+            }
+
+            group_index = (group_index + step) & group_mask;
+        }
+    }
+
+    void rehash(isize new_capacity)
+    {
+        Assert(new_capacity >= HASH_MAP_GROUP_WIDTH && (new_capacity & (new_capacity - 1)) == 0);
+        Assert(max_load(new_capacity) >= m_size);
+
+        i8 *old_ctrl = m_ctrl;
+        Slot *old_slots = m_slots;
+        isize old_capacity = m_capacity;
+
+        u8 *buffer = (u8 *)allocator_allocate(m_allocator, buffer_size(new_capacity), buffer_alignment());
+        Assert(buffer != NULL);
+
+        m_ctrl = (i8 *)buffer;
+        m_slots = (Slot *)(buffer + slots_offset(new_capacity));
+        m_capacity = new_capacity;
+        m_growth_left = max_load(new_capacity) - m_size;
+        memset(m_ctrl, (u8)HASH_MAP_CTRL_EMPTY, new_capacity);
+
+        for (isize i = 0; i < old_capacity; ++i)
+        {
+            if (old_ctrl[i] < 0) continue;
+
+            u64 hash = this->slot_hash(&old_slots[i]);
+            isize index = this->find_free_index(hash);
+            m_ctrl[index] = h2(hash);
+            memcpy((void *)&m_slots[index], &old_slots[i], sizeof(Slot));
+        }
+
+        if (old_ctrl != NULL)
+        {
+            allocator_deallocate(m_allocator, old_ctrl, buffer_size(old_capacity), buffer_alignment());
+        }
+    }
+
+protected:
+    Allocator* m_allocator = NULL;
+    i8* m_ctrl = NULL;
+    Slot* m_slots = NULL;
+    isize m_size = 0;
+    isize m_capacity = 0;
+    // Empty slots that can still be filled before the load factor is exceeded
+    isize m_growth_left = 0;
+};
+
+template <typename V>
+using StringMap = HashMap<String, V>;
+
+}
+
+#endif // _XTB_HASH_MAP_H_
@@ -2,6 +2,7 @@
 #define _XTB_LOGGER_H_
 
 #include <xtb_core/context_cracking.h>
+#include <xtb_core/format.h>
 
 namespace xtb
 {
@@ -20,7 +21,22 @@ using LogCallback = void(*)(LogLevel level, const char* message, void* user_data
 
 void logger_set_callback(LogCallback cb, void *user_data);
 void logger_set_log_level(LogLevel log_level);
+bool logger_is_enabled(LogLevel level);
 void logger_log(LogLevel level, const char *fmt, ...);
+void logger_log_args(LogLevel level, String fmt, const FormatArg *args, isize arg_count);
+// Logs an already formatted message as is, never allocates
+void logger_log_message(LogLevel level, const char *message);
+
+// Same as logger_log with a format.h format string, messages only touch the heap
+// when they don't fit in a stack buffer
+template <typename... Args>
+void log_format(LogLevel level, FormatStringFor<Args...> fmt, const Args&... args)
+{
+    if (!logger_is_enabled(level)) return;
+
+    FORMAT_ARGS(format_args, args);
+    logger_log_args(level, fmt.view(), format_args, sizeof...(Args));
+}
 
 #define LOG_TRACE(fmt, ...) logger_log(LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
 #define LOG_DEBUG(fmt, ...) logger_log(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
@@ -0,0 +1,370 @@
+#ifndef _XTB_OWNING_ARRAY_H_
+#define _XTB_OWNING_ARRAY_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/allocator.h>
+#include <xtb_core/array.h>
+#include <xtb_core/contract.h>
+#include <xtb_core/slice.h>
+
+#include <initializer_list>
+#include <new>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+namespace xtb
+{
+
+/****************************************************************
+ * OwningArray
+ *
+ * Array that owns its elements: they are constructed in place,
+ * moved when the buffer grows and destroyed on removal or `deinit`.
+ * Trivially copyable element types skip all of that and are moved
+ * around with memcpy/memmove and grown with `reallocate`.
+ *
+ * The destructor calls `deinit`. Copying is disabled since two
+ * owners would destroy the same elements, move the array instead.
+****************************************************************/
+template <typename T>
+struct OwningArray
+{
+    OwningArray() = default;
+
+    explicit OwningArray(Allocator *allocator, isize capacity = 0)
+        : m_allocator(allocator)
+    {
+        this->ensure_capacity(capacity);
+    }
+
+    ~OwningArray()
+    {
+        this->deinit();
+    }
+
+    OwningArray(const OwningArray&) = delete;
+    OwningArray& operator=(const OwningArray&) = delete;
+
+    OwningArray(OwningArray&& other)
+        : m_allocator(other.m_allocator), m_data(other.m_data),
+          m_size(other.m_size), m_capacity(other.m_capacity)
+    {
+        other.m_data = NULL;
+        other.m_size = 0;
+        other.m_capacity = 0;
+    }
+
+    OwningArray& operator=(OwningArray&& other)
+    {
+        if (this != &other)
+        {
+            this->deinit();
+            m_allocator = other.m_allocator;
+            m_data = other.m_data;
+            m_size = other.m_size;
+            m_capacity = other.m_capacity;
+            other.m_data = NULL;
+            other.m_size = 0;
+            other.m_capacity = 0;
+        }
+        return *this;
+    }
+
+    static OwningArray<T> init(Allocator *allocator)
+    {
+        return OwningArray(allocator);
+    }
+
+    static OwningArray<T> init_with_capacity(Allocator *allocator, isize capacity)
+    {
+        return OwningArray(allocator, capacity);
+    }
+
+    // Destroys the elements and frees the buffer, the array can be reused afterwards
+    void deinit()
+    {
+        this->destroy_range(0, m_size);
+        this->free_buffer();
+        m_data = NULL;
+        m_size = 0;
+        m_capacity = 0;
+    }
+
+    void clear()
+    {
+        this->deinit();
+    }
+
+    void reserve(isize capacity)
+    {
+        this->ensure_capacity(capacity);
+    }
+
+    // New elements are value-initialized, removed ones destroyed
+    void resize(isize size)
+    {
+        Assert(size >= 0);
+
+        if (size < m_size)
+        {
+            this->destroy_range(size, m_size);
+        }
+        else if (size > m_size)
+        {
+            this->reserve(size);
+            if constexpr (std::is_trivial_v<T>)
+            {
+                memset((void*)(m_data + m_size), 0, (size - m_size) * sizeof(T));
+            }
+            else
+            {
+                for (isize i = m_size; i < size; ++i)
+                {
+                    new (m_data + i) T();
+                }
+            }
+        }
+        m_size = size;
+    }
+
+    void shrink_to_fit()
+    {
+        if (m_capacity == m_size) return;
+
+        if (m_size == 0)
+        {
+            this->free_buffer();
+            m_data = NULL;
+            m_capacity = 0;
+            return;
+        }
+
+        this->set_capacity(m_size);
+    }
+
+    // The arguments may refer to elements of this array, growing never frees
+    // them before the new element is constructed
+    template <typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (m_size < m_capacity)
+        {
+            T *item = new (m_data + m_size) T(std::forward<Args>(args)...);
+            m_size += 1;
+            return *item;
+        }
+
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            // Cheap to build on the stack first, which keeps growth a `reallocate`
+            T value(std::forward<Args>(args)...);
+            this->ensure_capacity(m_size + 1);
+            memcpy((void*)(m_data + m_size), &value, sizeof(T));
+        }
+        else
+        {
+            isize new_capacity = GrowGeometric(m_capacity, m_size + 1);
+            T *new_data = allocate_array<T>(m_allocator, new_capacity);
+            Assert(new_data != NULL);
+
+            new (new_data + m_size) T(std::forward<Args>(args)...);
+            this->relocate(new_data, m_data, m_size);
+            this->free_buffer();
+            m_data = new_data;
+            m_capacity = new_capacity;
+        }
+
+        m_size += 1;
+        return m_data[m_size - 1];
+    }
+
+    void append(const T& item)
+    {
+        this->emplace_back(item);
+    }
+
+    void append(T&& item)
+    {
+        this->emplace_back(std::move(item));
+    }
+
+    void append(const T* pointer, isize size)
+    {
+        this->insert(m_size, pointer, size);
+    }
+
+    void append(std::initializer_list<T> ilist)
+    {
+        this->insert(m_size, ilist.begin(), (isize)ilist.size());
+    }
+
+    void insert(isize index, const T& item)
+    {
+        this->insert(index, &item, 1);
+    }
+
+    // Copies `count` items to `index`, shifting the elements after it. The
+    // items must not point into this array.
+    void insert(isize index, const T* pointer, isize count)
+    {
+        CheckBounds(index, m_size);
+        Assert(count >= 0);
+        Assert(pointer + count <= m_data || pointer >= m_data + m_capacity);
+        if (count == 0) return;
+
+        this->ensure_capacity(m_size + count);
+        this->relocate(m_data + index + count, m_data + index, m_size - index);
+
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            memcpy((void*)(m_data + index), pointer, count * sizeof(T));
+        }
+        else
+        {
+            for (isize i = 0; i < count; ++i)
+            {
+                new (m_data + index + i) T(pointer[i]);
+            }
+        }
+        m_size += count;
+    }
+
+    void erase(isize index, isize count = 1)
+    {
+        Assert(count >= 0 && index >= 0 && index + count <= m_size);
+        if (count == 0) return;
+
+        this->destroy_range(index, index + count);
+        this->relocate(m_data + index, m_data + index + count, m_size - index - count);
+        m_size -= count;
+    }
+
+    void pop_back()
+    {
+        Assert(m_size > 0);
+        this->erase(m_size - 1);
+    }
+
+    isize size() const { return m_size; }
+    isize capacity() const { return m_capacity; }
+    T* data() const { return m_data; }
+    Allocator* allocator() const { return m_allocator; }
+
+    T& operator[](isize index)
+    {
+        Assert(index < m_size);
+        return m_data[index];
+    }
+
+    const T& operator[](isize index) const
+    {
+        Assert(index < m_size);
+        return m_data[index];
+    }
+
+    T* begin() { return m_data; }
+    T* end() { return m_data + m_size; }
+
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+
+    const T* cbegin() const { return m_data; }
+    const T* cend() const { return m_data + m_size; }
+
+    auto enumerate() { return xtb::enumerate(*this); }
+
+    [[nodiscard]] Slice<T>       to_slice()       noexcept { return Slice<T>(m_data, m_size); }
+    [[nodiscard]] Slice<const T> to_slice() const noexcept { return Slice<const T>(m_data, m_size); }
+
+protected:
+    void ensure_capacity(isize needed)
+    {
+        if (m_capacity >= needed) return;
+        this->set_capacity(GrowGeometric(m_capacity, needed));
+    }
+
+    void set_capacity(isize new_capacity)
+    {
+        Assert(new_capacity >= m_size);
+
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            m_data = reallocate<T>(m_allocator, (void*)m_data, m_capacity, new_capacity);
+            Assert(m_data != NULL);
+        }
+        else
+        {
+            T *new_data = allocate_array<T>(m_allocator, new_capacity);
+            Assert(new_data != NULL);
+            this->relocate(new_data, m_data, m_size);
+            this->free_buffer();
+            m_data = new_data;
+        }
+
+        m_capacity = new_capacity;
+    }
+
+    void free_buffer()
+    {
+        if (m_data != NULL)
+        {
+            allocator_deallocate(m_allocator, m_data, m_capacity * sizeof(T), alignof(T));
+        }
+    }
+
+    void destroy_range(isize from, isize to)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            for (isize i = from; i < to; ++i)
+            {
+                m_data[i].~T();
+            }
+        }
+    }
+
+    // Moves `count` live elements from `src` into the uninitialized slots at
+    // `dst`, leaving `src` uninitialized. The ranges may overlap.
+    static void relocate(T* dst, T* src, isize count)
+    {
+        if (count == 0 || dst == src) return;
+
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            memmove((void*)dst, src, count * sizeof(T));
+        }
+        else if (dst < src)
+        {
+            for (isize i = 0; i < count; ++i)
+            {
+                new (dst + i) T(std::move(src[i]));
+                src[i].~T();
+            }
+        }
+        else
+        {
+            for (isize i = count - 1; i >= 0; --i)
+            {
+                new (dst + i) T(std::move(src[i]));
+                src[i].~T();
+            }
+        }
+    }
+
+protected:
+    Allocator* m_allocator = NULL;
+    T* m_data = NULL;
+    isize m_size = 0;
+    isize m_capacity = 0;
+};
+
+template <typename T>
+[[nodiscard]] constexpr Slice<T> slice(const OwningArray<T>& array) noexcept
+{
+    return Slice<T>(array.data(), array.size());
+}
+
+}
+
+#endif // _XTB_OWNING_ARRAY_H_
@@ -0,0 +1,45 @@
+#ifndef _XTB_PARSE_NUMBER_H_
+#define _XTB_PARSE_NUMBER_H_
+
+#include <xtb_core/core.h>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Number parsing
+ *
+ * Decimal integers and floats straight from a byte range: no NUL
+ * terminator needed, no locale, no errno. Floats are correctly
+ * rounded. Most inputs take the Clinger fast path or Eisel-Lemire,
+ * the rare ones those can't decide (more than 19 significant
+ * digits right next to a rounding boundary) go through strtod in
+ * the "C" locale.
+ *
+ * Accepted syntax, without surrounding whitespace:
+ *
+ *     integers  [+-]digits          (no '-' for unsigned)
+ *     floats    [+-]digits[.digits][(e|E)[+-]digits]
+ *               [+-].digits[(e|E)[+-]digits]
+ *               [+-](inf|infinity|nan), any case
+****************************************************************/
+enum ParseNumberStatus : u8
+{
+    PARSE_NUMBER_OK,
+    // Not a number at all, or, for the whole-string versions, followed by something else
+    PARSE_NUMBER_INVALID,
+    // A number that doesn't fit the type. Integers are clamped to the type's range,
+    // floats become infinity. Floats too small to represent round to 0 without error
+    PARSE_NUMBER_OUT_OF_RANGE,
+};
+
+// Parse the longest number at the start of data[0, size) and store how many bytes it
+// took in `length`, 0 when it's PARSE_NUMBER_INVALID. An exponent marker without
+// digits after it isn't part of the number, "1e+" parses as 1 with length 1
+ParseNumberStatus parse_u64_prefix(const u8 *data, isize size, u64 *out, isize *length);
+ParseNumberStatus parse_i64_prefix(const u8 *data, isize size, i64 *out, isize *length);
+ParseNumberStatus parse_f64_prefix(const u8 *data, isize size, f64 *out, isize *length);
+
+}
+
+#endif // _XTB_PARSE_NUMBER_H_
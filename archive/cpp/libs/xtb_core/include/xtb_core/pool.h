@@ -0,0 +1,39 @@
+#ifndef _XTB_ALLOCATOR_POOL_H_
+#define _XTB_ALLOCATOR_POOL_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/allocator.h>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Size-class pool allocator
+ *
+ * Small allocations are rounded up to a size class and served from
+ * 64KB slabs owned by the allocating thread, so the hot path touches
+ * only thread-local state. Blocks freed by a thread other than the
+ * owner are pushed onto the slab's lock-free remote-free list and
+ * reclaimed by the owner the next time it runs out of blocks.
+ *
+ * Requests bigger than POOL_MAX_BLOCK_SIZE or aligned to more than
+ * POOL_BLOCK_ALIGNMENT are forwarded to the malloc allocator.
+****************************************************************/
+#define POOL_SLAB_SIZE Kilobytes(64)
+#define POOL_MAX_BLOCK_SIZE 2048
+#define POOL_BLOCK_ALIGNMENT 16
+#define POOL_SIZE_CLASS_COUNT 24
+
+// Address range reserved for slabs by the first pooled allocation
+#define POOL_RESERVE_SIZE Gigabytes((size_t)16)
+
+void pool_allocator_init(void);
+Allocator *pool_allocator_get(void);
+
+// Hands the calling thread's slabs over to whichever thread frees into them
+// next. Call before a thread that used the pool exits.
+void pool_allocator_thread_detach(void);
+
+}
+
+#endif // _XTB_ALLOCATOR_POOL_H_
@@ -0,0 +1,61 @@
+#ifndef _XTB_ALLOCATOR_SHARED_ARENA_H_
+#define _XTB_ALLOCATOR_SHARED_ARENA_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/allocator.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Shared arena
+ *
+ * An arena many threads can allocate from at once, for building a
+ * single result in parallel and freeing it in one go. Allocation is
+ * a fetch-add on the current chunk's offset. The first thread to run
+ * a chunk dry installs the next one under a short lock, threads that
+ * ran it dry at the same time wait for it and retry in that chunk.
+ *
+ * Allocating is thread-safe, releasing is not: make sure every
+ * producer is done before calling `shared_arena_release`.
+****************************************************************/
+#define push_array_shared(arena, type, count) (type *)shared_arena_alloc_aligned((arena), sizeof(type) * (count), alignof(type))
+#define push_struct_shared(arena, type) push_array_shared((arena), type, 1)
+
+// Sizes are rounded to this so that offsets stay aligned without per-call padding
+#define SHARED_ARENA_GRANULARITY 16
+
+struct SharedArenaChunk
+{
+    size_t capacity;
+    std::atomic<size_t> offset;
+    SharedArenaChunk *next;
+};
+
+struct SharedArena
+{
+    Allocator allocator;
+    std::atomic<SharedArenaChunk *> current_chunk;
+    // Allocations too big to share a chunk get one of their own
+    std::atomic<SharedArenaChunk *> oversized_chunks;
+    size_t chunk_size;
+    // Taken only to install a new current chunk
+    std::mutex grow_lock;
+};
+
+SharedArena *shared_arena_new(size_t chunk_size);
+void shared_arena_release(SharedArena *arena);
+
+void *shared_arena_alloc(SharedArena *arena, size_t allocation_size);
+void *shared_arena_alloc_zero(SharedArena *arena, size_t allocation_size);
+void *shared_arena_alloc_aligned(SharedArena *arena, size_t allocation_size, size_t alignment);
+
+// Bytes handed out so far, not thread-safe with respect to concurrent allocations
+size_t shared_arena_dump_memory_usage(SharedArena *arena);
+
+}
+
+#endif // _XTB_ALLOCATOR_SHARED_ARENA_H_
@@ -0,0 +1,218 @@
+#ifndef _XTB_SMALL_ARRAY_H_
+#define _XTB_SMALL_ARRAY_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/allocator.h>
+#include <xtb_core/array.h>
+#include <xtb_core/contract.h>
+#include <xtb_core/slice.h>
+
+#include <initializer_list>
+#include <string.h>
+#include <type_traits>
+
+namespace xtb
+{
+
+/****************************************************************
+ * SmallArray
+ *
+ * Array with room for N elements inside the struct itself, the
+ * allocator is only touched once it grows past that. The data
+ * pointer is recomputed on every access instead of being stored,
+ * so a SmallArray can be copied around by value (or sit in a union)
+ * without pointing back into the copy it came from. That limits it
+ * to trivially copyable element types.
+ *
+ * Like Array, copies share the spilled heap buffer, call `deinit`
+ * on exactly one of them.
+****************************************************************/
+template <typename T, isize N>
+struct SmallArray
+{
+    StaticAssert(N > 0, "SmallArray needs at least one inline element");
+    StaticAssert(std::is_trivially_copyable_v<T>, "SmallArray needs trivially copyable elements");
+
+    SmallArray() = default;
+
+    explicit SmallArray(Allocator *allocator, isize capacity = 0)
+        : m_allocator(allocator)
+    {
+        this->ensure_capacity(capacity);
+    }
+
+    explicit SmallArray(Allocator *allocator, const T *pointer, isize size)
+        : SmallArray(allocator, size)
+    {
+        this->append_assume_capacity(pointer, size);
+    }
+
+    static SmallArray init(Allocator *allocator)
+    {
+        return SmallArray(allocator);
+    }
+
+    static SmallArray init_with_capacity(Allocator *allocator, isize capacity)
+    {
+        return SmallArray(allocator, capacity);
+    }
+
+    static SmallArray from_pointer(Allocator *allocator, T *pointer, isize size)
+    {
+        return SmallArray(allocator, pointer, size);
+    }
+
+    static SmallArray init_with_size(Allocator *allocator, isize size)
+    {
+        auto result = SmallArray::init(allocator);
+        result.resize(size);
+        return result;
+    }
+
+    void deinit()
+    {
+        if (m_heap != NULL)
+        {
+            allocator_deallocate(m_allocator, m_heap, m_capacity * sizeof(T), alignof(T));
+        }
+    }
+
+    void reserve(isize capacity)
+    {
+        this->ensure_capacity(capacity);
+    }
+
+    void resize(isize size)
+    {
+        this->reserve(size);
+        T *items = this->data();
+        for (isize i = m_size; i < size; ++i)
+        {
+            items[i] = T{};
+        }
+        m_size = size;
+    }
+
+    void append(const T& item)
+    {
+        this->ensure_capacity(m_size + 1);
+        this->append_assume_capacity(item);
+    }
+
+    void append(const T* pointer, isize size)
+    {
+        this->ensure_capacity(m_size + size);
+        this->append_assume_capacity(pointer, size);
+    }
+
+    void append(std::initializer_list<T> ilist)
+    {
+        this->ensure_capacity(m_size + ilist.size());
+        this->append_assume_capacity(ilist);
+    }
+
+    void append_assume_capacity(const T& item)
+    {
+        Assert(m_size + 1 <= this->capacity());
+        this->data()[m_size++] = item;
+    }
+
+    void append_assume_capacity(const T* pointer, isize size)
+    {
+        Assert(m_size + size <= this->capacity());
+        if (size > 0)
+        {
+            memcpy((void *)(this->data() + m_size), pointer, size * sizeof(T));
+            m_size += size;
+        }
+    }
+
+    void append_assume_capacity(std::initializer_list<T> ilist)
+    {
+        this->append_assume_capacity(ilist.begin(), (isize)ilist.size());
+    }
+
+    isize size() const { return m_size; }
+    isize capacity() const { return m_heap != NULL ? m_capacity : N; }
+    T* data() { return m_heap != NULL ? m_heap : (T*)m_inline; }
+    const T* data() const { return m_heap != NULL ? m_heap : (const T*)m_inline; }
+    Allocator* allocator() const { return m_allocator; }
+    bool is_inline() const { return m_heap == NULL; }
+
+    // Drops the heap buffer if there is one and goes back to inline storage
+    void clear()
+    {
+        this->deinit();
+        m_heap = NULL;
+        m_size = 0;
+        m_capacity = 0;
+    }
+
+    T& operator[](isize index)
+    {
+        Assert(index < m_size);
+        return this->data()[index];
+    }
+
+    const T& operator[](isize index) const
+    {
+        Assert(index < m_size);
+        return this->data()[index];
+    }
+
+    T* begin() { return this->data(); }
+    T* end() { return this->data() + m_size; }
+
+    const T* begin() const { return this->data(); }
+    const T* end() const { return this->data() + m_size; }
+
+    const T* cbegin() const { return this->data(); }
+    const T* cend() const { return this->data() + m_size; }
+
+    auto enumerate() { return xtb::enumerate(*this); }
+
+    [[nodiscard]] Slice<T>       to_slice()       noexcept { return Slice<T>(this->data(), m_size); }
+    [[nodiscard]] Slice<const T> to_slice() const noexcept { return Slice<const T>(this->data(), m_size); }
+
+protected:
+    void ensure_capacity(isize needed)
+    {
+        if (this->capacity() >= needed) return;
+
+        isize new_capacity = GrowGeometric(this->capacity(), needed);
+
+        if (m_heap == NULL)
+        {
+            // First spill, move the inline elements over
+            T *heap = allocate_array<T>(m_allocator, new_capacity);
+            Assert(heap != NULL);
+            memcpy((void *)heap, m_inline, m_size * sizeof(T));
+            m_heap = heap;
+        }
+        else
+        {
+            m_heap = reallocate<T>(m_allocator, (void*)m_heap, m_capacity, new_capacity);
+            Assert(m_heap != NULL);
+        }
+
+        m_capacity = new_capacity;
+    }
+
+protected:
+    Allocator* m_allocator = NULL;
+    // NULL while the elements live in `m_inline`
+    T* m_heap = NULL;
+    isize m_size = 0;
+    isize m_capacity = 0;
+    alignas(T) unsigned char m_inline[N * sizeof(T)];
+};
+
+template <typename T, isize N>
+[[nodiscard]] constexpr Slice<T> slice(SmallArray<T, N>& array) noexcept
+{
+    return Slice<T>(array.data(), array.size());
+}
+
+}
+
+#endif // _XTB_SMALL_ARRAY_H_
@@ -2,6 +2,9 @@
 #define _XTB_STACKTRACE_H_
 
 #include <xtb_core/context_cracking.h>
+#include <xtb_core/allocator.h>
+#include <xtb_core/string.h>
+#include <stdint.h>
 
 namespace xtb
 {
@@ -50,6 +53,13 @@ struct ColorScheme
 void print(int skip_frames_count);
 void print_full();
 
+// Records up to `max_count` program counters of the calling thread without
+// resolving symbols, cheap enough to run on every allocation
+i32 capture(uintptr_t *pcs, i32 max_count, int skip_frames_count);
+
+// Resolves a captured program counter to "function (file:line)"
+String describe_address(Allocator *allocator, uintptr_t pc);
+
 void init(const char *exe_path);
 
 void colorscheme_set(ColorScheme colors);
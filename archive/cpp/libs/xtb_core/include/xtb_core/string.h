@@ -6,6 +6,7 @@
 #include <xtb_core/arena.h>
 #include <xtb_core/allocator.h>
 #include <xtb_core/array.h>
+#include <xtb_core/parse_number.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdarg.h>
@@ -16,6 +17,7 @@ namespace xtb
 {
 
 struct StringList;
+struct SplitIterator;
 
 struct String
 {
@@ -38,7 +40,7 @@ struct String
 
     u8* data() { return m_data; }
     const u8* data() const { return m_data; }
-    isize len() { return m_len; }
+    isize len() const { return m_len; }
 
     String copy(Allocator *allocator);
     String substr(isize begin_idx, isize len);
@@ -55,6 +57,7 @@ struct String
     String replace(String from, String to, Allocator* allocator);
 
     String concat(String other, Allocator* allocator);
+    // C escape sequences, escape.h has the JSON dialect and unescaping
     String escape(Allocator *allocator);
 
     String strip_extension();
@@ -80,6 +83,12 @@ struct String
     String trim_right();
     String trim();
 
+    // The whole string has to be the number, see parse_number.h for the syntax
+    // and the `_prefix` versions that parse the start of a string
+    ParseNumberStatus parse_u64(u64 *out) const;
+    ParseNumberStatus parse_i64(i64 *out) const;
+    ParseNumberStatus parse_f64(f64 *out) const;
+
     static String invalid();
     bool is_invalid();
     bool is_valid();
@@ -92,6 +101,15 @@ struct String
     static String array_join(Allocator* allocator, String *array, isize count);
     static String array_join_sep(Allocator* allocator, String *array, isize count, String sep);
 
+    // Lazy splits yielding views into this string, nothing is allocated.
+    // `split` yields a token between every pair of separators, empty ones included.
+    // `lines` splits on '\n' and drops a trailing '\r', a final newline doesn't start
+    // another line. `split_whitespace` yields the non-empty runs between whitespace.
+    SplitIterator split(u8 sep);
+    SplitIterator split(String sep);
+    SplitIterator lines();
+    SplitIterator split_whitespace();
+
     // NOTE: Return types tells you how many bytes to skip
     using SplitPred = isize(String rest, void *data);
 
@@ -113,6 +131,63 @@ private:
 
 std::ostream& operator<<(std::ostream& os, String string);
 
+/****************************************************************
+ * SplitIterator
+ *
+ * Walks a string token by token, finding separators with the
+ * vectorized search in string_search.h. Use `next` directly or a
+ * range-for:
+ *
+ *     for (String line : source.lines()) { ... }
+****************************************************************/
+struct SplitIterator
+{
+    enum Kind : u8
+    {
+        SPLIT_BY_CHAR,
+        SPLIT_BY_STR,
+        SPLIT_LINES,
+        SPLIT_WHITESPACE,
+    };
+
+    struct Cursor;
+
+    SplitIterator() = default;
+    explicit SplitIterator(String source, Kind kind);
+    explicit SplitIterator(String source, u8 sep);
+    explicit SplitIterator(String source, String sep);
+
+    // Stores the next token and returns true, or returns false once the input is exhausted
+    bool next(String *token);
+
+    // Number of tokens left, doesn't advance the iterator
+    isize count();
+
+    // Collects the remaining tokens into an array allocated at its final size
+    Array<String> collect(Allocator *allocator);
+
+    Cursor begin();
+    Cursor end();
+
+private:
+    String m_rest;
+    String m_sep;
+    Kind m_kind;
+    u8 m_sep_char;
+    bool m_finished;
+};
+
+struct SplitIterator::Cursor
+{
+    SplitIterator iterator;
+    String token;
+    bool valid;
+
+    bool operator!=(const Cursor& other) const { return this->valid != other.valid; }
+    void operator++() { this->valid = this->iterator.next(&this->token); }
+    String operator*() const { return this->token; }
+};
+
 struct StringList
 {
     struct Node
@@ -172,14 +247,44 @@ struct StringBuf : public Array<u8>
         this->append_assume_capacity(string.data(), string.len());
     }
 
+    // Shifts the whole content, StringBuilder is the better fit for repeated prepends
     void prepend(String string)
     {
-        // TODO: This can be optimized. If we need to grow anyway, we can insert the old content
-        // in the correct place and avoid shifting afterwards
-        this->ensure_capacity(m_size + string.len());
-        MemoryMove(m_data + string.len(), m_data, m_size);
-        MemoryCopy(m_data, string.data(), string.len());
-        m_size += string.len();
+        isize new_size = m_size + string.len();
+        if (new_size <= m_capacity)
+        {
+            MemoryMove(m_data + string.len(), m_data, m_size);
+            MemoryCopy(m_data, string.data(), string.len());
+            m_size = new_size;
+            return;
+        }
+
+        // Growing anyway, so the old content is copied straight to its final place
+        // instead of being reallocated and shifted afterwards
+        isize new_capacity = GrowGeometric(m_capacity, new_size);
+        u8 *new_data = allocate_array<u8>(m_allocator, new_capacity);
+        Assert(new_data != NULL);
+
+        MemoryCopy(new_data + string.len(), m_data, m_size);
+        MemoryCopy(new_data, string.data(), string.len());
+        if (m_data != NULL)
+        {
+            allocator_deallocate(m_allocator, m_data, m_capacity, alignof(u8));
+        }
+
+        m_data = new_data;
+        m_size = new_size;
+        m_capacity = new_capacity;
+    }
+
+    // Grows the size by `count` and returns the new bytes, uninitialized, for the
+    // caller to fill in
+    u8* extend(isize count)
+    {
+        this->reserve(m_size + count);
+        u8 *tail = m_data + m_size;
+        m_size += count;
+        return tail;
     }
 
     String view()
@@ -195,12 +300,16 @@ struct StringBuf : public Array<u8>
         }
     }
 
+    // Hands the buffer over to the returned string, which is NUL terminated but
+    // doesn't count the terminator in its length
     String detach()
     {
         this->null_terminate();
 
-        String string = String(m_data, m_size);
-        this->clear();
+        String string = String(m_data, m_size - 1);
+        m_data = NULL;
+        m_size = 0;
+        m_capacity = 0;
         return string;
     }
 };
@@ -0,0 +1,125 @@
+#ifndef _XTB_STRING_BUILDER_H_
+#define _XTB_STRING_BUILDER_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/arena.h>
+#include <xtb_core/string.h>
+#include <xtb_core/format.h>
+
+#include <stdio.h>
+
+namespace xtb
+{
+
+/****************************************************************
+ * StringBuilder
+ *
+ * Rope of arena-allocated chunks for building large outputs piece
+ * by piece. Appending and prepending never move what was already
+ * written: both fill the free space at the respective end and add
+ * a chunk once it runs out. `append_view` and `prepend_view` link
+ * the caller's memory in without copying it at all, the caller
+ * keeps it alive until the builder is done.
+ *
+ * The content is only made contiguous once, by `flatten`, or not
+ * at all when it's written out with `write_to_fd` / `write_to_file`.
+ * The chunks live as long as the arena, clearing the builder
+ * doesn't give their memory back.
+****************************************************************/
+#define STRING_BUILDER_MIN_CHUNK_SIZE Kilobytes(1)
+#define STRING_BUILDER_MAX_CHUNK_SIZE Kilobytes(64)
+
+struct StringBuilderChunk
+{
+    StringBuilderChunk *next;
+    StringBuilderChunk *prev;
+    u8 *data;
+
+    // Content is data[begin, end). Prepends fill [0, begin) of the first chunk,
+    // appends fill [end, capacity) of the last one
+    isize begin;
+    isize end;
+    isize capacity;
+
+    String view() const
+    {
+        return String(this->data + this->begin, this->end - this->begin);
+    }
+};
+
+struct StringBuilder
+{
+    StringBuilder() = default;
+
+    explicit StringBuilder(Arena *arena)
+        : m_arena(arena) {}
+
+    static StringBuilder init(Arena *arena)
+    {
+        return StringBuilder(arena);
+    }
+
+    isize size() const { return m_size; }
+    isize chunk_count() const { return m_chunk_count; }
+    bool is_empty() const { return m_size == 0; }
+
+    StringBuilderChunk* first_chunk() const { return m_first; }
+    StringBuilderChunk* last_chunk() const { return m_last; }
+
+    void append(String string);
+    void append(u8 c);
+    void prepend(String string);
+
+    // Link `string` in without copying it
+    void append_view(String string);
+    void prepend_view(String string);
+
+    void append_builder(const StringBuilder& other);
+
+    template <typename... Args>
+    void append_format(FormatStringFor<Args...> fmt, const Args&... args)
+    {
+        FORMAT_ARGS(format_args, args);
+        this->append_format_args(fmt.view(), format_args, sizeof...(Args));
+    }
+
+    void append_format_args(String fmt, const FormatArg *args, isize arg_count);
+
+    // Copies the whole content into `out`, which has to hold size() bytes
+    void copy_to(u8 *out) const;
+
+    // One allocation of size() + 1 bytes, NUL terminated
+    String flatten(Allocator *allocator) const;
+
+    bool write_to_file(FILE *stream) const;
+#if OS_LINUX || OS_MAC
+    // Hands the chunks to writev without joining them first
+    bool write_to_fd(int fd) const;
+#endif
+
+    // Forgets the content, the chunk memory stays in the arena
+    void clear();
+
+private:
+    StringBuilderChunk* push_chunk(isize capacity, bool at_front);
+    StringBuilderChunk* push_spare_chunk(u8 *data, isize capacity, bool at_front);
+    isize next_chunk_capacity(isize needed);
+
+private:
+    Arena* m_arena = NULL;
+    StringBuilderChunk* m_first = NULL;
+    StringBuilderChunk* m_last = NULL;
+    isize m_size = 0;
+    isize m_chunk_count = 0;
+    isize m_chunk_capacity = 0;
+
+    // Free space cut off the chunk next to a view, used by the next append/prepend
+    u8* m_back_spare = NULL;
+    isize m_back_spare_size = 0;
+    u8* m_front_spare = NULL;
+    isize m_front_spare_size = 0;
+};
+
+}
+
+#endif // _XTB_STRING_BUILDER_H_
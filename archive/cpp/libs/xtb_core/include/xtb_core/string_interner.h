@@ -0,0 +1,95 @@
+#ifndef _XTB_STRING_INTERNER_H_
+#define _XTB_STRING_INTERNER_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/string.h>
+#include <xtb_core/hash.h>
+
+namespace xtb
+{
+
+/****************************************************************
+ * String interning
+ *
+ * Stores every distinct string once and hands out a StrId for it,
+ * so comparing interned strings is comparing two integers. The
+ * bytes live in the interner's arena for as long as the interner
+ * does, NUL terminated, and the views returned for an id never
+ * change.
+ *
+ * Lookups (`find`, `get`, and `intern` of a string that's already
+ * there) don't take a lock and can run from any thread. Adding a
+ * new string takes the interner's mutex.
+****************************************************************/
+struct StrId
+{
+    // 0 is never handed out, a zeroed StrId is the invalid id
+    u32 index;
+
+    bool is_valid() const { return this->index != 0; }
+
+    bool operator==(StrId other) const { return this->index == other.index; }
+    bool operator!=(StrId other) const { return this->index != other.index; }
+};
+
+template <>
+struct HashKey<StrId>
+{
+    static constexpr bool cache_hash = false;
+
+    static u64 hash(StrId key)
+    {
+        return hash_u64(key.index);
+    }
+
+    static bool equals(StrId a, StrId b)
+    {
+        return a == b;
+    }
+};
+
+struct StringInterner;
+
+StringInterner *string_interner_new(void);
+void string_interner_release(StringInterner *interner);
+
+StrId string_interner_intern(StringInterner *interner, String string);
+// Returns the invalid id for strings that were never interned, without adding them
+StrId string_interner_find(StringInterner *interner, String string);
+
+String string_interner_get(StringInterner *interner, StrId id);
+// hash_string of the interned bytes, computed once when the string was added
+u64 string_interner_hash(StringInterner *interner, StrId id);
+isize string_interner_count(StringInterner *interner);
+
+/****************************************************************
+ * Global interner
+ *
+ * One process-wide interner for names shared across modules,
+ * created on first use and never released.
+****************************************************************/
+StringInterner *string_interner_global(void);
+
+inline StrId str_intern(String string)
+{
+    return string_interner_intern(string_interner_global(), string);
+}
+
+inline StrId str_find(String string)
+{
+    return string_interner_find(string_interner_global(), string);
+}
+
+inline String str_id_string(StrId id)
+{
+    return string_interner_get(string_interner_global(), id);
+}
+
+inline u64 str_id_hash(StrId id)
+{
+    return string_interner_hash(string_interner_global(), id);
+}
+
+}
+
+#endif // _XTB_STRING_INTERNER_H_
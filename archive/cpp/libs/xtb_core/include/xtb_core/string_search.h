@@ -0,0 +1,38 @@
+#ifndef _XTB_STRING_SEARCH_H_
+#define _XTB_STRING_SEARCH_H_
+
+#include <xtb_core/core.h>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Byte and substring search
+ *
+ * Vectorized kernels behind String::find and friends. The widest
+ * implementation the CPU supports (AVX2, then SSE2) is picked on
+ * first use, other architectures get a scalar fallback.
+ *
+ * All functions return the offset of the match or -1.
+****************************************************************/
+isize memory_find_byte(const void *haystack, isize haystack_len, u8 needle);
+isize memory_find_last_byte(const void *haystack, isize haystack_len, u8 needle);
+
+// An empty needle matches at the start (or end, for the `last` variant)
+isize memory_find(const void *haystack, isize haystack_len, const void *needle, isize needle_len);
+isize memory_find_last(const void *haystack, isize haystack_len, const void *needle, isize needle_len);
+
+// ASCII whitespace as classified by isspace in the "C" locale
+inline bool is_ascii_space(u8 c)
+{
+    return c == ' ' || (u8)(c - '\t') <= '\r' - '\t';
+}
+
+isize memory_find_whitespace(const void *haystack, isize haystack_len);
+
+// Name of the implementation in use: "avx2", "sse2" or "scalar"
+const char *memory_search_backend(void);
+
+}
+
+#endif // _XTB_STRING_SEARCH_H_
@@ -7,14 +7,40 @@
 namespace xtb
 {
 
+#define THREAD_CONTEXT_MAX_SCRATCH_ARENAS 8
+
+struct ThreadContextConfig
+{
+    // Size of the scratch ring, between 2 and THREAD_CONTEXT_MAX_SCRATCH_ARENAS
+    isize scratch_count;
+    // Initial chunk size for malloc scratch arenas, reservation size for virtual ones
+    size_t scratch_size;
+    ArenaBackend scratch_backend;
+};
+
 struct ThreadContext
 {
-    Arena *arenas[2];
+    Arena *arenas[THREAD_CONTEXT_MAX_SCRATCH_ARENAS];
+    // Most bytes each scratch arena held when one of its scopes ended
+    size_t high_water_marks[THREAD_CONTEXT_MAX_SCRATCH_ARENAS];
+    isize arena_count;
+
+    // Live scratch scopes, the next one starts looking at arenas[scratch_depth % arena_count]
+    isize scratch_depth;
 
+    static ThreadContextConfig default_config();
     static void init(ThreadContext* tctx);
+    static void init(ThreadContext* tctx, ThreadContextConfig config);
     static void deinit();
     static ThreadContext* get();
     static Arena* get_scratch(Arena** conflicts, isize count);
+
+    // Like `get_scratch` but returns the ring index and counts the scope as live,
+    // every call must be matched by a `pop_scratch` in reverse order
+    static isize push_scratch(Arena** conflicts, isize count);
+    static void pop_scratch(isize index);
+
+    static void dump_scratch_usage();
 };
 
 struct ThreadContextScope
@@ -26,6 +52,11 @@ struct ThreadContextScope
         ThreadContext::init(&this->tctx);
     }
 
+    ThreadContextScope(ThreadContextConfig config)
+    {
+        ThreadContext::init(&this->tctx, config);
+    }
+
     ~ThreadContextScope()
     {
         ThreadContext::deinit();
@@ -35,21 +66,23 @@ struct ThreadContextScope
 struct ScratchScope
 {
     TempArena scratch;
+    isize index;
 
     ScratchScope()
     {
-        Arena* scratch_arena = ThreadContext::get_scratch(NULL, 0);
-        this->scratch = temp_arena_new(scratch_arena);
+        this->index = ThreadContext::push_scratch(NULL, 0);
+        this->scratch = temp_arena_new(ThreadContext::get()->arenas[this->index]);
     }
 
     ScratchScope(Allocator* conflict)
     {
-        Arena* scratch_arena = ThreadContext::get_scratch((Arena**)&conflict, 1);
-        this->scratch = temp_arena_new(scratch_arena);
+        this->index = ThreadContext::push_scratch((Arena**)&conflict, 1);
+        this->scratch = temp_arena_new(ThreadContext::get()->arenas[this->index]);
     }
 
     ~ScratchScope()
     {
+        ThreadContext::pop_scratch(this->index);
         temp_arena_release(this->scratch);
     }
 
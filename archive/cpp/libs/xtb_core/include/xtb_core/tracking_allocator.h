@@ -0,0 +1,88 @@
+#ifndef _XTB_ALLOCATOR_TRACKING_H_
+#define _XTB_ALLOCATOR_TRACKING_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/allocator.h>
+
+#include <mutex>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Tracking allocator
+ *
+ * Wraps another allocator and attributes every request to the
+ * call stack that made it. Meant to be swapped in with
+ * `allocator_set_heap` during load tests, the bookkeeping costs a
+ * stack capture and a lock per request.
+****************************************************************/
+#define TRACKING_CALLSITE_DEPTH 8
+#define TRACKING_SIZE_HISTOGRAM_BUCKETS 16
+
+struct TrackingCallsite
+{
+    uintptr_t frames[TRACKING_CALLSITE_DEPTH];
+    i32 frame_count;
+
+    i64 live_bytes;
+    i64 peak_live_bytes;
+    // Every byte requested, including each step of a realloc chain
+    i64 requested_bytes;
+
+    i64 allocation_count;
+    i64 reallocation_count;
+    i64 deallocation_count;
+
+    // Longest run of reallocations of a single block
+    i64 longest_realloc_chain;
+
+    // Bucket N counts requests of up to 16 << N bytes, the last one everything bigger
+    i64 size_histogram[TRACKING_SIZE_HISTOGRAM_BUCKETS];
+};
+
+struct TrackingLiveAllocation
+{
+    void *ptr;
+    i64 size;
+    i64 realloc_chain;
+    isize callsite_index;
+};
+
+struct TrackingAllocator
+{
+    Allocator allocator;
+    Allocator *backing;
+
+    i64 live_bytes;
+    i64 peak_live_bytes;
+    i64 allocation_count;
+    i64 reallocation_count;
+    i64 deallocation_count;
+
+    // Bookkeeping lives in malloc memory so it never shows up in the report.
+    // Callsites are stored densely so live allocations can refer to them by
+    // index, `callsite_slots` is the open-addressed index over them.
+    TrackingCallsite *callsites;
+    isize callsite_count;
+    isize callsite_capacity;
+
+    isize *callsite_slots;
+    isize callsite_slot_capacity;
+
+    TrackingLiveAllocation *live;
+    isize live_count;
+    isize live_capacity;
+
+    std::mutex lock;
+};
+
+TrackingAllocator *tracking_allocator_new(Allocator *backing);
+void tracking_allocator_release(TrackingAllocator *tracker);
+
+// Logs totals and the `top_count` callsites with the highest peak live bytes
+void tracking_allocator_dump(TrackingAllocator *tracker, isize top_count);
+
+}
+
+#endif // _XTB_ALLOCATOR_TRACKING_H_
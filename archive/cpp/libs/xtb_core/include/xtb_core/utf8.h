@@ -0,0 +1,135 @@
+#ifndef _XTB_UTF8_H_
+#define _XTB_UTF8_H_
+
+#include <xtb_core/core.h>
+#include <xtb_core/string.h>
+
+namespace xtb
+{
+
+/****************************************************************
+ * UTF-8 validation
+ *
+ * Strict validation per the Unicode standard: no overlong forms,
+ * no surrogates, nothing above U+10FFFF, no truncated sequences.
+ * Uses an AVX2 kernel when the CPU has one, otherwise a scalar
+ * loop that still skips ASCII runs a word at a time.
+****************************************************************/
+#define UTF8_MAX_CODEPOINT 0x10FFFF
+#define UTF8_REPLACEMENT_CHARACTER 0xFFFD
+
+// Offset of the first byte of the first ill-formed sequence, or -1 if it's all valid
+isize utf8_find_invalid(const void *data, isize size);
+
+inline bool utf8_is_valid(const void *data, isize size)
+{
+    return utf8_find_invalid(data, size) == -1;
+}
+
+inline bool utf8_is_valid(String string)
+{
+    return utf8_find_invalid(string.data(), string.len()) == -1;
+}
+
+// Name of the validator in use: "avx2" or "scalar"
+const char *utf8_validate_backend(void);
+
+/****************************************************************
+ * Decoding and encoding
+****************************************************************/
+// Decodes the sequence at the start of data[0, size), which must not be empty.
+// Returns its length in bytes, or 0 with `codepoint` set to the replacement
+// character if it's ill-formed
+isize utf8_decode(const u8 *data, isize size, u32 *codepoint);
+
+// Writes 1 to 4 bytes and returns how many, 0 for surrogates and out of range values
+isize utf8_encode(u32 codepoint, u8 *out);
+
+inline bool utf8_is_continuation(u8 c)
+{
+    return (c & 0xC0) == 0x80;
+}
+
+/****************************************************************
+ * Codepoint iteration
+ *
+ *     for (u32 codepoint : utf8_codepoints(string)) ...
+ *
+ * Ill-formed bytes come out as U+FFFD one at a time, so iterating
+ * never fails and always reaches the end.
+****************************************************************/
+struct Utf8Iterator
+{
+    String rest;
+
+    bool next(u32 *codepoint)
+    {
+        if (this->rest.is_empty()) return false;
+
+        const u8 *data = this->rest.data();
+        isize len = 1;
+        if (data[0] < 0x80)
+        {
+            *codepoint = data[0];
+        }
+        else
+        {
+            len = Max(utf8_decode(data, this->rest.len(), codepoint), (isize)1);
+        }
+
+        this->rest = String((u8 *)data + len, this->rest.len() - len);
+        return true;
+    }
+
+    struct Cursor
+    {
+        Utf8Iterator *iterator;
+        u32 codepoint;
+        bool done;
+
+        u32 operator*() const { return this->codepoint; }
+
+        Cursor& operator++()
+        {
+            this->done = !this->iterator->next(&this->codepoint);
+            return *this;
+        }
+
+        bool operator!=(const Cursor& other) const { return this->done != other.done; }
+    };
+
+    Cursor begin()
+    {
+        Cursor cursor = { this, 0, false };
+        return ++cursor;
+    }
+
+    Cursor end()
+    {
+        return Cursor { this, 0, true };
+    }
+};
+
+inline Utf8Iterator utf8_codepoints(String string)
+{
+    return Utf8Iterator { string };
+}
+
+/****************************************************************
+ * Counting and display width
+****************************************************************/
+// Number of codepoints in valid UTF-8, which is the number of bytes that
+// aren't continuation bytes. Ill-formed input gets a count, not a precise one
+isize utf8_count_codepoints(String string);
+
+// Terminal columns a codepoint takes up, like wcwidth: 0 for control characters
+// and combining marks, 2 for East Asian wide and fullwidth characters and emoji,
+// 1 for everything else. Based on range tables, not the full Unicode database
+i32 utf8_codepoint_width(u32 codepoint);
+
+// Sum of the codepoint widths, ill-formed bytes count as one column each
+isize utf8_width(String string);
+
+}
+
+#endif // _XTB_UTF8_H_
@@ -1,4 +1,5 @@
 #include <xtb_core/allocator.h>
+#include <xtb_core/pool.h>
 #include <xtb_core/contract.h>
 #include <string.h>
 #include <stdlib.h>
@@ -66,6 +67,7 @@ static void init_allocator_set(void)
 void allocators_init(void)
 {
     g_malloc_allocator = malloc_allocator_procedure;
+    pool_allocator_init();
     init_allocator_set();
 }
 
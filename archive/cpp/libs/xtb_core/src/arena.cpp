@@ -1,22 +1,47 @@
 #include <xtb_core/arena.h>
 #include <xtb_core/contract.h>
+#include <xtb_core/linked_list.h>
+#include <xtb_core/logger.h>
 
+#include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 
+#if OS_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace xtb
 {
 
 /****************************
  * Internals
  ***************************/
+struct ArenaRegistry
+{
+    std::mutex lock;
+    Arena *first;
+    Arena *last;
+};
+
+ArenaRegistry g_arena_registry;
+
 void* arena_allocator_procedure(void* alloc, int64_t new_size, void* old_ptr, int64_t old_size, int64_t align)
 {
     Assert(new_size >= 0 && old_size >= 0 && align >= 0);
 
     Arena *arena = (Arena*)alloc;
+    size_t alignment = align > 0 ? (size_t)align : ARENA_DEFAULT_ALIGNMENT;
+
+    // The most recent allocation can grow, shrink and be freed in place
+    if (old_ptr != NULL && old_size > 0 && ((uintptr_t)old_ptr & (alignment - 1)) == 0
+        && arena_resize_in_place(arena, old_ptr, old_size, new_size))
+    {
+        return new_size > 0 ? old_ptr : NULL;
+    }
 
     // Arena never frees individual allocations
     if (new_size == 0)
@@ -24,7 +49,7 @@ void* arena_allocator_procedure(void* alloc, int64_t new_size, void* old_ptr, in
         return NULL;
     }
 
-    void* new_ptr = arena_alloc(arena, new_size);
+    void* new_ptr = arena_alloc_aligned(arena, new_size, alignment);
     if (new_ptr == NULL) return NULL;
 
     // It's realloc, copy the contents
@@ -36,18 +61,22 @@ void* arena_allocator_procedure(void* alloc, int64_t new_size, void* old_ptr, in
     return new_ptr;
 }
 
-static void arena_free_chunks_after(ArenaChunkHeader *chunk)
+static i64 arena_free_chunks_after(ArenaChunkHeader *chunk)
 {
     ArenaChunkHeader *chunk_iter = chunk->next;
     chunk->next = NULL;
 
+    i64 freed_count = 0;
     while (chunk_iter != NULL)
     {
         ArenaChunkHeader *current = chunk_iter;
         chunk_iter = chunk_iter->next;
 
         free(current);
+        freed_count += 1;
     }
+
+    return freed_count;
 }
 
 static void *chunk_buffer(ArenaChunkHeader *header)
@@ -55,6 +84,18 @@ static void *chunk_buffer(ArenaChunkHeader *header)
     return (char *)header + sizeof(ArenaChunkHeader);
 }
 
+static bool is_valid_alignment(size_t alignment)
+{
+    return alignment != 0 && (alignment & (alignment - 1)) == 0;
+}
+
+static size_t chunk_alignment_padding(ArenaChunkHeader *chunk, size_t alignment)
+{
+    uintptr_t address = (uintptr_t)chunk_buffer(chunk) + chunk->offset;
+    uintptr_t aligned_address = (address + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+    return aligned_address - address;
+}
+
 static size_t determine_chunk_size(Arena *arena, size_t allocation_size)
 {
     return allocation_size > arena->base_size
@@ -84,6 +125,34 @@ static void arena_grow(Arena *arena, size_t allocation_size)
 
     arena->current_chunk->next = new_chunk;
     arena->current_chunk = new_chunk;
+    arena->chunk_allocation_count += 1;
+}
+
+static void arena_note_used_size(Arena *arena, size_t used_size)
+{
+    arena->used_size = used_size;
+    arena->peak_used_size = Max(arena->peak_used_size, used_size);
+}
+
+static void arena_register(Arena *arena)
+{
+    arena->name = NULL;
+    arena->used_size = 0;
+    arena->peak_used_size = 0;
+    arena->allocation_count = 0;
+    arena->chunk_allocation_count = 0;
+    arena->temp_release_chunk_free_count = 0;
+    arena->registry_prev = NULL;
+    arena->registry_next = NULL;
+
+    std::lock_guard<std::mutex> guard(g_arena_registry.lock);
+    DLLPushBack_NP(g_arena_registry.first, g_arena_registry.last, arena, registry_next, registry_prev);
+}
+
+static void arena_unregister(Arena *arena)
+{
+    std::lock_guard<std::mutex> guard(g_arena_registry.lock);
+    DLLRemove_NP(g_arena_registry.first, g_arena_registry.last, arena, registry_next, registry_prev);
 }
 
 static void *arena_alloc_in_chunk(ArenaChunkHeader *chunk, size_t allocation_size)
@@ -93,6 +162,70 @@ static void *arena_alloc_in_chunk(ArenaChunkHeader *chunk, size_t allocation_siz
     return allocation;
 }
 
+static size_t round_up_to(size_t value, size_t granularity)
+{
+    return (value + granularity - 1) / granularity * granularity;
+}
+
+static size_t arena_virtual_commit_granularity()
+{
+#if OS_LINUX
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    return round_up_to(ARENA_VIRTUAL_COMMIT_GRANULARITY, page_size);
+#else
+    return ARENA_VIRTUAL_COMMIT_GRANULARITY;
+#endif
+}
+
+// Makes sure the first `size` bytes of the reservation are accessible
+static bool arena_virtual_commit(Arena *arena, size_t size)
+{
+    if (size <= arena->committed_size) return true;
+
+    size_t new_committed_size = ClampTop(round_up_to(size, arena_virtual_commit_granularity()),
+                                         arena->reserved_size);
+
+#if OS_LINUX
+    char *commit_begin = (char *)arena + arena->committed_size;
+    size_t commit_size = new_committed_size - arena->committed_size;
+    if (mprotect(commit_begin, commit_size, PROT_READ | PROT_WRITE) != 0)
+    {
+        return false;
+    }
+#endif
+
+    arena->committed_size = new_committed_size;
+    return true;
+}
+
+// Gives back the committed pages past the high-water mark of the current offset
+static void arena_virtual_decommit_excess(Arena *arena)
+{
+    if (arena->decommit_threshold == 0) return;
+
+    size_t used_size = ARENA_BOOTSTRAP_OVERHEAD + arena->base_chunk->offset;
+    size_t keep_size = round_up_to(used_size + arena->decommit_threshold,
+                                   arena_virtual_commit_granularity());
+
+    if (keep_size >= arena->committed_size) return;
+
+#if OS_LINUX
+    char *decommit_begin = (char *)arena + keep_size;
+    size_t decommit_size = arena->committed_size - keep_size;
+    madvise(decommit_begin, decommit_size, MADV_DONTNEED);
+    mprotect(decommit_begin, decommit_size, PROT_NONE);
+#endif
+
+    arena->committed_size = keep_size;
+}
+
+// Virtual arenas commit pages while they allocate from their reservation, not once
+// they've moved on to malloc'd chunks
+static bool arena_is_in_reservation(Arena *arena)
+{
+    return arena->backend == ARENA_BACKEND_VIRTUAL && arena->current_chunk == arena->base_chunk;
+}
+
 static bool arena_next_chunk_can_hold_allocation(Arena *arena, size_t allocation_size)
 {
     ArenaChunkHeader *next_chunk = arena->current_chunk->next;
@@ -121,9 +254,57 @@ Arena *arena_new(size_t buffer_size)
     arena->base_chunk = chunk_header;
     arena->current_chunk = chunk_header;
     arena->base_size = buffer_size;
+    arena->padding = 0;
+    arena->backend = ARENA_BACKEND_MALLOC;
+    arena->reserved_size = 0;
+    arena->committed_size = 0;
+    arena->decommit_threshold = 0;
+    arena->allocator = arena_allocator_procedure;
+    arena_register(arena);
+
+    return arena;
+}
+
+Arena *arena_new_virtual(size_t reserve_size, size_t decommit_threshold)
+{
+#if OS_LINUX
+    size_t granularity = arena_virtual_commit_granularity();
+    reserve_size = round_up_to(ClampBot(reserve_size, granularity), granularity);
+
+    void *reservation = mmap(NULL, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation == MAP_FAILED) return NULL;
+
+    if (mprotect(reservation, granularity, PROT_READ | PROT_WRITE) != 0)
+    {
+        munmap(reservation, reserve_size);
+        return NULL;
+    }
+
+    const size_t chunk_header_offset = sizeof(Arena);
+
+    ArenaChunkHeader *chunk_header = (ArenaChunkHeader *)((char *)reservation + chunk_header_offset);
+    chunk_header->capacity = reserve_size - ARENA_BOOTSTRAP_OVERHEAD;
+    chunk_header->offset = 0;
+    chunk_header->next = NULL;
+
+    Arena *arena = (Arena *)reservation;
+    arena->base_chunk = chunk_header;
+    arena->current_chunk = chunk_header;
+    // Only sizes the chunks the arena overflows into
+    arena->base_size = granularity;
+    arena->padding = 0;
+    arena->backend = ARENA_BACKEND_VIRTUAL;
+    arena->reserved_size = reserve_size;
+    arena->committed_size = granularity;
+    arena->decommit_threshold = decommit_threshold;
     arena->allocator = arena_allocator_procedure;
+    arena_register(arena);
 
     return arena;
+#else
+    Unused(decommit_threshold);
+    return arena_new(ClampTop(reserve_size, ARENA_VIRTUAL_COMMIT_GRANULARITY));
+#endif
 }
 
 Arena *arena_new_exact_size(size_t arena_size)
@@ -133,7 +314,18 @@ Arena *arena_new_exact_size(size_t arena_size)
 
 void arena_release(Arena *arena)
 {
+    arena_unregister(arena);
+
     arena_free_chunks_after(arena->base_chunk);
+
+#if OS_LINUX
+    if (arena->backend == ARENA_BACKEND_VIRTUAL)
+    {
+        munmap(arena, arena->reserved_size);
+        return;
+    }
+#endif
+
     free(arena);
 }
 
@@ -141,13 +333,36 @@ bool arena_chunk_has_enough_capacity(ArenaChunkHeader *chunk, size_t allocation_
 {
     return chunk->offset + allocation_size <= chunk->capacity;
 }
-//
-// TODO: deal with alignment
+
 void *arena_alloc(Arena *arena, size_t allocation_size)
 {
-    if (!arena_chunk_has_enough_capacity(arena->current_chunk, allocation_size))
+    return arena_alloc_aligned(arena, allocation_size, 1);
+}
+
+void *arena_alloc_zero(Arena *arena, size_t allocation_size)
+{
+    return arena_alloc_aligned_zero(arena, allocation_size, 1);
+}
+
+void *arena_alloc_aligned(Arena *arena, size_t allocation_size, size_t alignment)
+{
+    Assert(is_valid_alignment(alignment));
+
+    size_t padding = chunk_alignment_padding(arena->current_chunk, alignment);
+
+    bool fits = arena_chunk_has_enough_capacity(arena->current_chunk, padding + allocation_size);
+    if (fits && arena_is_in_reservation(arena))
     {
-        if (arena_next_chunk_can_hold_allocation(arena, allocation_size))
+        size_t end = ARENA_BOOTSTRAP_OVERHEAD + arena->current_chunk->offset + padding + allocation_size;
+        fits = arena_virtual_commit(arena, end);
+    }
+
+    if (!fits)
+    {
+        // A fresh chunk's buffer may be aligned arbitrarily, so reserve room for the worst case
+        size_t worst_case_size = allocation_size + alignment - 1;
+
+        if (arena_next_chunk_can_hold_allocation(arena, worst_case_size))
         {
             // Reuse already available chunk
             arena->current_chunk = arena->current_chunk->next;
@@ -155,17 +370,61 @@ void *arena_alloc(Arena *arena, size_t allocation_size)
         else
         {
             arena_free_chunks_after(arena->current_chunk);
-            arena_grow(arena, allocation_size);
+            arena_grow(arena, worst_case_size);
         }
+
+        padding = chunk_alignment_padding(arena->current_chunk, alignment);
     }
 
+    arena->current_chunk->offset += padding;
+    arena->padding += padding;
+    arena->allocation_count += 1;
+    arena_note_used_size(arena, arena->used_size + padding + allocation_size);
+
     return arena_alloc_in_chunk(arena->current_chunk, allocation_size);
 }
 
-void *arena_alloc_zero(Arena *arena, size_t allocation_size)
+bool arena_is_last_allocation(Arena *arena, void *ptr, size_t size)
+{
+    ArenaChunkHeader *chunk = arena->current_chunk;
+    char *top = (char *)chunk_buffer(chunk) + chunk->offset;
+    return chunk->offset >= size && (char *)ptr + size == top;
+}
+
+bool arena_resize_in_place(Arena *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    if (!arena_is_last_allocation(arena, ptr, old_size)) return false;
+
+    ArenaChunkHeader *chunk = arena->current_chunk;
+
+    if (new_size <= old_size)
+    {
+        chunk->offset -= old_size - new_size;
+        arena->used_size -= old_size - new_size;
+        return true;
+    }
+
+    size_t growth = new_size - old_size;
+    if (!arena_chunk_has_enough_capacity(chunk, growth)) return false;
+
+    if (arena_is_in_reservation(arena)
+        && !arena_virtual_commit(arena, ARENA_BOOTSTRAP_OVERHEAD + chunk->offset + growth))
+    {
+        return false;
+    }
+
+    chunk->offset += growth;
+    arena_note_used_size(arena, arena->used_size + growth);
+    return true;
+}
+
+void *arena_alloc_aligned_zero(Arena *arena, size_t allocation_size, size_t alignment)
 {
-    void *result = arena_alloc(arena, allocation_size);
-    memset(result, 0, allocation_size);
+    void *result = arena_alloc_aligned(arena, allocation_size, alignment);
+    if (result != NULL)
+    {
+        memset(result, 0, allocation_size);
+    }
     return result;
 }
 
@@ -179,6 +438,13 @@ void arena_clear(Arena *arena)
     }
 
     arena->current_chunk = arena->base_chunk;
+    arena->padding = 0;
+    arena->used_size = 0;
+
+    if (arena->backend == ARENA_BACKEND_VIRTUAL)
+    {
+        arena_virtual_decommit_excess(arena);
+    }
 }
 
 /****************************
@@ -190,6 +456,8 @@ TempArena temp_arena_new(Arena *arena)
     temp.arena = arena;
     temp.snapshot.chunk = arena->current_chunk;
     temp.snapshot.offset = arena->current_chunk->offset;
+    temp.snapshot.padding = arena->padding;
+    temp.snapshot.used_size = arena->used_size;
 
     return temp;
 }
@@ -199,11 +467,18 @@ void temp_arena_release(TempArena temp)
     Arena *arena = temp.arena;
     arena->current_chunk = temp.snapshot.chunk;
     arena->current_chunk->offset = temp.snapshot.offset;
+    arena->padding = temp.snapshot.padding;
+    arena->used_size = temp.snapshot.used_size;
+
+    if (arena_is_in_reservation(arena))
+    {
+        arena_virtual_decommit_excess(arena);
+    }
 
     if (arena->current_chunk->next)
     {
         arena->current_chunk->next->offset = 0;
-        arena_free_chunks_after(arena->current_chunk->next);
+        arena->temp_release_chunk_free_count += arena_free_chunks_after(arena->current_chunk->next);
     }
 }
 
@@ -225,6 +500,11 @@ size_t arena_dump_memory_usage(Arena *arena)
     return total_usage;
 }
 
+size_t arena_dump_padding_usage(Arena *arena)
+{
+    return arena->padding;
+}
+
 /// pretty print memory usage
 size_t arena_dump_memory_usage_pp(Arena *arena, char *buffer, size_t buffer_size)
 {
@@ -255,5 +535,142 @@ size_t arena_dump_memory_usage_pp(Arena *arena, char *buffer, size_t buffer_size
     return usage;
 }
 
+/****************************
+ * Arena Statistics
+ ***************************/
+void arena_set_name(Arena *arena, const char *name)
+{
+    arena->name = name;
 }
 
+// Committed bytes a chunk's buffer can hold. A virtual arena's base chunk spans
+// the whole reservation, of which only the committed part counts
+static size_t arena_chunk_committed_capacity(Arena *arena, ArenaChunkHeader *chunk)
+{
+    if (arena->backend == ARENA_BACKEND_VIRTUAL && chunk == arena->base_chunk)
+    {
+        return arena->committed_size - ARENA_BOOTSTRAP_OVERHEAD;
+    }
+    return chunk->capacity;
+}
+
+void arena_for_each_chunk(Arena *arena, ArenaChunkVisitor visitor, void *user_data)
+{
+    bool past_current_chunk = false;
+    for (ArenaChunkHeader *chunk = arena->base_chunk;
+         chunk != NULL;
+         chunk = chunk->next)
+    {
+        ArenaChunkStats chunk_stats = {};
+        chunk_stats.capacity = arena_chunk_committed_capacity(arena, chunk);
+        chunk_stats.used_size = chunk->offset;
+        chunk_stats.is_current = chunk == arena->current_chunk;
+
+        if (chunk_stats.is_current)
+        {
+            past_current_chunk = true;
+        }
+        else if (!past_current_chunk)
+        {
+            chunk_stats.wasted_tail_size = chunk_stats.capacity - chunk->offset;
+        }
+
+        visitor(&chunk_stats, user_data);
+    }
+}
+
+static void arena_stats_add_chunk(const ArenaChunkStats *chunk_stats, void *user_data)
+{
+    ArenaStats *stats = (ArenaStats *)user_data;
+
+    stats->chunk_count += 1;
+    stats->committed_size += sizeof(ArenaChunkHeader) + chunk_stats->capacity;
+    stats->wasted_tail_size += chunk_stats->wasted_tail_size;
+    stats->largest_wasted_tail_size = Max(stats->largest_wasted_tail_size, chunk_stats->wasted_tail_size);
+}
+
+ArenaStats arena_get_stats(Arena *arena)
+{
+    ArenaStats stats = {};
+    stats.name = arena->name;
+    stats.backend = arena->backend;
+    stats.used_size = arena->used_size;
+    stats.padding_size = arena->padding;
+    stats.peak_used_size = arena->peak_used_size;
+    stats.allocation_count = arena->allocation_count;
+    stats.chunk_allocation_count = arena->chunk_allocation_count;
+    stats.temp_release_chunk_free_count = arena->temp_release_chunk_free_count;
+
+    arena_for_each_chunk(arena, arena_stats_add_chunk, &stats);
+    stats.committed_size += sizeof(Arena);
+
+    return stats;
+}
+
+void arena_reset_stats(Arena *arena)
+{
+    arena->peak_used_size = arena->used_size;
+    arena->allocation_count = 0;
+    arena->chunk_allocation_count = 0;
+    arena->temp_release_chunk_free_count = 0;
+}
+
+void arena_registry_for_each(ArenaVisitor visitor, void *user_data)
+{
+    std::lock_guard<std::mutex> guard(g_arena_registry.lock);
+
+    for (Arena *arena = g_arena_registry.first;
+         arena != NULL;
+         arena = arena->registry_next)
+    {
+        visitor(arena, user_data);
+    }
+}
+
+struct ArenaRegistrySnapshot
+{
+    Arena *arena;
+    ArenaStats stats;
+};
+
+void arena_registry_dump(void)
+{
+    // Snapshot under the lock and log after, so that logging never runs with
+    // arena creation and release blocked on it
+    ArenaRegistrySnapshot *snapshots = NULL;
+    isize count = 0;
+    {
+        std::lock_guard<std::mutex> guard(g_arena_registry.lock);
+
+        isize capacity = 0;
+        for (Arena *arena = g_arena_registry.first; arena != NULL; arena = arena->registry_next)
+        {
+            capacity += 1;
+        }
+
+        snapshots = (ArenaRegistrySnapshot *)malloc(sizeof(ArenaRegistrySnapshot) * Max(capacity, (isize)1));
+        if (snapshots == NULL) return;
+
+        for (Arena *arena = g_arena_registry.first; arena != NULL; arena = arena->registry_next)
+        {
+            snapshots[count].arena = arena;
+            snapshots[count].stats = arena_get_stats(arena);
+            count += 1;
+        }
+    }
+
+    for (isize i = 0; i < count; i += 1)
+    {
+        ArenaStats *stats = &snapshots[i].stats;
+        LOG_INFO("arena %s (%p): %zu/%zu bytes used, peak %zu, %lli chunks, "
+                 "%zu wasted in tails (largest %zu), %lli allocs, %lli chunk allocs, %lli temp release frees",
+                 stats->name != NULL ? stats->name : "<unnamed>", (void *)snapshots[i].arena,
+                 stats->used_size, stats->committed_size, stats->peak_used_size, (lli)stats->chunk_count,
+                 stats->wasted_tail_size, stats->largest_wasted_tail_size, (lli)stats->allocation_count,
+                 (lli)stats->chunk_allocation_count, (lli)stats->temp_release_chunk_free_count);
+    }
+
+    free(snapshots);
+}
+
+}
@@ -8,12 +8,23 @@
 #define register_signal_handlers(...)
 #endif
 
+#include "string_search.cpp"
+#include "utf8.cpp"
 #include "string.cpp"
+#include "parse_number.cpp"
+#include "format.cpp"
+#include "string_builder.cpp"
+#include "escape.cpp"
+#include "hash.cpp"
+#include "string_interner.cpp"
 #include "arena.cpp"
+#include "shared_arena.cpp"
 #include "thread_context.cpp"
 #include "allocator.cpp"
+#include "pool.cpp"
 #include "array.cpp"
 #include "stacktrace/stacktrace.cpp"
+#include "tracking_allocator.cpp"
 #include "logger.cpp"
 #include "panic.cpp"
 
@@ -0,0 +1,395 @@
+#include <xtb_core/escape.h>
+#include <xtb_core/string_search.h>
+#include <xtb_core/utf8.h>
+#include <xtb_core/contract.h>
+
+#include <string.h>
+
+#if ARCH_X64
+#include <emmintrin.h>
+#define ESCAPE_SSE2 1
+#else
+#define ESCAPE_SSE2 0
+#endif
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+// Marks bytes written as the dialect's numeric escape in EscapeTable::replacement
+#define ESCAPE_NUMERIC 1
+// Longest sequence a single byte turns into, \u00XX
+#define ESCAPE_MAX_SEQUENCE 6
+
+struct EscapeTable
+{
+    // 0 when the byte is copied as is, ESCAPE_NUMERIC, or the character that follows
+    // the backslash
+    u8 replacement[256];
+    // Bytes written for each input byte
+    u8 size[256];
+};
+
+static constexpr EscapeTable escape_make_table(EscapeDialect dialect)
+{
+    EscapeTable table = {};
+    for (i32 c = 0; c < 256; ++c)
+    {
+        table.size[c] = 1;
+        if (c < 0x20 || (dialect == ESCAPE_C && c == 0x7F))
+        {
+            table.replacement[c] = ESCAPE_NUMERIC;
+            table.size[c] = dialect == ESCAPE_C ? 4 : 6;
+        }
+    }
+
+    const char shared[][2] = {
+        { '\b', 'b' }, { '\f', 'f' }, { '\n', 'n' }, { '\r', 'r' }, { '\t', 't' },
+        { '"', '"' }, { '\\', '\\' },
+    };
+    for (const auto& pair : shared)
+    {
+        table.replacement[(u8)pair[0]] = (u8)pair[1];
+        table.size[(u8)pair[0]] = 2;
+    }
+
+    if (dialect == ESCAPE_C)
+    {
+        const char c_only[][2] = {
+            { '\a', 'a' }, { 0x1b, 'e' }, { '\v', 'v' }, { '\'', '\'' }, { '?', '?' },
+        };
+        for (const auto& pair : c_only)
+        {
+            table.replacement[(u8)pair[0]] = (u8)pair[1];
+            table.size[(u8)pair[0]] = 2;
+        }
+    }
+
+    return table;
+}
+
+// The other direction: character after the backslash -> byte, 0 if it's not a
+// single character escape
+static constexpr EscapeTable escape_make_unescape_table(EscapeDialect dialect)
+{
+    EscapeTable escapes = escape_make_table(dialect);
+    EscapeTable table = {};
+    for (i32 c = 0; c < 256; ++c)
+    {
+        u8 replacement = escapes.replacement[c];
+        if (replacement > ESCAPE_NUMERIC) table.replacement[replacement] = (u8)c;
+    }
+
+    if (dialect == ESCAPE_JSON) table.replacement['/'] = '/';
+    return table;
+}
+
+static constexpr EscapeTable g_escape_tables[] = {
+    escape_make_table(ESCAPE_C),
+    escape_make_table(ESCAPE_JSON),
+};
+
+static constexpr EscapeTable g_unescape_tables[] = {
+    escape_make_unescape_table(ESCAPE_C),
+    escape_make_unescape_table(ESCAPE_JSON),
+};
+
+// Offset of the first byte from `start` on that needs escaping, `size` if none does
+static isize escape_find_next(const u8 *data, isize size, isize start, EscapeDialect dialect)
+{
+    isize i = start;
+
+#if ESCAPE_SSE2
+    // Control characters are the bytes that saturate to 0 when 0x1F is subtracted,
+    // the rest are compared one by one. JSON repeats the quote for the unused slots
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i extra1 = _mm_set1_epi8(dialect == ESCAPE_C ? '\'' : '"');
+    const __m128i extra2 = _mm_set1_epi8(dialect == ESCAPE_C ? '?' : '"');
+    const __m128i extra3 = _mm_set1_epi8(dialect == ESCAPE_C ? 0x7F : '"');
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+
+        __m128i matches = _mm_cmpeq_epi8(_mm_subs_epu8(chunk, control_max), zero);
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, quote));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, backslash));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, extra1));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, extra2));
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, extra3));
+
+        u32 mask = (u32)_mm_movemask_epi8(matches);
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+#endif
+
+    const EscapeTable *table = &g_escape_tables[dialect];
+    for (; i < size; ++i)
+    {
+        if (table->replacement[data[i]] != 0) return i;
+    }
+    return size;
+}
+
+static isize escape_write_sequence(u8 *out, u8 c, EscapeDialect dialect)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    u8 replacement = g_escape_tables[dialect].replacement[c];
+    out[0] = '\\';
+    if (replacement != ESCAPE_NUMERIC)
+    {
+        out[1] = replacement;
+        return 2;
+    }
+
+    // Octal always gets three digits so a digit after it can't be read as part of it
+    if (dialect == ESCAPE_C)
+    {
+        out[1] = (u8)('0' + (c >> 6));
+        out[2] = (u8)('0' + ((c >> 3) & 7));
+        out[3] = (u8)('0' + (c & 7));
+        return 4;
+    }
+
+    out[1] = 'u';
+    out[2] = '0';
+    out[3] = '0';
+    out[4] = (u8)hex_digits[c >> 4];
+    out[5] = (u8)hex_digits[c & 15];
+    return 6;
+}
+
+static bool escape_parse_hex(const u8 *data, isize count, u32 *value)
+{
+    u32 result = 0;
+    for (isize i = 0; i < count; ++i)
+    {
+        u8 c = data[i];
+        u32 digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') digit = (c | 0x20) - 'a' + 10;
+        else return false;
+
+        result = (result << 4) | digit;
+    }
+
+    *value = result;
+    return true;
+}
+
+static bool escape_is_hex_digit(u8 c)
+{
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+static bool escape_is_surrogate(u32 codepoint)
+{
+    return codepoint >= 0xD800 && codepoint <= 0xDFFF;
+}
+
+// Decodes the escape sequence at the start of `data`, which begins with the
+// backslash. Returns how many input bytes it took, 0 if it's malformed
+static isize unescape_sequence(const u8 *data, isize size, EscapeDialect dialect, u8 **out)
+{
+    if (size < 2) return 0;
+
+    u8 c = data[1];
+    u8 simple = g_unescape_tables[dialect].replacement[c];
+    if (simple != 0)
+    {
+        *(*out)++ = simple;
+        return 2;
+    }
+
+    u32 codepoint;
+    isize len;
+    if (c == 'u')
+    {
+        if (size < 6 || !escape_parse_hex(data + 2, 4, &codepoint)) return 0;
+        len = 6;
+
+        // JSON spells codepoints above the BMP as UTF-16 surrogate pairs
+        if (dialect == ESCAPE_JSON && codepoint >= 0xD800 && codepoint <= 0xDBFF)
+        {
+            u32 low;
+            if (size < 12 || data[6] != '\\' || data[7] != 'u' || !escape_parse_hex(data + 8, 4, &low)
+                || low < 0xDC00 || low > 0xDFFF)
+            {
+                return 0;
+            }
+
+            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+            len = 12;
+        }
+    }
+    else if (dialect == ESCAPE_C && c == 'U')
+    {
+        if (size < 10 || !escape_parse_hex(data + 2, 8, &codepoint)) return 0;
+        len = 10;
+    }
+    else if (dialect == ESCAPE_C && c == 'x')
+    {
+        isize digits = 0;
+        while (digits < 2 && 2 + digits < size && escape_is_hex_digit(data[2 + digits])) digits += 1;
+        if (digits == 0 || !escape_parse_hex(data + 2, digits, &codepoint)) return 0;
+
+        *(*out)++ = (u8)codepoint;
+        return 2 + digits;
+    }
+    else if (dialect == ESCAPE_C && c >= '0' && c <= '7')
+    {
+        isize digits = 0;
+        u32 value = 0;
+        while (digits < 3 && 1 + digits < size && data[1 + digits] >= '0' && data[1 + digits] <= '7')
+        {
+            value = (value << 3) | (u32)(data[1 + digits] - '0');
+            digits += 1;
+        }
+        if (value > 0xFF) return 0;
+
+        *(*out)++ = (u8)value;
+        return 1 + digits;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (escape_is_surrogate(codepoint)) return 0;
+
+    isize written = utf8_encode(codepoint, *out);
+    if (written == 0) return 0;
+
+    *out += written;
+    return len;
+}
+
+/****************************
+ * Escape API
+ ***************************/
+isize escape_size(String string, EscapeDialect dialect)
+{
+    const u8 *data = string.data();
+    isize size = string.len();
+    const EscapeTable *table = &g_escape_tables[dialect];
+
+    isize total = size;
+    for (isize i = escape_find_next(data, size, 0, dialect); i < size;
+         i = escape_find_next(data, size, i + 1, dialect))
+    {
+        total += table->size[data[i]] - 1;
+    }
+    return total;
+}
+
+isize escape_to(u8 *out, String string, EscapeDialect dialect)
+{
+    const u8 *data = string.data();
+    isize size = string.len();
+    u8 *p = out;
+
+    isize i = 0;
+    while (i < size)
+    {
+        isize next = escape_find_next(data, size, i, dialect);
+        MemoryCopy(p, data + i, next - i);
+        p += next - i;
+        if (next == size) break;
+
+        p += escape_write_sequence(p, data[next], dialect);
+        i = next + 1;
+    }
+
+    return p - out;
+}
+
+String escape(Allocator *allocator, String string, EscapeDialect dialect)
+{
+    isize size = escape_size(string, dialect);
+    u8 *buffer = allocate_bytes(allocator, size + 1);
+    Assert(buffer != NULL);
+
+    escape_to(buffer, string, dialect);
+    buffer[size] = '\0';
+    return String(buffer, size);
+}
+
+void escape_append(StringBuf& buffer, String string, EscapeDialect dialect)
+{
+    isize size = escape_size(string, dialect);
+    escape_to(buffer.extend(size), string, dialect);
+}
+
+void escape_append(StringBuilder *builder, String string, EscapeDialect dialect)
+{
+    const u8 *data = string.data();
+    isize size = string.len();
+
+    isize i = 0;
+    while (i < size)
+    {
+        isize next = escape_find_next(data, size, i, dialect);
+        builder->append(String((u8 *)data + i, next - i));
+        if (next == size) break;
+
+        u8 sequence[ESCAPE_MAX_SEQUENCE];
+        isize sequence_len = escape_write_sequence(sequence, data[next], dialect);
+        builder->append(String(sequence, sequence_len));
+        i = next + 1;
+    }
+}
+
+/****************************
+ * Unescape API
+ ***************************/
+isize unescape_to(u8 *out, String string, EscapeDialect dialect, isize *error_offset)
+{
+    const u8 *data = string.data();
+    isize size = string.len();
+    u8 *p = out;
+
+    isize i = 0;
+    while (i < size)
+    {
+        isize next = memory_find_byte(data + i, size - i, '\\');
+        next = next < 0 ? size : i + next;
+
+        MemoryCopy(p, data + i, next - i);
+        p += next - i;
+        if (next == size) break;
+
+        isize consumed = unescape_sequence(data + next, size - next, dialect, &p);
+        if (consumed == 0)
+        {
+            if (error_offset != NULL) *error_offset = next;
+            return -1;
+        }
+        i = next + consumed;
+    }
+
+    return p - out;
+}
+
+String unescape(Allocator *allocator, String string, EscapeDialect dialect)
+{
+    u8 *buffer = allocate_bytes(allocator, string.len() + 1);
+    Assert(buffer != NULL);
+
+    isize size = unescape_to(buffer, string, dialect);
+    if (size < 0)
+    {
+        allocator_deallocate(allocator, buffer, string.len() + 1, alignof(u8));
+        return String::invalid();
+    }
+
+    buffer[size] = '\0';
+    return String(buffer, size);
+}
+
+}
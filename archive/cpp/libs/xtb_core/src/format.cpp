@@ -0,0 +1,543 @@
+#include <xtb_core/format.h>
+#include <xtb_core/contract.h>
+#include <xtb_core/panic.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <charconv>
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+// Widest width accepted in a spec, anything bigger is most likely a typo
+#define FORMAT_MAX_WIDTH 4096
+
+// Longest precision for floats, keeps the fixed notation of the largest doubles
+// within the conversion buffer
+#define FORMAT_MAX_F64_PRECISION 100
+#define FORMAT_F64_BUFFER_SIZE 512
+
+static const char g_format_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+static const u64 g_format_powers_of_10[] = {
+    1ull,
+    10ull,
+    100ull,
+    1000ull,
+    10000ull,
+    100000ull,
+    1000000ull,
+    10000000ull,
+    100000000ull,
+    1000000000ull,
+    10000000000ull,
+    100000000000ull,
+    1000000000000ull,
+    10000000000000ull,
+    100000000000000ull,
+    1000000000000000ull,
+    10000000000000000ull,
+    100000000000000000ull,
+    1000000000000000000ull,
+    10000000000000000000ull,
+};
+
+// log10 estimated from the bit length (1233 / 4096 ~ log10(2)), then corrected
+// with a single table lookup instead of dividing until the value runs out.
+// Setting the low bit makes 0 count as one digit and can't cross a power of 10
+static isize format_count_digits(u64 value)
+{
+    value |= 1;
+    isize bits = 64 - __builtin_clzll(value);
+    isize estimate = (bits * 1233) >> 12;
+    return estimate - (value < g_format_powers_of_10[estimate]) + 1;
+}
+
+// Writes `value` in a power of two base at the end of `buffer_end` and returns the view
+static String format_u64_pow2(u8 *buffer_end, u64 value, u32 shift, bool upper)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    u64 digit_mask = (1ull << shift) - 1;
+
+    u8 *p = buffer_end;
+    do
+    {
+        *--p = digits[value & digit_mask];
+        value >>= shift;
+    } while (value != 0);
+
+    return String(p, buffer_end - p);
+}
+
+static String format_integer_digits(u8 (&buffer)[64], u64 value, u8 type)
+{
+    u8 *buffer_end = buffer + sizeof(buffer);
+    switch (type)
+    {
+        case 0:
+        case 'd': return String(buffer, format_u64_decimal(buffer, value));
+        case 'x': return format_u64_pow2(buffer_end, value, 4, false);
+        case 'X': return format_u64_pow2(buffer_end, value, 4, true);
+        case 'b': return format_u64_pow2(buffer_end, value, 1, false);
+        case 'o': return format_u64_pow2(buffer_end, value, 3, false);
+        default: format_string_error("Integers only take the 'd', 'x', 'X', 'b', 'o' and 'c' types");
+    }
+}
+
+static void format_write_fill(FormatBuffer *out, u8 fill, isize count)
+{
+    if (count <= 0) return;
+
+    u8 chunk[64];
+    memset(chunk, fill, Min(count, (isize)sizeof(chunk)));
+
+    while (count > 0)
+    {
+        isize chunk_len = Min(count, (isize)sizeof(chunk));
+        format_write(out, chunk, chunk_len);
+        count -= chunk_len;
+    }
+}
+
+// Numbers pad with zeros between the sign and the digits when asked to
+static void format_write_number(FormatBuffer *out, String sign, String digits, const FormatSpec& spec)
+{
+    if (spec.zero_pad && spec.align == 0)
+    {
+        format_write(out, sign.data(), sign.len());
+        format_write_fill(out, '0', spec.width - sign.len() - digits.len());
+        format_write(out, digits.data(), digits.len());
+        return;
+    }
+
+    if (sign.is_empty())
+    {
+        format_write_padded(out, digits, spec, '>');
+        return;
+    }
+
+    u8 buffer[FORMAT_F64_BUFFER_SIZE + 2];
+    Assert(sign.len() + digits.len() <= (isize)sizeof(buffer));
+    MemoryCopy(buffer, sign.data(), sign.len());
+    MemoryCopy(buffer + sign.len(), digits.data(), digits.len());
+    format_write_padded(out, String(buffer, sign.len() + digits.len()), spec, '>');
+}
+
+static bool format_is_align(u8 c)
+{
+    return c == '<' || c == '>' || c == '^';
+}
+
+static bool format_is_digit(u8 c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static FormatSpec format_default_spec()
+{
+    FormatSpec spec = {};
+    spec.precision = -1;
+    spec.fill = ' ';
+    return spec;
+}
+
+static FormatSpec format_parse_spec(String text)
+{
+    FormatSpec spec = format_default_spec();
+
+    const u8 *s = text.data();
+    isize len = text.len();
+    isize i = 0;
+
+    if (len >= 2 && format_is_align(s[1]))
+    {
+        spec.fill = s[0];
+        spec.align = s[1];
+        i = 2;
+    }
+    else if (len >= 1 && format_is_align(s[0]))
+    {
+        spec.align = s[0];
+        i = 1;
+    }
+
+    if (i < len && s[i] == '0')
+    {
+        spec.zero_pad = true;
+        i += 1;
+    }
+
+    for (; i < len && format_is_digit(s[i]); ++i)
+    {
+        spec.width = spec.width * 10 + (s[i] - '0');
+        if (spec.width > FORMAT_MAX_WIDTH) format_string_error("Width in format spec is too large");
+    }
+
+    if (i < len && s[i] == '.')
+    {
+        i += 1;
+        if (i == len || !format_is_digit(s[i])) format_string_error("Missing precision in format spec");
+
+        spec.precision = 0;
+        for (; i < len && format_is_digit(s[i]); ++i)
+        {
+            spec.precision = spec.precision * 10 + (s[i] - '0');
+            if (spec.precision > FORMAT_MAX_WIDTH) format_string_error("Precision in format spec is too big");
+        }
+    }
+
+    if (i < len)
+    {
+        spec.type = s[i];
+        i += 1;
+        if (strchr("dxXbocfeEgGsp", spec.type) == NULL)
+        {
+            format_string_error("Unknown type in format spec");
+        }
+    }
+
+    if (i != len) format_string_error("Malformed format spec");
+
+    return spec;
+}
+
+static void format_write_pointer(FormatBuffer *out, const void *pointer, const FormatSpec& spec)
+{
+    u8 buffer[16];
+    String digits = format_u64_pow2(buffer + sizeof(buffer), (u64)(uintptr_t)pointer, 4, false);
+    format_write_number(out, "0x", digits, spec);
+}
+
+static void format_write_arg(FormatBuffer *out, const FormatArg& arg, const FormatSpec& spec)
+{
+    switch (arg.type)
+    {
+        case FormatArg::FORMAT_ARG_BOOL:
+        {
+            if (spec.type == 0 || spec.type == 's')
+            {
+                format_write_string(out, arg.b ? String("true") : String("false"), spec);
+            }
+            else
+            {
+                format_write_u64(out, arg.b, spec);
+            }
+        } break;
+
+        case FormatArg::FORMAT_ARG_CHAR:
+        {
+            if (spec.type == 0 || spec.type == 'c')
+            {
+                format_write_padded(out, String((u8 *)&arg.c, 1), spec, '<');
+            }
+            else
+            {
+                format_write_i64(out, arg.c, spec);
+            }
+        } break;
+
+        case FormatArg::FORMAT_ARG_I64:
+        {
+            format_write_i64(out, arg.i, spec);
+        } break;
+
+        case FormatArg::FORMAT_ARG_U64:
+        {
+            format_write_u64(out, arg.u, spec);
+        } break;
+
+        case FormatArg::FORMAT_ARG_F64:
+        {
+            format_write_f64(out, arg.f, spec);
+        } break;
+
+        case FormatArg::FORMAT_ARG_CSTR:
+        {
+            if (spec.type == 'p')
+            {
+                format_write_pointer(out, arg.cstr, spec);
+            }
+            else
+            {
+                String string = arg.cstr != NULL ? String::from_cstr(arg.cstr) : String("(null)");
+                format_write_string(out, string, spec);
+            }
+        } break;
+
+        case FormatArg::FORMAT_ARG_STRING:
+        {
+            format_write_string(out, String((u8 *)arg.string.data, arg.string.len), spec);
+        } break;
+
+        case FormatArg::FORMAT_ARG_POINTER:
+        {
+            if (spec.type != 0 && spec.type != 'p') format_string_error("Pointers only take 'p'");
+            format_write_pointer(out, arg.pointer, spec);
+        } break;
+
+        case FormatArg::FORMAT_ARG_CUSTOM:
+        {
+            arg.custom.proc(out, arg.custom.value, spec);
+        } break;
+
+        case FormatArg::FORMAT_ARG_NONE:
+        {
+            Unreachable;
+        } break;
+    }
+}
+
+/****************************
+ * Format engine
+ ***************************/
+isize format_u64_decimal(u8 *out, u64 value)
+{
+    isize len = format_count_digits(value);
+
+    // Two digits per division, written back to front
+    u8 *p = out + len;
+    while (value >= 100)
+    {
+        u64 pair = (value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        MemoryCopy(p, g_format_digit_pairs + pair, 2);
+    }
+
+    if (value >= 10)
+    {
+        p -= 2;
+        MemoryCopy(p, g_format_digit_pairs + value * 2, 2);
+    }
+    else
+    {
+        *--p = (u8)('0' + value);
+    }
+
+    return len;
+}
+
+void format_write(FormatBuffer *out, const void *data, isize len)
+{
+    if (out->string_buf != NULL)
+    {
+        out->string_buf->append((const u8 *)data, len);
+    }
+    else if (out->length < out->capacity)
+    {
+        MemoryCopy(out->data + out->length, data, Min(len, out->capacity - out->length));
+    }
+
+    out->length += len;
+}
+
+void format_write_padded(FormatBuffer *out, String content, const FormatSpec& spec, u8 default_align)
+{
+    isize padding = spec.width - content.len();
+    if (padding <= 0)
+    {
+        format_write(out, content.data(), content.len());
+        return;
+    }
+
+    u8 align = spec.align != 0 ? spec.align : default_align;
+    isize left = align == '<' ? 0 : align == '^' ? padding / 2 : padding;
+
+    format_write_fill(out, spec.fill, left);
+    format_write(out, content.data(), content.len());
+    format_write_fill(out, spec.fill, padding - left);
+}
+
+void format_write_string(FormatBuffer *out, String string, const FormatSpec& spec)
+{
+    if (spec.type != 0 && spec.type != 's') format_string_error("Strings only take the 's' type");
+
+    if (spec.precision >= 0)
+    {
+        string = string.head(spec.precision);
+    }
+    format_write_padded(out, string, spec, '<');
+}
+
+void format_write_u64(FormatBuffer *out, u64 value, const FormatSpec& spec)
+{
+    if (spec.type == 'c')
+    {
+        u8 c = (u8)value;
+        format_write_padded(out, String(&c, 1), spec, '<');
+        return;
+    }
+
+    u8 buffer[64];
+    format_write_number(out, "", format_integer_digits(buffer, value, spec.type), spec);
+}
+
+void format_write_i64(FormatBuffer *out, i64 value, const FormatSpec& spec)
+{
+    if (value >= 0 || spec.type == 'c')
+    {
+        format_write_u64(out, (u64)value, spec);
+        return;
+    }
+
+    // Negating in unsigned arithmetic keeps INT64_MIN intact
+    u64 magnitude = 0 - (u64)value;
+
+    u8 buffer[64];
+    format_write_number(out, "-", format_integer_digits(buffer, magnitude, spec.type), spec);
+}
+
+void format_write_f64(FormatBuffer *out, f64 value, const FormatSpec& spec)
+{
+    char buffer[FORMAT_F64_BUFFER_SIZE];
+    char *buffer_end = buffer + sizeof(buffer);
+
+    int precision = (int)Min(spec.precision, (isize)FORMAT_MAX_F64_PRECISION);
+
+    // std::to_chars produces the shortest round-tripping digits (Ryu in both libstdc++
+    // and MSVC's STL) and never touches the locale
+    std::chars_format notation;
+    switch (spec.type)
+    {
+        case 0:   notation = std::chars_format::general; break;
+        case 'f': notation = std::chars_format::fixed; break;
+        case 'e':
+        case 'E': notation = std::chars_format::scientific; break;
+        case 'g':
+        case 'G': notation = std::chars_format::general; break;
+        default: format_string_error("Floats only take the 'f', 'e', 'E', 'g' and 'G' types");
+    }
+
+    std::to_chars_result result = spec.type == 0 && precision < 0
+        ? std::to_chars(buffer, buffer_end, value)
+        : std::to_chars(buffer, buffer_end, value, notation, precision >= 0 ? precision : 6);
+    Assert(result.ec == std::errc());
+
+    if (spec.type == 'E' || spec.type == 'G')
+    {
+        for (char *c = buffer; c < result.ptr; ++c)
+        {
+            if (*c >= 'a' && *c <= 'z') *c -= 'a' - 'A';
+        }
+    }
+
+    String text = String((u8 *)buffer, result.ptr - buffer);
+    if (text.front() == '-')
+    {
+        format_write_number(out, "-", text.trunc_left(1), spec);
+    }
+    else
+    {
+        format_write_number(out, "", text, spec);
+    }
+}
+
+void format_write_args(FormatBuffer *out, String fmt, const FormatArg *args, isize arg_count)
+{
+    const u8 *s = fmt.data();
+    isize len = fmt.len();
+
+    isize arg_index = 0;
+    isize literal_begin = 0;
+    isize i = 0;
+    while (i < len)
+    {
+        u8 c = s[i];
+        if (c != '{' && c != '}')
+        {
+            i += 1;
+            continue;
+        }
+
+        format_write(out, s + literal_begin, i - literal_begin);
+
+        // Doubled braces stand for themselves
+        if (i + 1 < len && s[i + 1] == c)
+        {
+            format_write(out, &c, 1);
+            i += 2;
+            literal_begin = i;
+            continue;
+        }
+
+        if (c == '}') format_string_error("Unmatched '}' in format string");
+
+        isize close = i + 1;
+        while (close < len && s[close] != '}')
+        {
+            close += 1;
+        }
+        if (close == len) format_string_error("Unterminated '{' in format string");
+
+        FormatSpec spec = format_default_spec();
+        String inner = fmt.substr(i + 1, close - i - 1);
+        if (!inner.is_empty())
+        {
+            if (inner.front() != ':') format_string_error("Expected ':' before the format spec");
+            spec = format_parse_spec(inner.trunc_left(1));
+        }
+
+        if (arg_index >= arg_count) format_string_error("More placeholders than arguments");
+        format_write_arg(out, args[arg_index], spec);
+        arg_index += 1;
+
+        i = close + 1;
+        literal_begin = i;
+    }
+
+    format_write(out, s + literal_begin, len - literal_begin);
+
+    if (arg_index != arg_count) format_string_error("Fewer placeholders than arguments");
+}
+
+FormatTemp format_temp(u8 *stack_buffer, isize stack_capacity, String fmt,
+                       const FormatArg *args, isize arg_count)
+{
+    Assert(stack_capacity > 0);
+
+    FormatBuffer out = FormatBuffer::from_pointer(stack_buffer, stack_capacity - 1);
+    format_write_args(&out, fmt, args, arg_count);
+    if (out.length < stack_capacity)
+    {
+        stack_buffer[out.length] = '\0';
+        return FormatTemp { String(stack_buffer, out.length), false };
+    }
+
+    // Too long for the stack, the first pass measured the exact size for the second.
+    // Straight to malloc like logger_log, the heap allocator may be what's being logged
+    // about. Keep the truncated text if that fails too
+    u8 *heap_buffer = (u8 *)malloc(out.length + 1);
+    if (heap_buffer == NULL)
+    {
+        stack_buffer[stack_capacity - 1] = '\0';
+        return FormatTemp { String(stack_buffer, stack_capacity - 1), false };
+    }
+
+    FormatBuffer heap_out = FormatBuffer::from_pointer(heap_buffer, out.length);
+    format_write_args(&heap_out, fmt, args, arg_count);
+    heap_buffer[out.length] = '\0';
+
+    return FormatTemp { String(heap_buffer, out.length), true };
+}
+
+void format_free_temp(FormatTemp temp)
+{
+    if (temp.on_heap)
+    {
+        free(temp.string.data());
+    }
+}
+
+void format_string_error(const char *message)
+{
+    panic("Invalid format string: %s", message);
+}
+
+}
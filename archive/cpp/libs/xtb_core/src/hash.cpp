@@ -0,0 +1,204 @@
+#include <xtb_core/hash.h>
+
+#include <string.h>
+
+#if COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+// Same constants as hash_const_secret in the header, the two have to agree
+static const u64 g_hash_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull,
+};
+
+// 64x64 -> 128 bit multiply, low half in `a`, high half in `b`
+static void hash_mum(u64 *a, u64 *b)
+{
+#if COMPILER_MSVC
+    *a = _umul128(*a, *b, b);
+#else
+    __uint128_t product = (__uint128_t)*a * *b;
+    *a = (u64)product;
+    *b = (u64)(product >> 64);
+#endif
+}
+
+static u64 hash_mix(u64 a, u64 b)
+{
+    hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static u64 hash_read64(const u8 *p)
+{
+    u64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static u64 hash_read32(const u8 *p)
+{
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static u64 hash_start(u64 seed)
+{
+    return seed ^ hash_mix(seed ^ g_hash_secret[0], g_hash_secret[1]);
+}
+
+// Three independent lanes so the multiplies can overlap
+static void hash_block(const u8 *p, u64 *seed, u64 *seed1, u64 *seed2)
+{
+    const u64 *secret = g_hash_secret;
+    *seed = hash_mix(hash_read64(p) ^ secret[1], hash_read64(p + 8) ^ *seed);
+    *seed1 = hash_mix(hash_read64(p + 16) ^ secret[2], hash_read64(p + 24) ^ *seed1);
+    *seed2 = hash_mix(hash_read64(p + 32) ^ secret[3], hash_read64(p + 40) ^ *seed2);
+}
+
+static u64 hash_finish(u64 a, u64 b, u64 seed, isize size)
+{
+    const u64 *secret = g_hash_secret;
+
+    a ^= secret[1];
+    b ^= seed;
+    hash_mum(&a, &b);
+
+    return hash_mix(a ^ secret[0] ^ (u64)size, b ^ secret[1]);
+}
+
+static u64 hash_small(const u8 *p, isize size, u64 seed)
+{
+    u64 a = 0;
+    u64 b = 0;
+    if (size >= 4)
+    {
+        // Two overlapping reads from each end cover every byte
+        isize middle = (size >> 3) << 2;
+        a = (hash_read32(p) << 32) | hash_read32(p + middle);
+        b = (hash_read32(p + size - 4) << 32) | hash_read32(p + size - 4 - middle);
+    }
+    else if (size > 0)
+    {
+        a = ((u64)p[0] << 16) | ((u64)p[size >> 1] << 8) | p[size - 1];
+    }
+
+    return hash_finish(a, b, seed, size);
+}
+
+// The last 1 to 48 bytes of an input longer than 16. The final read goes up to
+// 15 bytes back before `p`, which the caller keeps readable
+static u64 hash_tail(const u8 *p, isize remaining, isize size, u64 seed)
+{
+    while (remaining > 16)
+    {
+        seed = hash_mix(hash_read64(p) ^ g_hash_secret[1], hash_read64(p + 8) ^ seed);
+        p += 16;
+        remaining -= 16;
+    }
+
+    u64 a = hash_read64(p + remaining - 16);
+    u64 b = hash_read64(p + remaining - 8);
+    return hash_finish(a, b, seed, size);
+}
+
+/****************************
+ * Hash API
+ ***************************/
+u64 hash_bytes(const void *data, isize size, u64 seed)
+{
+    const u8 *p = (const u8 *)data;
+
+    seed = hash_start(seed);
+    if (size <= 16)
+    {
+        return hash_small(p, size, seed);
+    }
+
+    isize remaining = size;
+    if (remaining > HASH_BLOCK_SIZE)
+    {
+        u64 seed1 = seed;
+        u64 seed2 = seed;
+        do
+        {
+            hash_block(p, &seed, &seed1, &seed2);
+            p += HASH_BLOCK_SIZE;
+            remaining -= HASH_BLOCK_SIZE;
+        } while (remaining > HASH_BLOCK_SIZE);
+        seed ^= seed1 ^ seed2;
+    }
+
+    return hash_tail(p, remaining, size, seed);
+}
+
+/****************************
+ * Hasher API
+ ***************************/
+Hasher Hasher::init(u64 seed)
+{
+    Hasher hasher = {};
+    hasher.seed = hash_start(seed);
+    hasher.seed1 = hasher.seed;
+    hasher.seed2 = hasher.seed;
+    return hasher;
+}
+
+void Hasher::update(const void *data, isize size)
+{
+    const u8 *p = (const u8 *)data;
+    this->size += size;
+
+    u8 *pending = this->buffer + HASH_TAIL_SIZE;
+    while (size > 0)
+    {
+        // A block is only consumed once more input is known to follow it, the
+        // last one is left for finish like hash_bytes does
+        if (this->buffered == HASH_BLOCK_SIZE)
+        {
+            hash_block(pending, &this->seed, &this->seed1, &this->seed2);
+            MemoryCopy(this->buffer, pending + HASH_BLOCK_SIZE - HASH_TAIL_SIZE, HASH_TAIL_SIZE);
+            this->buffered = 0;
+        }
+
+        // Whole blocks straight from the input, without going through the buffer
+        if (this->buffered == 0 && size > HASH_BLOCK_SIZE)
+        {
+            do
+            {
+                hash_block(p, &this->seed, &this->seed1, &this->seed2);
+                p += HASH_BLOCK_SIZE;
+                size -= HASH_BLOCK_SIZE;
+            } while (size > HASH_BLOCK_SIZE);
+            MemoryCopy(this->buffer, p - HASH_TAIL_SIZE, HASH_TAIL_SIZE);
+        }
+
+        isize count = Min(size, HASH_BLOCK_SIZE - this->buffered);
+        MemoryCopy(pending + this->buffered, p, count);
+        this->buffered += count;
+        p += count;
+        size -= count;
+    }
+}
+
+u64 Hasher::finish() const
+{
+    const u8 *pending = this->buffer + HASH_TAIL_SIZE;
+    if (this->size <= 16)
+    {
+        return hash_small(pending, this->size, this->seed);
+    }
+
+    // The lanes are all still equal to seed when no block was consumed
+    u64 seed = this->seed ^ this->seed1 ^ this->seed2;
+    return hash_tail(pending, this->buffered, this->size, seed);
+}
+
+}
@@ -1,6 +1,8 @@
 #include <xtb_core/logger.h>
 #include <xtb_ansi/ansi.h>
 
+#include <stdlib.h>
+
 namespace xtb
 {
 
@@ -24,29 +26,76 @@ void logger_set_log_level(LogLevel log_level)
     g_logger.level_filter_threshold = log_level;
 }
 
-void logger_log(LogLevel level, const char *fmt, ...)
-{
-    if (level < g_logger.level_filter_threshold) return;
+// Messages longer than this are formatted again into a malloc'd buffer of the right size
+#define LOGGER_STACK_BUFFER_SIZE 1024
 
+static void logger_emit(LogLevel level, const char *message)
+{
     const char *level_str[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
     const char *level_style[] = { HBLK, HBLU, GRN, YEL, HRED, BHRED };
 
-    char buffer[1024];
-
-    va_list args;
-    va_start(args, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
-    va_end(args);
-
     if (g_logger.cb)
     {
-        g_logger.cb(level, buffer, g_logger.user_data);
+        g_logger.cb(level, message, g_logger.user_data);
     }
     else
     {
-        ansi_print_style(stderr, level_style[level], "[%s] %s", level_str[level], buffer);
+        ansi_print_style(stderr, level_style[level], "[%s] %s", level_str[level], message);
         fputs("\n", stderr);
     }
 }
 
+bool logger_is_enabled(LogLevel level)
+{
+    return level >= g_logger.level_filter_threshold;
+}
+
+void logger_log(LogLevel level, const char *fmt, ...)
+{
+    if (!logger_is_enabled(level)) return;
+
+    char buffer[LOGGER_STACK_BUFFER_SIZE];
+
+    va_list args;
+    va_list args_copy;
+    va_start(args, fmt);
+    va_copy(args_copy, args);
+
+    // Straight to malloc rather than the heap allocator, which may be what's being
+    // logged about. Keep the truncated message if that fails too
+    int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    char *heap_buffer = NULL;
+    if (len >= (int)sizeof(buffer))
+    {
+        heap_buffer = (char *)malloc(len + 1);
+        if (heap_buffer != NULL)
+        {
+            vsnprintf(heap_buffer, len + 1, fmt, args_copy);
+        }
+    }
+
+    logger_emit(level, heap_buffer != NULL ? heap_buffer : buffer);
+    free(heap_buffer);
+
+    va_end(args_copy);
+    va_end(args);
+}
+
+void logger_log_message(LogLevel level, const char *message)
+{
+    if (!logger_is_enabled(level)) return;
+
+    logger_emit(level, message);
+}
+
+void logger_log_args(LogLevel level, String fmt, const FormatArg *args, isize arg_count)
+{
+    if (!logger_is_enabled(level)) return;
+
+    u8 buffer[LOGGER_STACK_BUFFER_SIZE];
+    FormatTemp message = format_temp(buffer, sizeof(buffer), fmt, args, arg_count);
+    logger_emit(level, (const char *)message.string.data());
+    format_free_temp(message);
+}
+
 }
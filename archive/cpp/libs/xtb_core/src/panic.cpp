@@ -43,17 +43,34 @@ void panic(const char *fmt, ...)
     g_panic.panic_in_flight = true;
 
     char buffer[1024];
+    char *message = buffer;
 
     va_list args;
+    va_list args_copy;
     va_start(args, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_copy(args_copy, args);
+
+    // Long messages get a second pass into malloc'd memory. The allocator may be
+    // what panicked, so this avoids it and keeps the truncated message if malloc fails
+    int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    if (len >= (int)sizeof(buffer))
+    {
+        char *heap_buffer = (char *)malloc(len + 1);
+        if (heap_buffer != NULL)
+        {
+            vsnprintf(heap_buffer, len + 1, fmt, args_copy);
+            message = heap_buffer;
+        }
+    }
+
+    va_end(args_copy);
     va_end(args);
 
-    LOG_FATAL("%s", buffer);
+    logger_log_message(LOG_LEVEL_FATAL, message);
 
     if (g_panic.handler)
     {
-        g_panic.handler(buffer, g_panic.user_data);
+        g_panic.handler(message, g_panic.user_data);
     }
 
     fflush(stdout);
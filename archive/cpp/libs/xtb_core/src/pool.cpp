@@ -0,0 +1,440 @@
+#include <xtb_core/pool.h>
+#include <xtb_core/contract.h>
+#include <xtb_core/intrinsics.h>
+#include <xtb_core/linked_list.h>
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string.h>
+
+#if OS_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+struct PoolBlock
+{
+    PoolBlock *next;
+};
+
+struct PoolHeap;
+
+struct PoolSlab
+{
+    // NULL once the owning thread detached, the next thread to free into the slab adopts it
+    std::atomic<PoolHeap *> owner;
+    // Blocks freed by threads other than the owner
+    std::atomic<PoolBlock *> remote_free;
+
+    PoolBlock *local_free;
+    PoolSlab *prev;
+    PoolSlab *next;
+
+    i32 size_class;
+    i32 block_size;
+    i32 block_count;
+    // Includes blocks sitting in `remote_free` until the owner collects them
+    i32 used_count;
+    // Blocks at and past this index have never been handed out
+    i32 bump_index;
+};
+
+struct PoolSlabList
+{
+    PoolSlab *first;
+    PoolSlab *last;
+};
+
+struct PoolHeap
+{
+    PoolSlabList slabs[POOL_SIZE_CLASS_COUNT];
+};
+
+struct Pool
+{
+    // Reserved by the first allocation the pool can serve, NULL until then or
+    // when the reservation failed
+    std::once_flag reserve_once;
+    std::atomic<char *> base;
+    size_t reserved_size;
+    std::atomic<size_t> next_unused_offset;
+
+    std::mutex free_slabs_lock;
+    PoolSlab *free_slabs;
+};
+
+// Keeps the first block of every slab on its own cache line
+#define POOL_SLAB_HEADER_SIZE ((sizeof(PoolSlab) + 63) & ~(size_t)63)
+
+// How many exhausted slabs an allocation looks past before grabbing a new one
+#define POOL_SLAB_SCAN_LIMIT 4
+
+static const i32 g_pool_size_classes[POOL_SIZE_CLASS_COUNT] = {
+    16,  32,  48,  64,  80,   96,   112,  128,
+    160, 192, 224, 256, 320,  384,  448,  512,
+    640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+};
+
+StaticAssert(POOL_MAX_BLOCK_SIZE == 2048, "Size class table must end at POOL_MAX_BLOCK_SIZE");
+StaticAssert(POOL_SLAB_HEADER_SIZE % POOL_BLOCK_ALIGNMENT == 0, "Slab header breaks block alignment");
+
+Pool g_pool;
+Allocator g_pool_allocator;
+thread_local PoolHeap g_pool_heap;
+
+static i32 pool_size_class(int64_t size)
+{
+    Assert(size > 0 && size <= POOL_MAX_BLOCK_SIZE);
+
+    // 16 byte steps up to 128, then four classes per power of two
+    if (size <= 128)
+    {
+        return (i32)((size - 1) >> 4);
+    }
+
+    i32 high_bit = 63 - __builtin_clzll((u64)(size - 1));
+    return 8 + (high_bit - 7) * 4 + (i32)((size - 1) >> (high_bit - 2)) - 4;
+}
+
+static char *pool_base(void)
+{
+    return g_pool.base.load(std::memory_order_acquire);
+}
+
+static void pool_reserve(void)
+{
+#if OS_LINUX
+    // Pages are only backed once a slab touches them
+    void *reservation = mmap(NULL, POOL_RESERVE_SIZE, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation != MAP_FAILED)
+    {
+        g_pool.reserved_size = POOL_RESERVE_SIZE;
+        g_pool.base.store((char *)reservation, std::memory_order_release);
+    }
+#endif
+}
+
+static bool pool_owns(void *ptr)
+{
+    char *address = (char *)ptr;
+    char *base = pool_base();
+    return base != NULL && address >= base && address < base + g_pool.reserved_size;
+}
+
+static bool pool_serves(int64_t size, int64_t align)
+{
+    if (size > POOL_MAX_BLOCK_SIZE || align > POOL_BLOCK_ALIGNMENT) return false;
+
+    std::call_once(g_pool.reserve_once, pool_reserve);
+    return pool_base() != NULL;
+}
+
+static PoolSlab *pool_slab_of(void *ptr)
+{
+    char *base = pool_base();
+    size_t offset = (size_t)((char *)ptr - base);
+    return (PoolSlab *)(base + offset / POOL_SLAB_SIZE * POOL_SLAB_SIZE);
+}
+
+static PoolBlock *pool_slab_block_at(PoolSlab *slab, i32 index)
+{
+    return (PoolBlock *)((char *)slab + POOL_SLAB_HEADER_SIZE + (size_t)index * slab->block_size);
+}
+
+static PoolSlab *pool_acquire_slab(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(g_pool.free_slabs_lock);
+        PoolSlab *slab = g_pool.free_slabs;
+        if (slab != NULL)
+        {
+            SLLStackPop(g_pool.free_slabs);
+            return slab;
+        }
+    }
+
+    size_t offset = g_pool.next_unused_offset.fetch_add(POOL_SLAB_SIZE, std::memory_order_relaxed);
+    if (offset + POOL_SLAB_SIZE > g_pool.reserved_size)
+    {
+        return NULL;
+    }
+
+    return (PoolSlab *)(pool_base() + offset);
+}
+
+static void pool_release_slab(PoolSlab *slab)
+{
+#if OS_LINUX
+    // The header page holds the free list link, the rest goes back to the OS
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    madvise((char *)slab + page_size, POOL_SLAB_SIZE - page_size, MADV_DONTNEED);
+#endif
+
+    std::lock_guard<std::mutex> guard(g_pool.free_slabs_lock);
+    SLLStackPush(g_pool.free_slabs, slab);
+}
+
+static void pool_slab_init(PoolSlab *slab, PoolHeap *heap, i32 size_class)
+{
+    new (slab) PoolSlab;
+    slab->owner.store(heap, std::memory_order_relaxed);
+    slab->remote_free.store(NULL, std::memory_order_relaxed);
+    slab->local_free = NULL;
+    slab->prev = NULL;
+    slab->next = NULL;
+    slab->size_class = size_class;
+    slab->block_size = g_pool_size_classes[size_class];
+    slab->block_count = (i32)((POOL_SLAB_SIZE - POOL_SLAB_HEADER_SIZE) / slab->block_size);
+    slab->used_count = 0;
+    slab->bump_index = 0;
+}
+
+// Moves the blocks other threads freed onto the owner's local list
+static void pool_slab_collect_remote(PoolSlab *slab)
+{
+    PoolBlock *block = slab->remote_free.exchange(NULL, std::memory_order_acquire);
+    while (block != NULL)
+    {
+        PoolBlock *next = block->next;
+        SLLStackPush(slab->local_free, block);
+        slab->used_count -= 1;
+        block = next;
+    }
+}
+
+static void *pool_slab_pop(PoolSlab *slab)
+{
+    if (slab->local_free == NULL && slab->bump_index == slab->block_count)
+    {
+        pool_slab_collect_remote(slab);
+    }
+
+    PoolBlock *block = slab->local_free;
+    if (block != NULL)
+    {
+        SLLStackPop(slab->local_free);
+    }
+    else if (slab->bump_index < slab->block_count)
+    {
+        block = pool_slab_block_at(slab, slab->bump_index);
+        slab->bump_index += 1;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    slab->used_count += 1;
+    return block;
+}
+
+static void *pool_heap_allocate(PoolHeap *heap, i32 size_class)
+{
+    PoolSlabList *list = &heap->slabs[size_class];
+
+    PoolSlab *slab = list->first;
+    for (i32 i = 0; slab != NULL && i < POOL_SLAB_SCAN_LIMIT; ++i)
+    {
+        void *block = pool_slab_pop(slab);
+        if (block != NULL)
+        {
+            return block;
+        }
+
+        // Exhausted, rotate it out of the way until something is freed into it
+        PoolSlab *next = slab->next;
+        if (next != NULL)
+        {
+            DLLRemove(list->first, list->last, slab);
+            DLLPushBack(list->first, list->last, slab);
+        }
+        slab = next;
+    }
+
+    slab = pool_acquire_slab();
+    if (slab == NULL)
+    {
+        return NULL;
+    }
+
+    pool_slab_init(slab, heap, size_class);
+    DLLPushFront(list->first, list->last, slab);
+
+    return pool_slab_pop(slab);
+}
+
+static void pool_free_block(void *ptr)
+{
+    PoolHeap *heap = &g_pool_heap;
+    PoolSlab *slab = pool_slab_of(ptr);
+    PoolBlock *block = (PoolBlock *)ptr;
+
+    PoolHeap *owner = slab->owner.load(std::memory_order_acquire);
+    if (owner == NULL && slab->owner.compare_exchange_strong(owner, heap, std::memory_order_acq_rel))
+    {
+        PoolSlabList *list = &heap->slabs[slab->size_class];
+        slab->prev = NULL;
+        slab->next = NULL;
+        DLLPushBack(list->first, list->last, slab);
+        pool_slab_collect_remote(slab);
+        owner = heap;
+    }
+
+    if (owner != heap)
+    {
+        PoolBlock *head = slab->remote_free.load(std::memory_order_relaxed);
+        do
+        {
+            block->next = head;
+        } while (!slab->remote_free.compare_exchange_weak(head, block,
+                                                          std::memory_order_release,
+                                                          std::memory_order_relaxed));
+        return;
+    }
+
+    SLLStackPush(slab->local_free, block);
+    slab->used_count -= 1;
+
+    PoolSlabList *list = &heap->slabs[slab->size_class];
+    if (slab != list->first)
+    {
+        DLLRemove(list->first, list->last, slab);
+        if (slab->used_count == 0)
+        {
+            pool_release_slab(slab);
+        }
+        else
+        {
+            DLLPushFront(list->first, list->last, slab);
+        }
+    }
+}
+
+static void *pool_allocate(int64_t size, int64_t align)
+{
+    if (pool_serves(size, align))
+    {
+        void *block = pool_heap_allocate(&g_pool_heap, pool_size_class(size));
+        if (block != NULL)
+        {
+            return block;
+        }
+    }
+
+    return g_malloc_allocator(&g_malloc_allocator, size, NULL, 0, align);
+}
+
+static void pool_deallocate(void *ptr, int64_t size, int64_t align)
+{
+    if (pool_owns(ptr))
+    {
+        pool_free_block(ptr);
+    }
+    else if (ptr != NULL)
+    {
+        g_malloc_allocator(&g_malloc_allocator, 0, ptr, size, align);
+    }
+}
+
+static void *pool_allocator_procedure(void *alloc, int64_t new_size, void *old_ptr, int64_t old_size, int64_t align)
+{
+    Unused(alloc);
+    Assert(new_size >= 0 && old_size >= 0 && align >= 0);
+
+    if (new_size == 0)
+    {
+        pool_deallocate(old_ptr, old_size, align);
+        return NULL;
+    }
+
+    if (old_ptr == NULL)
+    {
+        return pool_allocate(new_size, align);
+    }
+
+    bool old_in_pool = pool_owns(old_ptr);
+    bool new_in_pool = pool_serves(new_size, align);
+
+    if (!old_in_pool && !new_in_pool)
+    {
+        // Let the backing allocator grow in place when it can
+        return g_malloc_allocator(&g_malloc_allocator, new_size, old_ptr, old_size, align);
+    }
+
+    int64_t copy_size = Min(new_size, old_size);
+    if (old_in_pool)
+    {
+        PoolSlab *slab = pool_slab_of(old_ptr);
+        if (new_in_pool && pool_size_class(new_size) == slab->size_class)
+        {
+            return old_ptr;
+        }
+        copy_size = Min(copy_size, (int64_t)slab->block_size);
+    }
+
+    void *new_ptr = pool_allocate(new_size, align);
+    if (new_ptr == NULL) return NULL;
+
+    memcpy(new_ptr, old_ptr, copy_size);
+    pool_deallocate(old_ptr, old_size, align);
+
+    return new_ptr;
+}
+
+/****************************
+ * Pool API
+ ***************************/
+void pool_allocator_init(void)
+{
+    // The address range is reserved by the first allocation, so programs that
+    // never use the pool don't map it
+    g_pool_allocator = pool_allocator_procedure;
+}
+
+Allocator *pool_allocator_get(void)
+{
+    return &g_pool_allocator;
+}
+
+void pool_allocator_thread_detach(void)
+{
+    PoolHeap *heap = &g_pool_heap;
+
+    for (i32 size_class = 0; size_class < POOL_SIZE_CLASS_COUNT; ++size_class)
+    {
+        PoolSlabList *list = &heap->slabs[size_class];
+
+        PoolSlab *slab = list->first;
+        while (slab != NULL)
+        {
+            PoolSlab *next = slab->next;
+
+            pool_slab_collect_remote(slab);
+            if (slab->used_count == 0)
+            {
+                pool_release_slab(slab);
+            }
+            else
+            {
+                slab->prev = NULL;
+                slab->next = NULL;
+                slab->owner.store(NULL, std::memory_order_release);
+            }
+
+            slab = next;
+        }
+
+        list->first = NULL;
+        list->last = NULL;
+    }
+}
+
+}
@@ -0,0 +1,209 @@
+#include <xtb_core/shared_arena.h>
+#include <xtb_core/contract.h>
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+#define SHARED_ARENA_CHUNK_HEADER_SIZE \
+    ((sizeof(SharedArenaChunk) + SHARED_ARENA_GRANULARITY - 1) & ~(size_t)(SHARED_ARENA_GRANULARITY - 1))
+
+static size_t shared_arena_round_up(size_t size, size_t granularity)
+{
+    return (size + granularity - 1) & ~(granularity - 1);
+}
+
+static char *shared_chunk_buffer(SharedArenaChunk *chunk)
+{
+    return (char *)chunk + SHARED_ARENA_CHUNK_HEADER_SIZE;
+}
+
+static SharedArenaChunk *shared_arena_alloc_chunk(size_t capacity, size_t initial_offset)
+{
+    char *buffer = (char *)malloc(SHARED_ARENA_CHUNK_HEADER_SIZE + capacity);
+    if (buffer == NULL) return NULL;
+
+    SharedArenaChunk *chunk = new (buffer) SharedArenaChunk;
+    chunk->capacity = capacity;
+    chunk->offset.store(initial_offset, std::memory_order_relaxed);
+    chunk->next = NULL;
+
+    return chunk;
+}
+
+static void shared_arena_free_chunk_list(SharedArenaChunk *chunk)
+{
+    while (chunk != NULL)
+    {
+        SharedArenaChunk *next = chunk->next;
+        chunk->~SharedArenaChunk();
+        free(chunk);
+        chunk = next;
+    }
+}
+
+static void *shared_arena_align_in_chunk(SharedArenaChunk *chunk, size_t offset, size_t alignment)
+{
+    uintptr_t address = (uintptr_t)shared_chunk_buffer(chunk) + offset;
+    return (void *)((address + (alignment - 1)) & ~(uintptr_t)(alignment - 1));
+}
+
+static void *shared_arena_alloc_oversized(SharedArena *arena, size_t reserve_size, size_t alignment)
+{
+    SharedArenaChunk *chunk = shared_arena_alloc_chunk(reserve_size, reserve_size);
+    if (chunk == NULL) return NULL;
+
+    SharedArenaChunk *head = arena->oversized_chunks.load(std::memory_order_relaxed);
+    do
+    {
+        chunk->next = head;
+    } while (!arena->oversized_chunks.compare_exchange_weak(head, chunk,
+                                                           std::memory_order_release,
+                                                           std::memory_order_relaxed));
+
+    return shared_arena_align_in_chunk(chunk, 0, alignment);
+}
+
+static void* shared_arena_allocator_procedure(void* alloc, int64_t new_size, void* old_ptr, int64_t old_size, int64_t align)
+{
+    Assert(new_size >= 0 && old_size >= 0 && align >= 0);
+
+    SharedArena *arena = (SharedArena *)alloc;
+
+    // Individual allocations are never freed
+    if (new_size == 0)
+    {
+        return NULL;
+    }
+
+    size_t alignment = align > 0 ? (size_t)align : SHARED_ARENA_GRANULARITY;
+    void *new_ptr = shared_arena_alloc_aligned(arena, new_size, alignment);
+    if (new_ptr == NULL) return NULL;
+
+    if (old_ptr != NULL && old_size > 0)
+    {
+        memcpy(new_ptr, old_ptr, Min(new_size, old_size));
+    }
+
+    return new_ptr;
+}
+
+/****************************
+ * Shared Arena API
+ ***************************/
+SharedArena *shared_arena_new(size_t chunk_size)
+{
+    chunk_size = shared_arena_round_up(chunk_size, SHARED_ARENA_GRANULARITY);
+
+    SharedArenaChunk *chunk = shared_arena_alloc_chunk(chunk_size, 0);
+    if (chunk == NULL) return NULL;
+
+    SharedArena *arena = new (malloc(sizeof(SharedArena))) SharedArena;
+    arena->allocator = shared_arena_allocator_procedure;
+    arena->current_chunk.store(chunk, std::memory_order_relaxed);
+    arena->oversized_chunks.store(NULL, std::memory_order_relaxed);
+    arena->chunk_size = chunk_size;
+
+    return arena;
+}
+
+void shared_arena_release(SharedArena *arena)
+{
+    shared_arena_free_chunk_list(arena->current_chunk.load(std::memory_order_acquire));
+    shared_arena_free_chunk_list(arena->oversized_chunks.load(std::memory_order_acquire));
+
+    arena->~SharedArena();
+    free(arena);
+}
+
+void *shared_arena_alloc(SharedArena *arena, size_t allocation_size)
+{
+    return shared_arena_alloc_aligned(arena, allocation_size, SHARED_ARENA_GRANULARITY);
+}
+
+void *shared_arena_alloc_zero(SharedArena *arena, size_t allocation_size)
+{
+    void *result = shared_arena_alloc(arena, allocation_size);
+    if (result != NULL)
+    {
+        memset(result, 0, allocation_size);
+    }
+    return result;
+}
+
+void *shared_arena_alloc_aligned(SharedArena *arena, size_t allocation_size, size_t alignment)
+{
+    Assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    // Every reservation is a multiple of the granularity, so only stricter
+    // alignments need room to slide forward
+    size_t reserve_size = shared_arena_round_up(ClampBot(allocation_size, (size_t)1),
+                                                SHARED_ARENA_GRANULARITY);
+    if (alignment > SHARED_ARENA_GRANULARITY)
+    {
+        reserve_size += alignment - SHARED_ARENA_GRANULARITY;
+    }
+
+    if (reserve_size > arena->chunk_size / 4)
+    {
+        return shared_arena_alloc_oversized(arena, reserve_size, alignment);
+    }
+
+    SharedArenaChunk *chunk = arena->current_chunk.load(std::memory_order_acquire);
+    while (true)
+    {
+        size_t offset = chunk->offset.fetch_add(reserve_size, std::memory_order_relaxed);
+        if (offset + reserve_size <= chunk->capacity)
+        {
+            return shared_arena_align_in_chunk(chunk, offset, alignment);
+        }
+
+        // Chunk ran out. Only one thread installs the next one, the others
+        // wait for it and retry in the winner's chunk instead of mallocing their own
+        std::lock_guard<std::mutex> guard(arena->grow_lock);
+
+        SharedArenaChunk *current = arena->current_chunk.load(std::memory_order_acquire);
+        if (current != chunk)
+        {
+            chunk = current;
+            continue;
+        }
+
+        SharedArenaChunk *new_chunk = shared_arena_alloc_chunk(arena->chunk_size, reserve_size);
+        if (new_chunk == NULL) return NULL;
+        new_chunk->next = chunk;
+
+        arena->current_chunk.store(new_chunk, std::memory_order_release);
+        return shared_arena_align_in_chunk(new_chunk, 0, alignment);
+    }
+}
+
+size_t shared_arena_dump_memory_usage(SharedArena *arena)
+{
+    size_t total_usage = sizeof(SharedArena);
+
+    for (SharedArenaChunk *chunk = arena->current_chunk.load(std::memory_order_acquire);
+         chunk != NULL;
+         chunk = chunk->next)
+    {
+        total_usage += SHARED_ARENA_CHUNK_HEADER_SIZE;
+        total_usage += ClampTop(chunk->offset.load(std::memory_order_relaxed), chunk->capacity);
+    }
+
+    for (SharedArenaChunk *chunk = arena->oversized_chunks.load(std::memory_order_acquire);
+         chunk != NULL;
+         chunk = chunk->next)
+    {
+        total_usage += SHARED_ARENA_CHUNK_HEADER_SIZE + chunk->capacity;
+    }
+
+    return total_usage;
+}
+
+}
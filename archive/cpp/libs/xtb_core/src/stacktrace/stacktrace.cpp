@@ -334,6 +334,131 @@ void print_full()
     print(0);
 }
 
+struct CaptureContext
+{
+    uintptr_t *pcs;
+    i32 max_count;
+    i32 count;
+};
+
+static int capture_callback(void *data, uintptr_t pc)
+{
+    CaptureContext *ctx = (CaptureContext *)data;
+    ctx->pcs[ctx->count++] = pc;
+    return ctx->count == ctx->max_count ? 1 : 0;
+}
+
+i32 capture(uintptr_t *pcs, i32 max_count, int skip_frames_count)
+{
+    if (g_backtrace.state == NULL || max_count <= 0) return 0;
+
+    CaptureContext context = {
+        .pcs = pcs,
+        .max_count = max_count,
+        .count = 0,
+    };
+
+    // +1 for this function
+    backtrace_simple(g_backtrace.state,
+                     skip_frames_count + 1,
+                     capture_callback,
+                     xtb_backtrace_error_callback,
+                     &context);
+
+    return context.count;
+}
+
+struct DescribeAddressContext
+{
+    Allocator *allocator;
+    String description;
+};
+
+static int describe_address_callback(void *data,
+                                     uintptr_t pc,
+                                     const char *filename,
+                                     int lineno,
+                                     const char *function)
+{
+    Unused(pc);
+    DescribeAddressContext *ctx = (DescribeAddressContext *)data;
+
+    // No debug info, leave it to the symbol table
+    if (function == NULL && filename == NULL) return 0;
+
+    const char *function_display = function != NULL ? function : "[No Symbol]";
+    char *demangled_symbol = function != NULL ? demangle(function) : NULL;
+    if (demangled_symbol != NULL)
+    {
+        function_display = demangled_symbol;
+    }
+
+    if (filename != NULL)
+    {
+        ctx->description = String::format(ctx->allocator, "%s (%s:%d)", function_display, filename, lineno);
+    }
+    else
+    {
+        ctx->description = String::format(ctx->allocator, "%s", function_display);
+    }
+
+    free(demangled_symbol);
+
+    // Innermost inlined frame is enough
+    return 1;
+}
+
+static void describe_symbol_callback(void *data,
+                                     uintptr_t pc,
+                                     const char *symname,
+                                     uintptr_t symval,
+                                     uintptr_t symsize)
+{
+    Unused(pc);
+    Unused(symval);
+    Unused(symsize);
+    DescribeAddressContext *ctx = (DescribeAddressContext *)data;
+
+    if (symname == NULL) return;
+
+    char *demangled_symbol = demangle(symname);
+    ctx->description = String::format(ctx->allocator, "%s", demangled_symbol != NULL ? demangled_symbol : symname);
+    free(demangled_symbol);
+}
+
+String describe_address(Allocator *allocator, uintptr_t pc)
+{
+    DescribeAddressContext context = {
+        .allocator = allocator,
+        .description = String::invalid(),
+    };
+
+    if (g_backtrace.state != NULL)
+    {
+        backtrace_pcinfo(g_backtrace.state,
+                         pc,
+                         describe_address_callback,
+                         xtb_backtrace_error_callback,
+                         &context);
+    }
+
+    if (context.description.is_invalid() && g_backtrace.state != NULL)
+    {
+        backtrace_syminfo(g_backtrace.state,
+                          pc,
+                          describe_symbol_callback,
+                          xtb_backtrace_error_callback,
+                          &context);
+    }
+
+    if (context.description.is_invalid())
+    {
+        context.description = String::format(allocator, "0x%zx", (size_t)pc);
+    }
+
+    return context.description;
+}
+
 void init(const char *exe_path)
 {
     g_backtrace.state = backtrace_create_state(exe_path, 0, xtb_backtrace_error_callback, NULL);
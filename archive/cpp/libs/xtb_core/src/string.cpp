@@ -1,6 +1,8 @@
 #include "xtb_core/allocator.h"
 #include "xtb_core/thread_context.h"
 #include <xtb_core/string.h>
+#include <xtb_core/string_search.h>
+#include <xtb_core/escape.h>
 #include <xtb_core/linked_list.h>
 #include <xtb_core/contract.h>
 
@@ -15,7 +17,8 @@ namespace xtb
 String String::copy(Allocator *allocator)
 {
     u8 *buf = allocate_bytes(allocator, m_len + 1);
-    strncpy((char*)buf, (char *)m_data, m_len)[m_len] = '\0';
+    MemoryCopy(buf, m_data, m_len);
+    buf[m_len] = '\0';
     return String(buf, m_len);
 }
 
@@ -29,49 +32,22 @@ String String::substr(isize begin_idx, isize len)
 
 isize String::find(String needle)
 {
-    for (isize begin_idx = 0; begin_idx <= m_len - needle.len(); ++begin_idx)
-    {
-        std::cout << begin_idx << ": " << this->substr(begin_idx, needle.len()) << std::endl;
-        std::cout << begin_idx << ": " << needle << std::endl;
-        if (this->substr(begin_idx, needle.len()) == needle)
-        {
-            return begin_idx;
-        }
-    }
-    return -1;
+    return memory_find(m_data, m_len, needle.data(), needle.len());
 }
 
 isize String::find_last(String needle)
 {
-    for (isize end_idx = m_len - 1; end_idx >= needle.len(); --end_idx)
-    {
-        isize begin_idx = end_idx - needle.len();
-        if (this->substr(begin_idx, needle.len()) == needle)
-        {
-            return begin_idx;
-        }
-    }
-    return -1;
+    return memory_find_last(m_data, m_len, needle.data(), needle.len());
 }
 
 isize String::find(u8 needle)
 {
-    for (i32 i = 0; i < m_len; ++i)
-    {
-        if (m_data[i] == needle) return i;
-    }
-
-    return -1;
+    return memory_find_byte(m_data, m_len, needle);
 }
 
 isize String::find_last(u8 needle)
 {
-    for (i32 i = m_len - 1; i >= 0; --i)
-    {
-        if (m_data[i] == needle) return i;
-    }
-
-    return -1;
+    return memory_find_last_byte(m_data, m_len, needle);
 }
 
 bool String::contains(u8 needle)
@@ -99,53 +75,19 @@ String String::concat(String other, Allocator* allocator)
 
 String String::escape(Allocator *allocator)
 {
-    char escape_characters[] = { 'a', 'b', 'e', 'f', 'n', 'r', 't', 'v', '\\', '\'', '\"', '?' };
-    char hex_values[] = { 0x07, 0x08, 0x1b, 0x0c, 0x0a, 0x0d, 0x09, 0x0b, 0x5c, 0x27, 0x22, 0x3f };
-    StaticAssert(ArrLen(escape_characters) == ArrLen(hex_values), "Array lengths must match");
-
-    StringBuf buf = StringBuf::init_with_capacity(allocator, m_len + 1);
-
-    for (i32 i = 0; i < m_len; ++i)
-    {
-        char ch = m_data[i];
-
-        bool should_escape = false;
-        u8 escape_ch = '\0';
-
-        for (i32 j = 0; j < ArrLen(hex_values); ++j)
-        {
-            if (ch == hex_values[j])
-            {
-                escape_ch = escape_characters[j];
-                should_escape = true;
-                break;
-            }
-        }
-
-        if (should_escape)
-        {
-            buf.append('\\');
-            buf.append(escape_ch);
-        }
-        else
-        {
-            buf.append(ch);
-        }
-    }
-
-    return buf.detach();
+    return xtb::escape(allocator, *this, ESCAPE_C);
 }
 
 String String::strip_extension()
 {
-    i32 dot_pos = this->find_last('.');
+    isize dot_pos = this->find_last('.');
     i32 ext_len = m_len - dot_pos;
     return this->trunc_right(ext_len);
 }
 
 String String::basename()
 {
-    i32 begin = this->find_last('/') + 1;
+    isize begin = this->find_last('/') + 1;
     i32 len = m_len - begin;
     return this->substr(begin, len);
 }
@@ -218,12 +160,14 @@ String String::trunc_right(isize count)
     return this->substr(0, m_len - count);
 }
 
+// ASCII whitespace only, isspace can match bytes of multi-byte UTF-8 sequences
+// depending on the locale
 String String::trim_left()
 {
-    int i;
+    isize i;
     for (i = 0; i < m_len; ++i)
     {
-        if (!isspace(m_data[i])) break;
+        if (!is_ascii_space(m_data[i])) break;
     }
     return this->trunc_left(i);
 }
@@ -233,7 +177,7 @@ String String::trim_right()
     isize i;
     for (i = m_len - 1; i >= 0; --i)
     {
-        if (!isspace(m_data[i])) break;
+        if (!is_ascii_space(m_data[i])) break;
     }
     isize count = m_len - 1 - i;
     return this->trunc_right(count);
@@ -269,7 +213,10 @@ String String::formatv(Allocator* allocator, const char *fmt, va_list args)
     va_list args_copy;
     va_copy(args_copy, args);
 
-    int len = vsnprintf(NULL, 0, fmt, args_copy);
+    // Short results are formatted once into the stack buffer and copied, only
+    // longer ones need a second pass straight into the allocation
+    char stack_buf[256];
+    int len = vsnprintf(stack_buf, sizeof(stack_buf), fmt, args_copy);
     va_end(args_copy);
 
     if (len <= 0)
@@ -283,7 +230,14 @@ String String::formatv(Allocator* allocator, const char *fmt, va_list args)
         return String::invalid();
     }
 
-    vsnprintf((char*)str_buf, len + 1, fmt, args);
+    if (len < (int)sizeof(stack_buf))
+    {
+        MemoryCopy(str_buf, stack_buf, len + 1);
+    }
+    else
+    {
+        vsnprintf((char*)str_buf, len + 1, fmt, args);
+    }
 
     return String(str_buf, len);
 }
@@ -401,7 +355,7 @@ StringList String::split_pred(String::SplitPred pred,
     while (i < this->len())
     {
         String rest = this->trunc_left(i);
-        int skip = pred(rest, data);
+        isize skip = pred(rest, data);
 
         if (skip > 0) // delimiter hit
         {
@@ -440,7 +394,7 @@ StringList String::split_tokens_pred(String::SplitPred pred,
     while (i < this->len())
     {
         String rest = this->trunc_left(i);
-        int skip = pred(rest, data);
+        isize skip = pred(rest, data);
 
         if (skip > 0) // delimiter hit
         {
@@ -473,46 +427,204 @@ StringList String::split_tokens_pred(String::SplitPred pred,
     return result;
 }
 
-static isize split_by_str_pred(String rest, void *data)
+static StringList split_iterator_to_list(SplitIterator iterator, Allocator* allocator)
 {
-    String sep = *(String *)data;
-    String rest_substr = rest.substr(0, sep.len());
-    return rest_substr.equals(sep) ? sep.len() : 0;
+    StringList result = {0};
+
+    String token;
+    while (iterator.next(&token))
+    {
+        result.push_back(token, allocator);
+    }
+
+    return result;
 }
 
 StringList String::split_by_str(String sep, Allocator* allocator)
 {
-    return this->split_pred(split_by_str_pred, &sep, allocator);
+    return split_iterator_to_list(this->split(sep), allocator);
 }
 
-static isize split_by_char_pred(String rest, void *data)
+StringList String::split_by_char(char sep, Allocator* allocator)
 {
-    return rest[0] == *(u8 *)data ? 1 : 0;
+    return split_iterator_to_list(this->split((u8)sep), allocator);
 }
 
-StringList String::split_by_char(char sep, Allocator* allocator)
+StringList String::split_by_whitespace(Allocator* allocator)
+{
+    return split_iterator_to_list(this->split_whitespace(), allocator);
+}
+
+StringList String::split_by_lines(Allocator* allocator)
+{
+    return this->split_by_char('\n', allocator);
+}
+
+SplitIterator String::split(u8 sep)
+{
+    return SplitIterator(*this, sep);
+}
+
+SplitIterator String::split(String sep)
+{
+    return SplitIterator(*this, sep);
+}
+
+SplitIterator String::lines()
+{
+    return SplitIterator(*this, SplitIterator::SPLIT_LINES);
+}
+
+SplitIterator String::split_whitespace()
+{
+    return SplitIterator(*this, SplitIterator::SPLIT_WHITESPACE);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+SplitIterator::SplitIterator(String source, Kind kind)
+    : m_rest(source), m_sep(""), m_kind(kind), m_sep_char(0), m_finished(false)
+{
+    Assert(kind == SPLIT_LINES || kind == SPLIT_WHITESPACE);
+}
+
+SplitIterator::SplitIterator(String source, u8 sep)
+    : m_rest(source), m_sep(""), m_kind(SPLIT_BY_CHAR), m_sep_char(sep), m_finished(false)
+{
+}
+
+SplitIterator::SplitIterator(String source, String sep)
+    : m_rest(source), m_sep(sep), m_kind(SPLIT_BY_STR), m_sep_char(0), m_finished(false)
+{
+}
+
+bool SplitIterator::next(String *token)
+{
+    if (m_finished) return false;
+
+    switch (m_kind)
+    {
+        case SPLIT_BY_CHAR:
+        case SPLIT_BY_STR:
+        {
+            isize sep_idx;
+            isize sep_len;
+            if (m_kind == SPLIT_BY_CHAR)
+            {
+                sep_idx = memory_find_byte(m_rest.data(), m_rest.len(), m_sep_char);
+                sep_len = 1;
+            }
+            else
+            {
+                // An empty separator never matches, the whole input is one token
+                sep_len = m_sep.len();
+                sep_idx = sep_len > 0 ? m_rest.find(m_sep) : -1;
+            }
+
+            // The last token is yielded even when empty, "a," splits into "a" and ""
+            if (sep_idx < 0)
+            {
+                *token = m_rest;
+                m_finished = true;
+                return true;
+            }
+
+            *token = m_rest.head(sep_idx);
+            m_rest = m_rest.trunc_left(sep_idx + sep_len);
+            return true;
+        }
+
+        case SPLIT_LINES:
+        {
+            if (m_rest.is_empty())
+            {
+                m_finished = true;
+                return false;
+            }
+
+            isize newline_idx = memory_find_byte(m_rest.data(), m_rest.len(), '\n');
+            isize line_len = newline_idx >= 0 ? newline_idx : m_rest.len();
+
+            String line = m_rest.head(line_len);
+            m_rest = m_rest.trunc_left(newline_idx >= 0 ? line_len + 1 : line_len);
+            if (!line.is_empty() && line.back() == '\r')
+            {
+                line = line.trunc_right(1);
+            }
+
+            *token = line;
+            return true;
+        }
+
+        case SPLIT_WHITESPACE:
+        {
+            // Runs of whitespace are short, skipping them byte by byte is fine
+            const u8 *data = m_rest.data();
+            isize begin_idx = 0;
+            while (begin_idx < m_rest.len() && is_ascii_space(data[begin_idx]))
+            {
+                ++begin_idx;
+            }
+
+            m_rest = m_rest.trunc_left(begin_idx);
+            if (m_rest.is_empty())
+            {
+                m_finished = true;
+                return false;
+            }
+
+            isize space_idx = memory_find_whitespace(m_rest.data(), m_rest.len());
+            isize token_len = space_idx >= 0 ? space_idx : m_rest.len();
+
+            *token = m_rest.head(token_len);
+            m_rest = m_rest.trunc_left(token_len);
+            return true;
+        }
+    }
+
+    Unreachable;
+}
+
+isize SplitIterator::count()
 {
-    return this->split_pred(split_by_char_pred, &sep, allocator);
+    SplitIterator iterator = *this;
+
+    isize count = 0;
+    String token;
+    while (iterator.next(&token))
+    {
+        count += 1;
+    }
+
+    return count;
 }
 
-static isize split_by_whitespace_pred(String rest, void *data)
+Array<String> SplitIterator::collect(Allocator *allocator)
 {
-    int i = 0;
-    for (i = 0; i < rest.len(); ++i)
+    // Counting first is another pass over the input, but a cheap one compared
+    // to growing the array and copying it over as it fills
+    Array<String> result = Array<String>::init_with_capacity(allocator, this->count());
+
+    String token;
+    while (this->next(&token))
     {
-        if (!isspace(rest[i])) break;
+        result.append_assume_capacity(token);
     }
-    return i;
+
+    return result;
 }
 
-StringList String::split_by_whitespace(Allocator* allocator)
+SplitIterator::Cursor SplitIterator::begin()
 {
-    return this->split_tokens_pred(split_by_whitespace_pred, NULL, allocator);
+    Cursor cursor = { *this, String::invalid(), false };
+    cursor.valid = cursor.iterator.next(&cursor.token);
+    return cursor;
 }
 
-StringList String::split_by_lines(Allocator* allocator)
+SplitIterator::Cursor SplitIterator::end()
 {
-    return this->split_by_char('\n', allocator);
+    Cursor cursor = {};
+    return cursor;
 }
 
 String String::inspect()
@@ -0,0 +1,309 @@
+#include <xtb_core/string_builder.h>
+#include <xtb_core/linked_list.h>
+#include <xtb_core/contract.h>
+
+#include <string.h>
+
+#if OS_LINUX || OS_MAC
+#include <errno.h>
+#include <sys/uio.h>
+#endif
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+// Chunks handed to a single writev call
+#define STRING_BUILDER_IOV_BATCH 64
+
+isize StringBuilder::next_chunk_capacity(isize needed)
+{
+    // Chunks double up to a cap so small builders stay small and big ones
+    // don't end up with thousands of chunks
+    m_chunk_capacity = m_chunk_capacity == 0
+        ? STRING_BUILDER_MIN_CHUNK_SIZE
+        : Min(m_chunk_capacity * 2, (isize)STRING_BUILDER_MAX_CHUNK_SIZE);
+
+    return Max(m_chunk_capacity, needed);
+}
+
+// Chunk over memory the builder already owns, only the header is allocated
+StringBuilderChunk* StringBuilder::push_spare_chunk(u8 *data, isize capacity, bool at_front)
+{
+    StringBuilderChunk *chunk = this->push_chunk(0, at_front);
+    chunk->data = data;
+    chunk->capacity = capacity;
+    chunk->begin = at_front ? capacity : 0;
+    chunk->end = chunk->begin;
+    return chunk;
+}
+
+StringBuilderChunk* StringBuilder::push_chunk(isize capacity, bool at_front)
+{
+    Assert(m_arena != NULL);
+
+    StringBuilderChunk *chunk = (StringBuilderChunk *)arena_alloc_aligned(
+        m_arena, sizeof(StringBuilderChunk) + capacity, alignof(StringBuilderChunk));
+    Assert(chunk != NULL);
+
+    chunk->data = (u8 *)(chunk + 1);
+    chunk->capacity = capacity;
+
+    // An empty chunk at the front fills from its end, at the back from its start
+    chunk->begin = at_front ? capacity : 0;
+    chunk->end = chunk->begin;
+
+    if (at_front)
+    {
+        DLLPushFront(m_first, m_last, chunk);
+    }
+    else
+    {
+        DLLPushBack(m_first, m_last, chunk);
+    }
+    m_chunk_count += 1;
+
+    return chunk;
+}
+
+/****************************
+ * StringBuilder API
+ ***************************/
+void StringBuilder::append(String string)
+{
+    const u8 *data = string.data();
+    isize len = string.len();
+    if (len == 0) return;
+
+    // Top off the last chunk, then put whatever is left in a new one
+    if (m_last != NULL)
+    {
+        isize count = Min(len, m_last->capacity - m_last->end);
+        MemoryCopy(m_last->data + m_last->end, data, count);
+        m_last->end += count;
+        data += count;
+        len -= count;
+    }
+
+    // Room left behind in a chunk a view was linked in after
+    if (len > 0 && m_back_spare_size > 0)
+    {
+        StringBuilderChunk *chunk = this->push_spare_chunk(m_back_spare, m_back_spare_size, false);
+        m_back_spare_size = 0;
+
+        isize count = Min(len, chunk->capacity);
+        MemoryCopy(chunk->data, data, count);
+        chunk->end = count;
+        data += count;
+        len -= count;
+    }
+
+    if (len > 0)
+    {
+        StringBuilderChunk *chunk = this->push_chunk(this->next_chunk_capacity(len), false);
+        MemoryCopy(chunk->data, data, len);
+        chunk->end = len;
+    }
+
+    m_size += string.len();
+}
+
+void StringBuilder::append(u8 c)
+{
+    this->append(String(&c, 1));
+}
+
+void StringBuilder::prepend(String string)
+{
+    const u8 *data = string.data();
+    isize len = string.len();
+    if (len == 0) return;
+
+    // The tail of the string goes in front of the first chunk's content
+    if (m_first != NULL)
+    {
+        isize count = Min(len, m_first->begin);
+        m_first->begin -= count;
+        MemoryCopy(m_first->data + m_first->begin, data + len - count, count);
+        len -= count;
+    }
+
+    if (len > 0 && m_front_spare_size > 0)
+    {
+        StringBuilderChunk *chunk = this->push_spare_chunk(m_front_spare, m_front_spare_size, true);
+        m_front_spare_size = 0;
+
+        isize count = Min(len, chunk->capacity);
+        chunk->begin = chunk->capacity - count;
+        MemoryCopy(chunk->data + chunk->begin, data + len - count, count);
+        len -= count;
+    }
+
+    if (len > 0)
+    {
+        StringBuilderChunk *chunk = this->push_chunk(this->next_chunk_capacity(len), true);
+        chunk->begin = chunk->capacity - len;
+        MemoryCopy(chunk->data + chunk->begin, data, len);
+    }
+
+    m_size += string.len();
+}
+
+void StringBuilder::append_view(String string)
+{
+    if (string.is_empty()) return;
+
+    // The last chunk is never written to again once the view follows it, so the
+    // next append picks up its free space instead of opening a fresh chunk
+    if (m_last != NULL && m_last->end < m_last->capacity)
+    {
+        m_back_spare = m_last->data + m_last->end;
+        m_back_spare_size = m_last->capacity - m_last->end;
+        m_last->capacity = m_last->end;
+    }
+
+    // No spare room on either side, so nothing gets written into the caller's memory
+    StringBuilderChunk *chunk = this->push_chunk(0, false);
+    chunk->data = string.data();
+    chunk->begin = 0;
+    chunk->end = string.len();
+    chunk->capacity = string.len();
+
+    m_size += string.len();
+}
+
+void StringBuilder::prepend_view(String string)
+{
+    if (string.is_empty()) return;
+
+    if (m_first != NULL && m_first->begin > 0)
+    {
+        m_front_spare = m_first->data;
+        m_front_spare_size = m_first->begin;
+        m_first->data += m_first->begin;
+        m_first->capacity -= m_first->begin;
+        m_first->end -= m_first->begin;
+        m_first->begin = 0;
+    }
+
+    StringBuilderChunk *chunk = this->push_chunk(0, true);
+    chunk->data = string.data();
+    chunk->begin = 0;
+    chunk->end = string.len();
+    chunk->capacity = string.len();
+
+    m_size += string.len();
+}
+
+void StringBuilder::append_builder(const StringBuilder& other)
+{
+    for (StringBuilderChunk *chunk = other.m_first; chunk != NULL; chunk = chunk->next)
+    {
+        this->append(chunk->view());
+    }
+}
+
+void StringBuilder::append_format_args(String fmt, const FormatArg *args, isize arg_count)
+{
+    u8 buffer[256];
+    FormatTemp temp = format_temp(buffer, sizeof(buffer), fmt, args, arg_count);
+    this->append(temp.string);
+    format_free_temp(temp);
+}
+
+void StringBuilder::copy_to(u8 *out) const
+{
+    for (StringBuilderChunk *chunk = m_first; chunk != NULL; chunk = chunk->next)
+    {
+        isize len = chunk->end - chunk->begin;
+        MemoryCopy(out, chunk->data + chunk->begin, len);
+        out += len;
+    }
+}
+
+String StringBuilder::flatten(Allocator *allocator) const
+{
+    u8 *buffer = allocate_bytes(allocator, m_size + 1);
+    Assert(buffer != NULL);
+
+    this->copy_to(buffer);
+    buffer[m_size] = '\0';
+
+    return String(buffer, m_size);
+}
+
+bool StringBuilder::write_to_file(FILE *stream) const
+{
+    for (StringBuilderChunk *chunk = m_first; chunk != NULL; chunk = chunk->next)
+    {
+        usize len = (usize)(chunk->end - chunk->begin);
+        if (fwrite(chunk->data + chunk->begin, 1, len, stream) != len)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if OS_LINUX || OS_MAC
+bool StringBuilder::write_to_fd(int fd) const
+{
+    StringBuilderChunk *chunk = m_first;
+    isize chunk_written = 0;
+
+    while (chunk != NULL)
+    {
+        struct iovec iov[STRING_BUILDER_IOV_BATCH];
+        int iov_count = 0;
+
+        // Only the first chunk can be partially written already
+        isize offset = chunk_written;
+        StringBuilderChunk *it = chunk;
+        for (; it != NULL && iov_count < STRING_BUILDER_IOV_BATCH; it = it->next)
+        {
+            iov[iov_count].iov_base = it->data + it->begin + offset;
+            iov[iov_count].iov_len = (size_t)(it->end - it->begin - offset);
+            iov_count += 1;
+            offset = 0;
+        }
+
+        ssize_t written = writev(fd, iov, iov_count);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+
+        // Short writes are allowed, skip exactly what made it out
+        while (written > 0)
+        {
+            isize left = chunk->end - chunk->begin - chunk_written;
+            if (written >= left)
+            {
+                written -= left;
+                chunk = chunk->next;
+                chunk_written = 0;
+            }
+            else
+            {
+                chunk_written += written;
+                written = 0;
+            }
+        }
+    }
+
+    return true;
+}
+#endif
+
+void StringBuilder::clear()
+{
+    m_first = NULL;
+    m_last = NULL;
+    m_size = 0;
+    m_chunk_count = 0;
+    m_chunk_capacity = 0;
+    m_back_spare_size = 0;
+    m_front_spare_size = 0;
+}
+
+}
@@ -0,0 +1,239 @@
+#include <xtb_core/string_interner.h>
+#include <xtb_core/arena.h>
+#include <xtb_core/contract.h>
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string.h>
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+#define STRING_INTERNER_ARENA_SIZE Kilobytes(64)
+#define STRING_INTERNER_INITIAL_CAPACITY 256
+
+// Entries live in segments that double in size and never move, so readers can
+// index them while a writer adds more. Segment k holds FIRST_SEGMENT_SIZE << k
+#define STRING_INTERNER_FIRST_SEGMENT_SHIFT 8
+#define STRING_INTERNER_FIRST_SEGMENT_SIZE (1 << STRING_INTERNER_FIRST_SEGMENT_SHIFT)
+#define STRING_INTERNER_SEGMENT_COUNT 24
+
+struct StringInternerEntry
+{
+    const u8 *data;
+    isize len;
+    u64 hash;
+};
+
+// Open-addressing table of ids. A slot is 0 when empty, otherwise the top 32
+// bits of the string's hash above the 32 bit id, so most mismatches are rejected
+// without touching the entry
+struct StringInternerTable
+{
+    std::atomic<u64> *slots;
+    u64 mask;
+};
+
+struct StringInterner
+{
+    // Taken by writers only
+    std::mutex lock;
+    Arena *arena;
+
+    std::atomic<StringInternerTable *> table;
+    std::atomic<StringInternerEntry *> segments[STRING_INTERNER_SEGMENT_COUNT];
+    std::atomic<u32> count;
+};
+
+static void string_interner_locate(u32 index, isize *segment, isize *offset)
+{
+    u64 biased = (u64)(index - 1) + STRING_INTERNER_FIRST_SEGMENT_SIZE;
+    isize msb = 63 - __builtin_clzll(biased);
+
+    *segment = msb - STRING_INTERNER_FIRST_SEGMENT_SHIFT;
+    *offset = (isize)(biased - ((u64)STRING_INTERNER_FIRST_SEGMENT_SIZE << *segment));
+}
+
+static StringInternerEntry *string_interner_entry(StringInterner *interner, u32 index)
+{
+    isize segment, offset;
+    string_interner_locate(index, &segment, &offset);
+    return interner->segments[segment].load(std::memory_order_acquire) + offset;
+}
+
+static StringInternerTable *string_interner_table_new(Arena *arena, isize capacity)
+{
+    StringInternerTable *table = (StringInternerTable *)arena_alloc_aligned(
+        arena, sizeof(StringInternerTable), alignof(StringInternerTable));
+    void *slots = arena_alloc_aligned_zero(
+        arena, capacity * sizeof(std::atomic<u64>), alignof(std::atomic<u64>));
+    Assert(table != NULL && slots != NULL);
+
+    table->slots = (std::atomic<u64> *)slots;
+    table->mask = (u64)capacity - 1;
+    return table;
+}
+
+static void string_interner_table_insert(StringInternerTable *table, u64 hash, u32 index)
+{
+    u64 slot = (hash & 0xffffffff00000000ull) | index;
+    for (u64 i = hash & table->mask; ; i = (i + 1) & table->mask)
+    {
+        if (table->slots[i].load(std::memory_order_relaxed) == 0)
+        {
+            table->slots[i].store(slot, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+static StrId string_interner_find_hashed(StringInterner *interner, String string, u64 hash)
+{
+    StringInternerTable *table = interner->table.load(std::memory_order_acquire);
+
+    // The table is at most half full, the probe always ends on an empty slot
+    for (u64 i = hash & table->mask; ; i = (i + 1) & table->mask)
+    {
+        u64 slot = table->slots[i].load(std::memory_order_acquire);
+        if (slot == 0) return StrId { 0 };
+        if ((slot >> 32) != (hash >> 32)) continue;
+
+        // The entry was filled in before its slot was published
+        u32 index = (u32)slot;
+        const StringInternerEntry *entry = string_interner_entry(interner, index);
+        if (entry->len == string.len() && memcmp(entry->data, string.data(), string.len()) == 0)
+        {
+            return StrId { index };
+        }
+    }
+}
+
+// Readers still probing the old table won't see strings added after the swap, they
+// fall through to the locked path in intern which looks again
+static StringInternerTable *string_interner_grow(StringInterner *interner,
+                                                 StringInternerTable *old_table)
+{
+    isize capacity = (isize)(old_table->mask + 1) * 2;
+    StringInternerTable *table = string_interner_table_new(interner->arena, capacity);
+
+    u32 count = interner->count.load(std::memory_order_relaxed);
+    for (u32 index = 1; index <= count; ++index)
+    {
+        string_interner_table_insert(table, string_interner_entry(interner, index)->hash, index);
+    }
+
+    interner->table.store(table, std::memory_order_release);
+    return table;
+}
+
+/****************************
+ * String interner API
+ ***************************/
+StringInterner *string_interner_new(void)
+{
+    Arena *arena = arena_new(STRING_INTERNER_ARENA_SIZE);
+    arena_set_name(arena, "string interner");
+
+    void *memory = arena_alloc_aligned(arena, sizeof(StringInterner), alignof(StringInterner));
+    StringInterner *interner = new (memory) StringInterner();
+    interner->arena = arena;
+    interner->table.store(string_interner_table_new(arena, STRING_INTERNER_INITIAL_CAPACITY),
+                          std::memory_order_relaxed);
+
+    return interner;
+}
+
+void string_interner_release(StringInterner *interner)
+{
+    Arena *arena = interner->arena;
+    interner->~StringInterner();
+    arena_release(arena);
+}
+
+StrId string_interner_intern(StringInterner *interner, String string)
+{
+    u64 hash = hash_string(string);
+
+    StrId id = string_interner_find_hashed(interner, string, hash);
+    if (id.is_valid()) return id;
+
+    std::lock_guard<std::mutex> guard(interner->lock);
+
+    // Another writer may have added it while we waited
+    id = string_interner_find_hashed(interner, string, hash);
+    if (id.is_valid()) return id;
+
+    u32 index = interner->count.load(std::memory_order_relaxed) + 1;
+
+    isize segment, offset;
+    string_interner_locate(index, &segment, &offset);
+    Assert(segment < STRING_INTERNER_SEGMENT_COUNT);
+
+    StringInternerEntry *entries = interner->segments[segment].load(std::memory_order_relaxed);
+    if (entries == NULL)
+    {
+        isize segment_size = (isize)STRING_INTERNER_FIRST_SEGMENT_SIZE << segment;
+        entries = (StringInternerEntry *)arena_alloc_aligned(interner->arena,
+            segment_size * sizeof(StringInternerEntry), alignof(StringInternerEntry));
+        Assert(entries != NULL);
+        interner->segments[segment].store(entries, std::memory_order_release);
+    }
+
+    u8 *data = (u8 *)arena_alloc(interner->arena, string.len() + 1);
+    Assert(data != NULL);
+    MemoryCopy(data, string.data(), string.len());
+    data[string.len()] = '\0';
+
+    StringInternerEntry *entry = &entries[offset];
+    entry->data = data;
+    entry->len = string.len();
+    entry->hash = hash;
+
+    StringInternerTable *table = interner->table.load(std::memory_order_relaxed);
+    if ((u64)index * 2 > table->mask + 1)
+    {
+        table = string_interner_grow(interner, table);
+    }
+
+    // Count first, so a reader that finds the id in the table also sees it counted
+    interner->count.store(index, std::memory_order_release);
+    string_interner_table_insert(table, hash, index);
+
+    return StrId { index };
+}
+
+StrId string_interner_find(StringInterner *interner, String string)
+{
+    return string_interner_find_hashed(interner, string, hash_string(string));
+}
+
+String string_interner_get(StringInterner *interner, StrId id)
+{
+    Assert(id.is_valid() && id.index <= interner->count.load(std::memory_order_acquire));
+
+    const StringInternerEntry *entry = string_interner_entry(interner, id.index);
+    return String((u8 *)entry->data, entry->len);
+}
+
+u64 string_interner_hash(StringInterner *interner, StrId id)
+{
+    Assert(id.is_valid() && id.index <= interner->count.load(std::memory_order_acquire));
+    return string_interner_entry(interner, id.index)->hash;
+}
+
+isize string_interner_count(StringInterner *interner)
+{
+    return interner->count.load(std::memory_order_acquire);
+}
+
+StringInterner *string_interner_global(void)
+{
+    static StringInterner *interner = string_interner_new();
+    return interner;
+}
+
+}
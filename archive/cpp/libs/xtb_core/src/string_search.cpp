@@ -0,0 +1,437 @@
+#include <xtb_core/string_search.h>
+
+#include <string.h>
+
+#if ARCH_X64 || ARCH_X86
+#include <immintrin.h>
+#define MEMORY_SEARCH_X86 1
+#else
+#define MEMORY_SEARCH_X86 0
+#endif
+
+#if COMPILER_GCC || COMPILER_CLANG
+#define MEMORY_SEARCH_TARGET(isa) __attribute__((target(isa)))
+#else
+#define MEMORY_SEARCH_TARGET(isa)
+#endif
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+// Every kernel expects 2 <= needle_len <= haystack_len for substring searches,
+// the public functions handle the shorter cases
+struct MemorySearchKernels
+{
+    const char *name;
+    isize (*find_byte)(const u8 *haystack, isize haystack_len, u8 needle);
+    isize (*find_last_byte)(const u8 *haystack, isize haystack_len, u8 needle);
+    isize (*find_whitespace)(const u8 *haystack, isize haystack_len);
+    isize (*find)(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len);
+    isize (*find_last)(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len);
+};
+
+static u32 highest_bit_index(u32 mask)
+{
+    return 31 - __builtin_clz(mask);
+}
+
+// A candidate already matched the first and last byte, check what's in between
+static bool memory_search_middle_matches(const u8 *candidate, const u8 *needle, isize needle_len)
+{
+    return memcmp(candidate + 1, needle + 1, needle_len - 2) == 0;
+}
+
+/****************************
+ * Scalar kernels
+ ***************************/
+static isize find_byte_scalar_from(const u8 *haystack, isize haystack_len, u8 needle, isize start)
+{
+    const u8 *found = (const u8 *)memchr(haystack + start, needle, haystack_len - start);
+    return found != NULL ? found - haystack : -1;
+}
+
+static isize find_last_byte_scalar_before(const u8 *haystack, isize end, u8 needle)
+{
+    for (isize i = end - 1; i >= 0; --i)
+    {
+        if (haystack[i] == needle) return i;
+    }
+    return -1;
+}
+
+static isize find_whitespace_scalar_from(const u8 *haystack, isize haystack_len, isize start)
+{
+    for (isize i = start; i < haystack_len; ++i)
+    {
+        if (is_ascii_space(haystack[i])) return i;
+    }
+    return -1;
+}
+
+static isize find_scalar_from(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len,
+                              isize start)
+{
+    isize last_start = haystack_len - needle_len;
+    for (isize i = start; i <= last_start; ++i)
+    {
+        if (haystack[i] == needle[0] && haystack[i + needle_len - 1] == needle[needle_len - 1]
+            && memory_search_middle_matches(haystack + i, needle, needle_len))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static isize find_last_scalar_from(const u8 *haystack, const u8 *needle, isize needle_len, isize start)
+{
+    for (isize i = start; i >= 0; --i)
+    {
+        if (haystack[i] == needle[0] && haystack[i + needle_len - 1] == needle[needle_len - 1]
+            && memory_search_middle_matches(haystack + i, needle, needle_len))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static isize find_byte_scalar(const u8 *haystack, isize haystack_len, u8 needle)
+{
+    return find_byte_scalar_from(haystack, haystack_len, needle, 0);
+}
+
+static isize find_last_byte_scalar(const u8 *haystack, isize haystack_len, u8 needle)
+{
+    return find_last_byte_scalar_before(haystack, haystack_len, needle);
+}
+
+static isize find_whitespace_scalar(const u8 *haystack, isize haystack_len)
+{
+    return find_whitespace_scalar_from(haystack, haystack_len, 0);
+}
+
+static isize find_scalar(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len)
+{
+    return find_scalar_from(haystack, haystack_len, needle, needle_len, 0);
+}
+
+static isize find_last_scalar(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len)
+{
+    return find_last_scalar_from(haystack, needle, needle_len, haystack_len - needle_len);
+}
+
+static const MemorySearchKernels g_memory_search_scalar = {
+    "scalar",
+    find_byte_scalar, find_last_byte_scalar, find_whitespace_scalar,
+    find_scalar, find_last_scalar,
+};
+
+#if MEMORY_SEARCH_X86
+/****************************
+ * SSE2 kernels
+ ***************************/
+MEMORY_SEARCH_TARGET("sse2")
+static isize find_byte_sse2(const u8 *haystack, isize haystack_len, u8 needle)
+{
+    const __m128i pattern = _mm_set1_epi8((char)needle);
+
+    isize i = 0;
+    for (; i + 16 <= haystack_len; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(haystack + i));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+
+    return find_byte_scalar_from(haystack, haystack_len, needle, i);
+}
+
+MEMORY_SEARCH_TARGET("sse2")
+static isize find_last_byte_sse2(const u8 *haystack, isize haystack_len, u8 needle)
+{
+    const __m128i pattern = _mm_set1_epi8((char)needle);
+
+    isize end = haystack_len;
+    for (; end >= 16; end -= 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(haystack + end - 16));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+        if (mask != 0) return end - 16 + highest_bit_index(mask);
+    }
+
+    return find_last_byte_scalar_before(haystack, end, needle);
+}
+
+// A byte is whitespace if it's a space or falls in the '\t'..'\r' range,
+// the range check is an unsigned min against the biased byte
+MEMORY_SEARCH_TARGET("sse2")
+static isize find_whitespace_sse2(const u8 *haystack, isize haystack_len)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i range_begin = _mm_set1_epi8('\t');
+    const __m128i range_len = _mm_set1_epi8('\r' - '\t');
+
+    isize i = 0;
+    for (; i + 16 <= haystack_len; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i biased = _mm_sub_epi8(block, range_begin);
+        __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(biased, range_len), biased);
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(block, space), in_range);
+
+        u32 mask = (u32)_mm_movemask_epi8(matches);
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+
+    return find_whitespace_scalar_from(haystack, haystack_len, i);
+}
+
+// Compares the needle's first and last byte against 16 candidate positions at a
+// time, only positions where both match get a full comparison
+MEMORY_SEARCH_TARGET("sse2")
+static isize find_sse2(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len)
+{
+    const __m128i first = _mm_set1_epi8((char)needle[0]);
+    const __m128i last = _mm_set1_epi8((char)needle[needle_len - 1]);
+
+    isize i = 0;
+    for (; i + needle_len - 1 + 16 <= haystack_len; i += 16)
+    {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(haystack + i + needle_len - 1));
+        __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last));
+
+        u32 mask = (u32)_mm_movemask_epi8(matches);
+        while (mask != 0)
+        {
+            isize candidate = i + __builtin_ctz(mask);
+            if (memory_search_middle_matches(haystack + candidate, needle, needle_len)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+
+    return find_scalar_from(haystack, haystack_len, needle, needle_len, i);
+}
+
+MEMORY_SEARCH_TARGET("sse2")
+static isize find_last_sse2(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len)
+{
+    const __m128i first = _mm_set1_epi8((char)needle[0]);
+    const __m128i last = _mm_set1_epi8((char)needle[needle_len - 1]);
+
+    // Each block covers the 16 candidate starts ending at `start`
+    isize start = haystack_len - needle_len;
+    for (; start >= 15; start -= 16)
+    {
+        isize base = start - 15;
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + base));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(haystack + base + needle_len - 1));
+        __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last));
+
+        u32 mask = (u32)_mm_movemask_epi8(matches);
+        while (mask != 0)
+        {
+            u32 bit = highest_bit_index(mask);
+            if (memory_search_middle_matches(haystack + base + bit, needle, needle_len)) return base + bit;
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return find_last_scalar_from(haystack, needle, needle_len, start);
+}
+
+static const MemorySearchKernels g_memory_search_sse2 = {
+    "sse2",
+    find_byte_sse2, find_last_byte_sse2, find_whitespace_sse2,
+    find_sse2, find_last_sse2,
+};
+
+#if COMPILER_GCC || COMPILER_CLANG
+/****************************
+ * AVX2 kernels
+ ***************************/
+MEMORY_SEARCH_TARGET("avx2")
+static isize find_byte_avx2(const u8 *haystack, isize haystack_len, u8 needle)
+{
+    const __m256i pattern = _mm256_set1_epi8((char)needle);
+
+    isize i = 0;
+    for (; i + 32 <= haystack_len; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+
+    return find_byte_scalar_from(haystack, haystack_len, needle, i);
+}
+
+MEMORY_SEARCH_TARGET("avx2")
+static isize find_last_byte_avx2(const u8 *haystack, isize haystack_len, u8 needle)
+{
+    const __m256i pattern = _mm256_set1_epi8((char)needle);
+
+    isize end = haystack_len;
+    for (; end >= 32; end -= 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(haystack + end - 32));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern));
+        if (mask != 0) return end - 32 + highest_bit_index(mask);
+    }
+
+    return find_last_byte_scalar_before(haystack, end, needle);
+}
+
+MEMORY_SEARCH_TARGET("avx2")
+static isize find_whitespace_avx2(const u8 *haystack, isize haystack_len)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i range_begin = _mm256_set1_epi8('\t');
+    const __m256i range_len = _mm256_set1_epi8('\r' - '\t');
+
+    isize i = 0;
+    for (; i + 32 <= haystack_len; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        __m256i biased = _mm256_sub_epi8(block, range_begin);
+        __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(biased, range_len), biased);
+        __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi8(block, space), in_range);
+
+        u32 mask = (u32)_mm256_movemask_epi8(matches);
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+
+    return find_whitespace_scalar_from(haystack, haystack_len, i);
+}
+
+MEMORY_SEARCH_TARGET("avx2")
+static isize find_avx2(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len)
+{
+    const __m256i first = _mm256_set1_epi8((char)needle[0]);
+    const __m256i last = _mm256_set1_epi8((char)needle[needle_len - 1]);
+
+    isize i = 0;
+    for (; i + needle_len - 1 + 32 <= haystack_len; i += 32)
+    {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(haystack + i + needle_len - 1));
+        __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                           _mm256_cmpeq_epi8(block_last, last));
+
+        u32 mask = (u32)_mm256_movemask_epi8(matches);
+        while (mask != 0)
+        {
+            isize candidate = i + __builtin_ctz(mask);
+            if (memory_search_middle_matches(haystack + candidate, needle, needle_len)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+
+    return find_scalar_from(haystack, haystack_len, needle, needle_len, i);
+}
+
+MEMORY_SEARCH_TARGET("avx2")
+static isize find_last_avx2(const u8 *haystack, isize haystack_len, const u8 *needle, isize needle_len)
+{
+    const __m256i first = _mm256_set1_epi8((char)needle[0]);
+    const __m256i last = _mm256_set1_epi8((char)needle[needle_len - 1]);
+
+    isize start = haystack_len - needle_len;
+    for (; start >= 31; start -= 32)
+    {
+        isize base = start - 31;
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(haystack + base));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(haystack + base + needle_len - 1));
+        __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                           _mm256_cmpeq_epi8(block_last, last));
+
+        u32 mask = (u32)_mm256_movemask_epi8(matches);
+        while (mask != 0)
+        {
+            u32 bit = highest_bit_index(mask);
+            if (memory_search_middle_matches(haystack + base + bit, needle, needle_len)) return base + bit;
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return find_last_scalar_from(haystack, needle, needle_len, start);
+}
+
+static const MemorySearchKernels g_memory_search_avx2 = {
+    "avx2",
+    find_byte_avx2, find_last_byte_avx2, find_whitespace_avx2,
+    find_avx2, find_last_avx2,
+};
+#endif // COMPILER_GCC || COMPILER_CLANG
+#endif // MEMORY_SEARCH_X86
+
+static const MemorySearchKernels *memory_search_select_kernels(void)
+{
+#if MEMORY_SEARCH_X86
+#if COMPILER_GCC || COMPILER_CLANG
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &g_memory_search_avx2;
+    if (__builtin_cpu_supports("sse2")) return &g_memory_search_sse2;
+#else
+    return &g_memory_search_sse2;
+#endif
+#endif
+    return &g_memory_search_scalar;
+}
+
+static const MemorySearchKernels *memory_search_kernels(void)
+{
+    static const MemorySearchKernels *kernels = memory_search_select_kernels();
+    return kernels;
+}
+
+/****************************
+ * Search API
+ ***************************/
+isize memory_find_byte(const void *haystack, isize haystack_len, u8 needle)
+{
+    if (haystack_len <= 0) return -1;
+    return memory_search_kernels()->find_byte((const u8 *)haystack, haystack_len, needle);
+}
+
+isize memory_find_last_byte(const void *haystack, isize haystack_len, u8 needle)
+{
+    if (haystack_len <= 0) return -1;
+    return memory_search_kernels()->find_last_byte((const u8 *)haystack, haystack_len, needle);
+}
+
+isize memory_find_whitespace(const void *haystack, isize haystack_len)
+{
+    if (haystack_len <= 0) return -1;
+    return memory_search_kernels()->find_whitespace((const u8 *)haystack, haystack_len);
+}
+
+isize memory_find(const void *haystack, isize haystack_len, const void *needle, isize needle_len)
+{
+    if (needle_len == 0) return 0;
+    if (needle_len > haystack_len) return -1;
+    if (needle_len == 1) return memory_find_byte(haystack, haystack_len, *(const u8 *)needle);
+
+    return memory_search_kernels()->find((const u8 *)haystack, haystack_len, (const u8 *)needle, needle_len);
+}
+
+isize memory_find_last(const void *haystack, isize haystack_len, const void *needle, isize needle_len)
+{
+    if (needle_len == 0) return Max(haystack_len, (isize)0);
+    if (needle_len > haystack_len) return -1;
+    if (needle_len == 1) return memory_find_last_byte(haystack, haystack_len, *(const u8 *)needle);
+
+    return memory_search_kernels()->find_last((const u8 *)haystack, haystack_len, (const u8 *)needle,
+                                              needle_len);
+}
+
+const char *memory_search_backend(void)
+{
+    return memory_search_kernels()->name;
+}
+
+}
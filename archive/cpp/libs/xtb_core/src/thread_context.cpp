@@ -1,31 +1,92 @@
 #include <xtb_core/thread_context.h>
 #include <xtb_core/intrinsics.h>
 #include <xtb_core/contract.h>
+#include <xtb_core/logger.h>
+#include <xtb_core/pool.h>
 
 namespace xtb
 {
 
 thread_local ThreadContext *g_tctx;
 
+static bool scratch_has_conflict(Arena *arena, Arena **conflicts, isize count)
+{
+    for (isize i = 0; i < count; i += 1)
+    {
+        if (arena == conflicts[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Scopes take arenas in ring order, so a nested scope never lands on an enclosing
+// scope's arena until the ring wraps. Conflicts only ever push the pick forward.
+static isize scratch_select(ThreadContext *tctx, Arena **conflicts, isize count)
+{
+    isize index = tctx->scratch_depth % tctx->arena_count;
+    for (isize attempt = 0; attempt < tctx->arena_count; attempt += 1)
+    {
+        if (!scratch_has_conflict(tctx->arenas[index], conflicts, count))
+        {
+            return index;
+        }
+        index = (index + 1) % tctx->arena_count;
+    }
+
+    panic("All scratch arenas conflict with the %lli given, raise the scratch count",
+          (lli)count);
+}
+
+ThreadContextConfig ThreadContext::default_config()
+{
+    ThreadContextConfig config = {};
+    config.scratch_count = 2;
+    config.scratch_size = Kilobytes(64);
+    config.scratch_backend = ARENA_BACKEND_MALLOC;
+    return config;
+}
+
 void ThreadContext::init(ThreadContext* tctx)
+{
+    ThreadContext::init(tctx, ThreadContext::default_config());
+}
+
+void ThreadContext::init(ThreadContext* tctx, ThreadContextConfig config)
 {
     Assert(g_tctx == NULL);
+    Assert(config.scratch_count >= 2 && config.scratch_count <= THREAD_CONTEXT_MAX_SCRATCH_ARENAS);
 
     MemoryZeroStruct(tctx);
-    Arena **arena_ptr = tctx->arenas;
-    for (size_t i = 0; i < ArrLen(tctx->arenas); i += 1, arena_ptr += 1)
+    tctx->arena_count = config.scratch_count;
+    for (isize i = 0; i < tctx->arena_count; i += 1)
     {
-        *arena_ptr = arena_new(Kilobytes(64));
+        if (config.scratch_backend == ARENA_BACKEND_VIRTUAL)
+        {
+            tctx->arenas[i] = arena_new_virtual(config.scratch_size);
+        }
+        else
+        {
+            tctx->arenas[i] = arena_new(config.scratch_size);
+        }
+        Assert(tctx->arenas[i] != NULL);
+        arena_set_name(tctx->arenas[i], "scratch");
     }
     g_tctx = tctx;
 }
 
 void ThreadContext::deinit()
 {
-    for (size_t i = 0; i < ArrLen(g_tctx->arenas); i += 1)
+    Assert(g_tctx->scratch_depth == 0);
+
+    for (isize i = 0; i < g_tctx->arena_count; i += 1)
     {
         arena_release(g_tctx->arenas[i]);
     }
+
+    pool_allocator_thread_detach();
+    g_tctx = NULL;
 }
 
 ThreadContext* ThreadContext::get()
@@ -37,29 +98,39 @@ ThreadContext* ThreadContext::get()
 Arena *ThreadContext::get_scratch(Arena **conflicts, isize count)
 {
     ThreadContext *tctx = ThreadContext::get();
+    return tctx->arenas[scratch_select(tctx, conflicts, count)];
+}
+
+isize ThreadContext::push_scratch(Arena **conflicts, isize count)
+{
+    ThreadContext *tctx = ThreadContext::get();
+
+    isize index = scratch_select(tctx, conflicts, count);
+    tctx->scratch_depth += 1;
+
+    return index;
+}
 
-    Arena *result = 0;
-    Arena **arena_ptr = tctx->arenas;
-    for (size_t i = 0; i < ArrLen(tctx->arenas); i += 1, arena_ptr += 1)
+void ThreadContext::pop_scratch(isize index)
+{
+    ThreadContext *tctx = ThreadContext::get();
+    Assert(tctx->scratch_depth > 0);
+    Assert(index >= 0 && index < tctx->arena_count);
+
+    size_t usage = arena_dump_memory_usage(tctx->arenas[index]);
+    tctx->high_water_marks[index] = Max(tctx->high_water_marks[index], usage);
+    tctx->scratch_depth -= 1;
+}
+
+void ThreadContext::dump_scratch_usage()
+{
+    ThreadContext *tctx = ThreadContext::get();
+
+    for (isize i = 0; i < tctx->arena_count; i += 1)
     {
-        Arena **conflict_ptr = conflicts;
-        bool has_conflict = false;
-        for (isize j = 0; j < count; j += 1, conflict_ptr += 1)
-        {
-            if (*arena_ptr == *conflict_ptr)
-            {
-                has_conflict = 1;
-                break;
-            }
-        }
-        if (!has_conflict)
-        {
-            result = *arena_ptr;
-            break;
-        }
+        LOG_INFO("scratch[%lli]: high water %zu bytes, %zu in use",
+                 (lli)i, tctx->high_water_marks[i], arena_dump_memory_usage(tctx->arenas[i]));
     }
-
-    return result;
 }
 
 }
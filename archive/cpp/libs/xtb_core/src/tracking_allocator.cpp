@@ -0,0 +1,406 @@
+#include <xtb_core/tracking_allocator.h>
+#include <xtb_core/contract.h>
+#include <xtb_core/logger.h>
+#include <xtb_core/stacktrace.h>
+#include <xtb_core/thread_context.h>
+#include <xtb_core/array.h>
+
+#include <algorithm>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+#define TRACKING_INITIAL_TABLE_CAPACITY 256
+
+static u64 tracking_hash_pointer(const void *ptr)
+{
+    return ((u64)(uintptr_t)ptr >> 4) * 0x9E3779B97F4A7C15ull;
+}
+
+static u64 tracking_hash_frames(const uintptr_t *frames, i32 frame_count)
+{
+    u64 hash = 0xcbf29ce484222325ull;
+    for (i32 i = 0; i < frame_count; ++i)
+    {
+        hash = (hash ^ (u64)frames[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static i32 tracking_size_bucket(i64 size)
+{
+    i32 bucket = 0;
+    while (bucket < TRACKING_SIZE_HISTOGRAM_BUCKETS - 1 && size > ((i64)16 << bucket))
+    {
+        bucket += 1;
+    }
+    return bucket;
+}
+
+static void tracking_callsite_slots_rebuild(TrackingAllocator *tracker, isize capacity)
+{
+    free(tracker->callsite_slots);
+    tracker->callsite_slots = (isize *)malloc(sizeof(isize) * capacity);
+    tracker->callsite_slot_capacity = capacity;
+
+    for (isize i = 0; i < capacity; ++i)
+    {
+        tracker->callsite_slots[i] = -1;
+    }
+
+    isize mask = capacity - 1;
+    for (isize index = 0; index < tracker->callsite_count; ++index)
+    {
+        TrackingCallsite *callsite = &tracker->callsites[index];
+        isize slot = (isize)(tracking_hash_frames(callsite->frames, callsite->frame_count) & mask);
+        while (tracker->callsite_slots[slot] != -1)
+        {
+            slot = (slot + 1) & mask;
+        }
+        tracker->callsite_slots[slot] = index;
+    }
+}
+
+static isize tracking_callsite_get(TrackingAllocator *tracker, const uintptr_t *frames, i32 frame_count)
+{
+    isize mask = tracker->callsite_slot_capacity - 1;
+    isize slot = (isize)(tracking_hash_frames(frames, frame_count) & mask);
+
+    for (; tracker->callsite_slots[slot] != -1; slot = (slot + 1) & mask)
+    {
+        TrackingCallsite *callsite = &tracker->callsites[tracker->callsite_slots[slot]];
+        if (callsite->frame_count == frame_count
+            && memcmp(callsite->frames, frames, sizeof(uintptr_t) * frame_count) == 0)
+        {
+            return tracker->callsite_slots[slot];
+        }
+    }
+
+    if (tracker->callsite_count == tracker->callsite_capacity)
+    {
+        isize new_capacity = GrowGeometric(tracker->callsite_capacity, TRACKING_INITIAL_TABLE_CAPACITY);
+        tracker->callsites = (TrackingCallsite *)realloc(tracker->callsites, sizeof(TrackingCallsite) * new_capacity);
+        tracker->callsite_capacity = new_capacity;
+    }
+
+    isize index = tracker->callsite_count++;
+    TrackingCallsite *callsite = &tracker->callsites[index];
+    MemoryZeroStruct(callsite);
+    memcpy(callsite->frames, frames, sizeof(uintptr_t) * frame_count);
+    callsite->frame_count = frame_count;
+
+    if (tracker->callsite_count * 2 > tracker->callsite_slot_capacity)
+    {
+        tracking_callsite_slots_rebuild(tracker, tracker->callsite_slot_capacity * 2);
+    }
+    else
+    {
+        tracker->callsite_slots[slot] = index;
+    }
+
+    return index;
+}
+
+static isize tracking_live_slot(TrackingAllocator *tracker, void *ptr)
+{
+    isize mask = tracker->live_capacity - 1;
+    isize slot = (isize)(tracking_hash_pointer(ptr) & mask);
+
+    while (tracker->live[slot].ptr != NULL && tracker->live[slot].ptr != ptr)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static void tracking_live_put(TrackingAllocator *tracker, TrackingLiveAllocation record);
+
+static void tracking_live_grow(TrackingAllocator *tracker)
+{
+    TrackingLiveAllocation *old_live = tracker->live;
+    isize old_capacity = tracker->live_capacity;
+
+    tracker->live_capacity = old_capacity * 2;
+    tracker->live = (TrackingLiveAllocation *)calloc(tracker->live_capacity, sizeof(TrackingLiveAllocation));
+    tracker->live_count = 0;
+
+    for (isize i = 0; i < old_capacity; ++i)
+    {
+        if (old_live[i].ptr != NULL)
+        {
+            tracking_live_put(tracker, old_live[i]);
+        }
+    }
+
+    free(old_live);
+}
+
+// Overwrites a stale record for the same pointer, e.g. one freed behind the tracker's back
+static void tracking_live_put(TrackingAllocator *tracker, TrackingLiveAllocation record)
+{
+    if ((tracker->live_count + 1) * 2 > tracker->live_capacity)
+    {
+        tracking_live_grow(tracker);
+    }
+
+    isize slot = tracking_live_slot(tracker, record.ptr);
+    if (tracker->live[slot].ptr == NULL)
+    {
+        tracker->live_count += 1;
+    }
+    tracker->live[slot] = record;
+}
+
+static bool tracking_live_take(TrackingAllocator *tracker, void *ptr, TrackingLiveAllocation *out)
+{
+    isize mask = tracker->live_capacity - 1;
+    isize slot = tracking_live_slot(tracker, ptr);
+    if (tracker->live[slot].ptr == NULL)
+    {
+        return false;
+    }
+
+    *out = tracker->live[slot];
+    tracker->live_count -= 1;
+
+    // Backward-shift deletion keeps the probe sequences intact without tombstones
+    isize hole = slot;
+    isize next = (slot + 1) & mask;
+    while (tracker->live[next].ptr != NULL)
+    {
+        isize home = (isize)(tracking_hash_pointer(tracker->live[next].ptr) & mask);
+        bool movable = ((next - home) & mask) >= ((next - hole) & mask);
+        if (movable)
+        {
+            tracker->live[hole] = tracker->live[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    tracker->live[hole].ptr = NULL;
+
+    return true;
+}
+
+static void *tracking_allocator_procedure(void* alloc, int64_t new_size, void* old_ptr, int64_t old_size, int64_t align)
+{
+    TrackingAllocator *tracker = (TrackingAllocator *)alloc;
+
+    std::lock_guard<std::mutex> guard(tracker->lock);
+
+    TrackingLiveAllocation old_record = {};
+    bool old_tracked = old_ptr != NULL && tracking_live_take(tracker, old_ptr, &old_record);
+
+    void *new_ptr = (*tracker->backing)(tracker->backing, new_size, old_ptr, old_size, align);
+
+    if (new_size > 0 && new_ptr == NULL)
+    {
+        // The old block is still valid
+        if (old_tracked) tracking_live_put(tracker, old_record);
+        return NULL;
+    }
+
+    if (old_tracked)
+    {
+        TrackingCallsite *origin = &tracker->callsites[old_record.callsite_index];
+        origin->live_bytes -= old_record.size;
+        tracker->live_bytes -= old_record.size;
+
+        if (new_size == 0)
+        {
+            origin->deallocation_count += 1;
+            tracker->deallocation_count += 1;
+        }
+    }
+
+    if (new_size == 0)
+    {
+        return new_ptr;
+    }
+
+    uintptr_t frames[TRACKING_CALLSITE_DEPTH];
+    i32 frame_count = stacktrace::capture(frames, TRACKING_CALLSITE_DEPTH, 1);
+    if (frame_count == 0)
+    {
+        // No debug info, everything lands in one bucket
+        frames[0] = 0;
+        frame_count = 1;
+    }
+
+    isize callsite_index = tracking_callsite_get(tracker, frames, frame_count);
+    TrackingCallsite *callsite = &tracker->callsites[callsite_index];
+
+    i64 realloc_chain = 0;
+    if (old_ptr != NULL)
+    {
+        realloc_chain = old_tracked ? old_record.realloc_chain + 1 : 1;
+        callsite->reallocation_count += 1;
+        callsite->longest_realloc_chain = Max(callsite->longest_realloc_chain, realloc_chain);
+        tracker->reallocation_count += 1;
+    }
+    else
+    {
+        callsite->allocation_count += 1;
+        tracker->allocation_count += 1;
+    }
+
+    callsite->requested_bytes += new_size;
+    callsite->size_histogram[tracking_size_bucket(new_size)] += 1;
+    callsite->live_bytes += new_size;
+    callsite->peak_live_bytes = Max(callsite->peak_live_bytes, callsite->live_bytes);
+
+    tracker->live_bytes += new_size;
+    tracker->peak_live_bytes = Max(tracker->peak_live_bytes, tracker->live_bytes);
+
+    TrackingLiveAllocation record = {
+        .ptr = new_ptr,
+        .size = new_size,
+        .realloc_chain = realloc_chain,
+        .callsite_index = callsite_index,
+    };
+    tracking_live_put(tracker, record);
+
+    return new_ptr;
+}
+
+static bool tracking_is_allocator_frame(String description)
+{
+    // Descriptions are NUL-terminated, and the demangled name may start with a return type
+    const char *cstr = (const char *)description.data();
+    return strstr(cstr, "xtb::allocat") != NULL
+        || strstr(cstr, "xtb::reallocate") != NULL
+        || strstr(cstr, "xtb::deallocate") != NULL;
+}
+
+static void tracking_log_histogram(const TrackingCallsite *callsite)
+{
+    char buffer[512];
+    isize length = 0;
+
+    for (i32 bucket = 0; bucket < TRACKING_SIZE_HISTOGRAM_BUCKETS; ++bucket)
+    {
+        if (callsite->size_histogram[bucket] == 0) continue;
+
+        const char *bound = bucket == TRACKING_SIZE_HISTOGRAM_BUCKETS - 1 ? ">" : "<=";
+        i64 bound_size = (i64)16 << Min(bucket, TRACKING_SIZE_HISTOGRAM_BUCKETS - 2);
+
+        length += snprintf(buffer + length, sizeof(buffer) - length, " %s%lld:%lld",
+                           bound, (lli)bound_size, (lli)callsite->size_histogram[bucket]);
+        if (length >= (isize)sizeof(buffer)) break;
+    }
+
+    LOG_INFO("    sizes:%s", buffer);
+}
+
+/****************************
+ * Tracking Allocator API
+ ***************************/
+TrackingAllocator *tracking_allocator_new(Allocator *backing)
+{
+    TrackingAllocator *tracker = new (malloc(sizeof(TrackingAllocator))) TrackingAllocator;
+
+    tracker->allocator = tracking_allocator_procedure;
+    tracker->backing = backing;
+
+    tracker->live_bytes = 0;
+    tracker->peak_live_bytes = 0;
+    tracker->allocation_count = 0;
+    tracker->reallocation_count = 0;
+    tracker->deallocation_count = 0;
+
+    tracker->callsites = NULL;
+    tracker->callsite_count = 0;
+    tracker->callsite_capacity = 0;
+
+    tracker->callsite_slots = NULL;
+    tracking_callsite_slots_rebuild(tracker, TRACKING_INITIAL_TABLE_CAPACITY);
+
+    tracker->live = (TrackingLiveAllocation *)calloc(TRACKING_INITIAL_TABLE_CAPACITY, sizeof(TrackingLiveAllocation));
+    tracker->live_count = 0;
+    tracker->live_capacity = TRACKING_INITIAL_TABLE_CAPACITY;
+
+    return tracker;
+}
+
+void tracking_allocator_release(TrackingAllocator *tracker)
+{
+    free(tracker->callsites);
+    free(tracker->callsite_slots);
+    free(tracker->live);
+
+    tracker->~TrackingAllocator();
+    free(tracker);
+}
+
+void tracking_allocator_dump(TrackingAllocator *tracker, isize top_count)
+{
+    ScratchScope scratch;
+
+    // Snapshot under the lock, symbolizing is slow and must not hold up other threads
+    Array<TrackingCallsite> top = Array<TrackingCallsite>::init(&scratch->allocator);
+    i64 live_bytes, peak_live_bytes, allocation_count, reallocation_count, deallocation_count;
+    isize callsite_count;
+    {
+        std::lock_guard<std::mutex> guard(tracker->lock);
+
+        live_bytes = tracker->live_bytes;
+        peak_live_bytes = tracker->peak_live_bytes;
+        allocation_count = tracker->allocation_count;
+        reallocation_count = tracker->reallocation_count;
+        deallocation_count = tracker->deallocation_count;
+        callsite_count = tracker->callsite_count;
+
+        top = Array<TrackingCallsite>(&scratch->allocator, tracker->callsites, tracker->callsite_count);
+    }
+
+    TrackingCallsite *top_begin = top.data();
+    TrackingCallsite *top_end = top.data() + top.size();
+    TrackingCallsite *top_middle = top_begin + Clamp(top_count, 0, top.size());
+    std::partial_sort(top_begin, top_middle, top_end, [](const TrackingCallsite &a, const TrackingCallsite &b) {
+        return a.peak_live_bytes > b.peak_live_bytes;
+    });
+
+    LOG_INFO("Allocations: %lld live bytes (peak %lld), %lld allocations, %lld reallocations, %lld deallocations across %lld callsites",
+             (lli)live_bytes, (lli)peak_live_bytes,
+             (lli)allocation_count, (lli)reallocation_count, (lli)deallocation_count,
+             (lli)callsite_count);
+
+    for (TrackingCallsite *callsite = top_begin; callsite != top_middle; ++callsite)
+    {
+        LOG_INFO("#%lld: peak %lld B, live %lld B, requested %lld B, %lld allocs, %lld reallocs (longest chain %lld), %lld frees",
+                 (lli)(callsite - top_begin + 1),
+                 (lli)callsite->peak_live_bytes, (lli)callsite->live_bytes, (lli)callsite->requested_bytes,
+                 (lli)callsite->allocation_count, (lli)callsite->reallocation_count,
+                 (lli)callsite->longest_realloc_chain, (lli)callsite->deallocation_count);
+
+        tracking_log_histogram(callsite);
+
+        bool skipping_allocator_frames = true;
+        for (i32 i = 0; i < callsite->frame_count; ++i)
+        {
+            String description = stacktrace::describe_address(&scratch->allocator, callsite->frames[i]);
+
+            bool is_last_frame = i == callsite->frame_count - 1;
+            if (skipping_allocator_frames && !is_last_frame && tracking_is_allocator_frame(description))
+            {
+                continue;
+            }
+            skipping_allocator_frames = false;
+
+            LOG_INFO("    at %.*s", (int)description.len(), description.data());
+
+            // Same cut-off as the stack trace printer, the frames past main are libc startup
+            if (description.starts_with("main ") || description == "main") break;
+        }
+    }
+}
+
+}
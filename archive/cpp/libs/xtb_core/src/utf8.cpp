@@ -0,0 +1,483 @@
+#include <xtb_core/utf8.h>
+
+#include <string.h>
+
+#if ARCH_X64 || ARCH_X86
+#include <immintrin.h>
+#define UTF8_X86 1
+#else
+#define UTF8_X86 0
+#endif
+
+#if COMPILER_GCC || COMPILER_CLANG
+#define UTF8_TARGET(isa) __attribute__((target(isa)))
+#else
+#define UTF8_TARGET(isa)
+#endif
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+// Every kernel gets `start` on a sequence boundary and returns an absolute offset
+using Utf8FindInvalidFn = isize (*)(const u8 *data, isize size, isize start);
+
+struct Utf8Validator
+{
+    const char *name;
+    Utf8FindInvalidFn find_invalid;
+};
+
+static const u64 g_utf8_high_bits = 0x8080808080808080ull;
+
+// Length of a well-formed sequence starting at data[0], 0 if there isn't one.
+// The ranges for the second byte are the ones from table 3-7 of the Unicode standard
+static isize utf8_sequence_length(const u8 *data, isize size)
+{
+    u8 c = data[0];
+    if (c < 0x80) return 1;
+
+    isize len;
+    u8 low = 0x80;
+    u8 high = 0xBF;
+    if (c < 0xC2) return 0;
+    else if (c < 0xE0) len = 2;
+    else if (c < 0xF0)
+    {
+        len = 3;
+        if (c == 0xE0) low = 0xA0;
+        if (c == 0xED) high = 0x9F;
+    }
+    else if (c < 0xF5)
+    {
+        len = 4;
+        if (c == 0xF0) low = 0x90;
+        if (c == 0xF4) high = 0x8F;
+    }
+    else return 0;
+
+    if (size < len) return 0;
+    if (data[1] < low || data[1] > high) return 0;
+    for (isize i = 2; i < len; ++i)
+    {
+        if (!utf8_is_continuation(data[i])) return 0;
+    }
+
+    return len;
+}
+
+// Where the scalar validator picks up after the vector loop stopped at `offset`:
+// the start of the sequence holding the byte before it, which can run past
+// `offset` or be the reason the loop stopped. Everything before `offset` up to
+// that sequence is known to be valid
+static isize utf8_resume_offset(const u8 *data, isize start, isize offset)
+{
+    if (offset == start) return start;
+
+    isize resume = offset - 1;
+    while (resume > start && offset - resume < 4 && utf8_is_continuation(data[resume]))
+    {
+        resume -= 1;
+    }
+    return resume;
+}
+
+/****************************
+ * Scalar validator
+ ***************************/
+static isize utf8_find_invalid_scalar(const u8 *data, isize size, isize start)
+{
+    isize i = start;
+    while (i < size)
+    {
+        // ASCII runs a word at a time
+        while (i + 8 <= size)
+        {
+            u64 word;
+            memcpy(&word, data + i, sizeof(word));
+            if ((word & g_utf8_high_bits) != 0) break;
+            i += 8;
+        }
+
+        if (i >= size) break;
+        if (data[i] < 0x80)
+        {
+            i += 1;
+            continue;
+        }
+
+        isize len = utf8_sequence_length(data + i, size - i);
+        if (len == 0) return i;
+        i += len;
+    }
+
+    return -1;
+}
+
+static const Utf8Validator g_utf8_validator_scalar = {
+    "scalar", utf8_find_invalid_scalar,
+};
+
+#if UTF8_X86
+#if COMPILER_GCC || COMPILER_CLANG
+/****************************
+ * AVX2 validator
+ *
+ * The lookup algorithm from Keiser and Lemire, "Validating UTF-8 In
+ * Less Than One Instruction Per Byte". Every byte is classified by
+ * three table lookups on the high and low nibble of the previous byte
+ * and the high nibble of the current one, whose AND is non-zero
+ * exactly where a two byte pattern is illegal. Third and fourth
+ * bytes of longer sequences are checked by comparing against the
+ * bytes two and three back. A block with errors only says that it
+ * has one, the scalar validator then finds where.
+ ***************************/
+// Bit flags for the illegal pairs of (previous byte, current byte)
+#define UTF8_TOO_SHORT  (1 << 0) // 11______ 0_______ or 11______ 11______
+#define UTF8_TOO_LONG   (1 << 1) // 0_______ 10______
+#define UTF8_OVERLONG_3 (1 << 2) // 11100000 100_____
+#define UTF8_TOO_LARGE  (1 << 3) // 11110100 1001____ and above
+#define UTF8_SURROGATE  (1 << 4) // 11101101 101_____
+#define UTF8_OVERLONG_2 (1 << 5) // 1100000_ 10______
+#define UTF8_TOO_LARGE_1000 (1 << 6) // 11110101 1000____ and above
+#define UTF8_OVERLONG_4 (1 << 6) // 11110000 1000____
+#define UTF8_TWO_CONTS  (1 << 7) // 10______ 10______
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+UTF8_TARGET("avx2")
+static __m256i utf8_lookup_avx2(__m256i table, __m256i index)
+{
+    return _mm256_shuffle_epi8(table, index);
+}
+
+UTF8_TARGET("avx2")
+static __m256i utf8_table_avx2(const u8 *table)
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+}
+
+// The 32 bytes ending `shift` bytes before the end of `input`
+#define UTF8_PREV_AVX2(input, prev_input, shift) \
+    _mm256_alignr_epi8((input), _mm256_permute2x128_si256((prev_input), (input), 0x21), 16 - (shift))
+
+UTF8_TARGET("avx2")
+static isize utf8_find_invalid_avx2(const u8 *data, isize size, isize start)
+{
+    static const u8 byte_1_high_table[16] = {
+        // 0_______ ASCII
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        // 10______ continuation
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        // 1100____ and 1101____ two byte leads
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        // 1110____ three byte lead
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        // 1111____ four byte lead
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    };
+    static const u8 byte_1_low_table[16] = {
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, // ____0000
+        UTF8_CARRY | UTF8_OVERLONG_2,                                     // ____0001
+        UTF8_CARRY,                                                       // ____001_
+        UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE,                                      // ____0100
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____0101
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____011_
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____1___
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE, // ____1101
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    };
+    static const u8 byte_2_high_table[16] = {
+        // ________ 0_______ ASCII
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        // ________ 1000____
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3
+            | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        // ________ 1001____
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        // ________ 101_____
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        // ________ 11______
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    };
+    // A block ending in any byte above these leaves a sequence open
+    static const u8 incomplete_max[32] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+    };
+
+    const __m256i byte_1_high = utf8_table_avx2(byte_1_high_table);
+    const __m256i byte_1_low = utf8_table_avx2(byte_1_low_table);
+    const __m256i byte_2_high = utf8_table_avx2(byte_2_high_table);
+    const __m256i max_values = _mm256_loadu_si256((const __m256i *)incomplete_max);
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    const __m256i high_bit = _mm256_set1_epi8((char)0x80);
+
+    // `start` is a sequence boundary, so nothing carries in from before it
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+
+    isize i = start;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i input = _mm256_loadu_si256((const __m256i *)(data + i));
+
+        __m256i error;
+        if (_mm256_movemask_epi8(input) == 0)
+        {
+            // All ASCII, only a sequence left open by the previous block can be wrong
+            error = prev_incomplete;
+        }
+        else
+        {
+            __m256i prev1 = UTF8_PREV_AVX2(input, prev_input, 1);
+            __m256i prev1_high = _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble);
+            __m256i prev1_low = _mm256_and_si256(prev1, low_nibble);
+            __m256i input_high = _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble);
+
+            __m256i special_cases = _mm256_and_si256(
+                _mm256_and_si256(utf8_lookup_avx2(byte_1_high, prev1_high),
+                                 utf8_lookup_avx2(byte_1_low, prev1_low)),
+                utf8_lookup_avx2(byte_2_high, input_high));
+
+            // Bytes 2 and 3 back are three and four byte leads where a continuation has to follow
+            __m256i prev2 = UTF8_PREV_AVX2(input, prev_input, 2);
+            __m256i prev3 = UTF8_PREV_AVX2(input, prev_input, 3);
+            __m256i is_third_byte = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+            __m256i is_fourth_byte = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+            __m256i must_be_continuation = _mm256_and_si256(
+                _mm256_or_si256(is_third_byte, is_fourth_byte), high_bit);
+
+            error = _mm256_xor_si256(must_be_continuation, special_cases);
+            prev_incomplete = _mm256_subs_epu8(input, max_values);
+        }
+
+        if (!_mm256_testz_si256(error, error))
+        {
+            return utf8_find_invalid_scalar(data, size, utf8_resume_offset(data, start, i));
+        }
+
+        prev_input = input;
+    }
+
+    // The tail, and any sequence the last block left open
+    return utf8_find_invalid_scalar(data, size, utf8_resume_offset(data, start, i));
+}
+
+#undef UTF8_PREV_AVX2
+
+static const Utf8Validator g_utf8_validator_avx2 = {
+    "avx2", utf8_find_invalid_avx2,
+};
+#endif // COMPILER_GCC || COMPILER_CLANG
+#endif // UTF8_X86
+
+static const Utf8Validator *utf8_select_validator(void)
+{
+#if UTF8_X86 && (COMPILER_GCC || COMPILER_CLANG)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &g_utf8_validator_avx2;
+#endif
+    return &g_utf8_validator_scalar;
+}
+
+static const Utf8Validator *utf8_validator(void)
+{
+    static const Utf8Validator *validator = utf8_select_validator();
+    return validator;
+}
+
+/****************************
+ * Width tables
+ ***************************/
+struct Utf8Range
+{
+    u32 first;
+    u32 last;
+};
+
+// Combining marks and other characters that don't advance the cursor
+static const Utf8Range g_utf8_zero_width[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+    { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+    { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+    { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0711, 0x0711 }, { 0x0730, 0x074A },
+    { 0x0900, 0x0902 }, { 0x093A, 0x093A }, { 0x093C, 0x093C }, { 0x0941, 0x0948 },
+    { 0x094D, 0x094D }, { 0x0951, 0x0957 }, { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A },
+    { 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F },
+    { 0x202A, 0x202E }, { 0x2060, 0x2064 }, { 0x20D0, 0x20FF }, { 0xFE00, 0xFE0F },
+    { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }, { 0x1F3FB, 0x1F3FF }, { 0xE0000, 0xE0FFF },
+};
+
+// East Asian wide and fullwidth characters and emoji presentation blocks
+static const Utf8Range g_utf8_double_width[] = {
+    { 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC },
+    { 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 },
+    { 0x2648, 0x2653 }, { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+    { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26CE, 0x26CE },
+    { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+    { 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+    { 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+    { 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF },
+    { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x303E },
+    { 0x3041, 0x33FF }, { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF },
+    { 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 },
+    { 0xFE30, 0xFE6F }, { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x18CFF },
+    { 0x1B000, 0x1B2FF }, { 0x1F004, 0x1F004 }, { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E },
+    { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F251 }, { 0x1F300, 0x1F320 }, { 0x1F32D, 0x1F335 },
+    { 0x1F337, 0x1F37C }, { 0x1F37E, 0x1F393 }, { 0x1F3A0, 0x1F3CA }, { 0x1F3CF, 0x1F3D3 },
+    { 0x1F3E0, 0x1F3F0 }, { 0x1F3F4, 0x1F3F4 }, { 0x1F3F8, 0x1F3FA }, { 0x1F400, 0x1F43E },
+    { 0x1F440, 0x1F440 }, { 0x1F442, 0x1F4FC }, { 0x1F4FF, 0x1F53D }, { 0x1F54B, 0x1F54E },
+    { 0x1F550, 0x1F567 }, { 0x1F57A, 0x1F57A }, { 0x1F595, 0x1F596 }, { 0x1F5A4, 0x1F5A4 },
+    { 0x1F5FB, 0x1F64F }, { 0x1F680, 0x1F6C5 }, { 0x1F6CC, 0x1F6CC }, { 0x1F6D0, 0x1F6D2 },
+    { 0x1F6D5, 0x1F6D7 }, { 0x1F6EB, 0x1F6EC }, { 0x1F6F4, 0x1F6FC }, { 0x1F7E0, 0x1F7EB },
+    { 0x1F90C, 0x1F93A }, { 0x1F93C, 0x1F945 }, { 0x1F947, 0x1F9FF }, { 0x1FA70, 0x1FAFF },
+    { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD },
+};
+
+static bool utf8_range_table_contains(const Utf8Range *ranges, isize count, u32 codepoint)
+{
+    if (codepoint < ranges[0].first || codepoint > ranges[count - 1].last) return false;
+
+    isize low = 0;
+    isize high = count - 1;
+    while (low <= high)
+    {
+        isize middle = low + (high - low) / 2;
+        if (codepoint < ranges[middle].first) high = middle - 1;
+        else if (codepoint > ranges[middle].last) low = middle + 1;
+        else return true;
+    }
+    return false;
+}
+
+/****************************
+ * UTF-8 API
+ ***************************/
+isize utf8_find_invalid(const void *data, isize size)
+{
+    if (size <= 0) return -1;
+    return utf8_validator()->find_invalid((const u8 *)data, size, 0);
+}
+
+const char *utf8_validate_backend(void)
+{
+    return utf8_validator()->name;
+}
+
+isize utf8_decode(const u8 *data, isize size, u32 *codepoint)
+{
+    Assert(size > 0);
+
+    isize len = utf8_sequence_length(data, size);
+    switch (len)
+    {
+        case 1: *codepoint = data[0]; break;
+        case 2: *codepoint = ((u32)(data[0] & 0x1F) << 6) | (data[1] & 0x3F); break;
+        case 3:
+            *codepoint = ((u32)(data[0] & 0x0F) << 12) | ((u32)(data[1] & 0x3F) << 6) | (data[2] & 0x3F);
+            break;
+        case 4:
+            *codepoint = ((u32)(data[0] & 0x07) << 18) | ((u32)(data[1] & 0x3F) << 12)
+                       | ((u32)(data[2] & 0x3F) << 6) | (data[3] & 0x3F);
+            break;
+        default: *codepoint = UTF8_REPLACEMENT_CHARACTER; break;
+    }
+
+    return len;
+}
+
+isize utf8_encode(u32 codepoint, u8 *out)
+{
+    if (codepoint < 0x80)
+    {
+        out[0] = (u8)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800)
+    {
+        out[0] = (u8)(0xC0 | (codepoint >> 6));
+        out[1] = (u8)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0x10000)
+    {
+        if (codepoint >= 0xD800 && codepoint <= 0xDFFF) return 0;
+
+        out[0] = (u8)(0xE0 | (codepoint >> 12));
+        out[1] = (u8)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (u8)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    if (codepoint <= UTF8_MAX_CODEPOINT)
+    {
+        out[0] = (u8)(0xF0 | (codepoint >> 18));
+        out[1] = (u8)(0x80 | ((codepoint >> 12) & 0x3F));
+        out[2] = (u8)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[3] = (u8)(0x80 | (codepoint & 0x3F));
+        return 4;
+    }
+
+    return 0;
+}
+
+isize utf8_count_codepoints(String string)
+{
+    const u8 *data = string.data();
+    isize size = string.len();
+
+    // Counts continuation bytes, 10______, 8 at a time: bit 7 set and bit 6,
+    // shifted up into bit 7's place, clear
+    isize continuations = 0;
+    isize i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        u64 word;
+        memcpy(&word, data + i, sizeof(word));
+        continuations += __builtin_popcountll(word & ~(word << 1) & g_utf8_high_bits);
+    }
+    for (; i < size; ++i)
+    {
+        continuations += utf8_is_continuation(data[i]);
+    }
+
+    return size - continuations;
+}
+
+i32 utf8_codepoint_width(u32 codepoint)
+{
+    if (codepoint < 0x7F) return codepoint >= 0x20 ? 1 : 0;
+    if (codepoint < 0xA0) return 0;
+
+    if (utf8_range_table_contains(g_utf8_zero_width, ArrLen(g_utf8_zero_width), codepoint)) return 0;
+    if (utf8_range_table_contains(g_utf8_double_width, ArrLen(g_utf8_double_width), codepoint)) return 2;
+    return 1;
+}
+
+isize utf8_width(String string)
+{
+    isize width = 0;
+    Utf8Iterator it = utf8_codepoints(string);
+
+    u32 codepoint;
+    while (it.next(&codepoint))
+    {
+        width += utf8_codepoint_width(codepoint);
+    }
+    return width;
+}
+
+}
@@ -1,4 +1,5 @@
 #include "json.h"
+#include "json_index.h"
 #include <xtb_core/allocator.h>
 #include <xtb_core/contract.h>
 
@@ -9,6 +10,9 @@
 #include <xtb_ansi/ansi.h>
 #include <xtb_core/core.h>
 #include <xtb_core/linked_list.h>
+#include <xtb_core/utf8.h>
+#include <xtb_core/escape.h>
+#include <xtb_core/thread_context.h>
 
 namespace xtb
 {
@@ -16,11 +20,68 @@ namespace xtb
 /****************************************************************
  * Utilities (internal)
 ****************************************************************/
+struct JsonParser
+{
+    // The input is [begin, end), nothing past end is ever read
+    const char *begin;
+    const char *end;
+    Allocator *allocator;
+    Flags32 flags;
+
+    // Items of the arrays being parsed, innermost last. Each array is copied out
+    // at its exact size once it closes, so the document's allocator never sees
+    // the growth
+    Array<JsonValue*> array_items;
+
+    // Arrays and objects currently open
+    isize depth;
+
+    // Where the first failure happened, NULL while there's none
+    const char *error_at;
+    const char *error_message;
+};
+
+// The character at `at`, or '\0' at the end of the input
+static char peek_char(JsonParser *parser, const char *at)
+{
+    return at < parser->end ? at[0] : '\0';
+}
+
+// Only the first failure is kept, the ones it causes further up add nothing
+static void parse_fail(JsonParser *parser, const char *at, const char *message)
+{
+    if (parser->error_at == NULL)
+    {
+        parser->error_at = at;
+        parser->error_message = message;
+    }
+}
+
+// Every parser recurses once per array or object, `at` is the container's opening
+// bracket. Pair each successful call with a parse_leave
+static bool parse_enter(JsonParser *parser, const char *at)
+{
+    if (parser->depth >= JSON_MAX_DEPTH)
+    {
+        parse_fail(parser, at, "arrays and objects nested too deep");
+        return false;
+    }
+    parser->depth += 1;
+    return true;
+}
+
+static void parse_leave(JsonParser *parser)
+{
+    parser->depth -= 1;
+}
+
 static bool is_whitespace(char sym)
 {
     return (sym == ' ' || sym == '\t' || sym == '\n' || sym == '\r');
 }
 
+// For NUL-terminated text such as queries, documents have a length and go through
+// the JsonParser overload below
 static const char* skip_whitespace(const char *input)
 {
     while (is_whitespace(*input))
@@ -31,30 +92,115 @@ static const char* skip_whitespace(const char *input)
     return input;
 }
 
+static const char* skip_whitespace(JsonParser *parser, const char *input)
+{
+    while (input < parser->end && is_whitespace(*input))
+    {
+        input += 1;
+    }
+
+    return input;
+}
+
+static bool starts_with(JsonParser *parser, const char *input, const char *literal, isize length)
+{
+    return parser->end - input >= length && memcmp(input, literal, length) == 0;
+}
+
 static bool is_digit(char ch)
 {
     return (ch >= '0' && ch <= '9');
 }
 
-static String parse_string_literal(const char *input)
+// Turns what's between a literal's quotes into the string's value
+static bool parse_string_body(JsonParser *parser, String body, bool has_escapes, String *out)
+{
+    const char *body_begin = (const char *)body.data();
+
+    // Control characters, NUL included, only go in escaped
+    for (isize i = 0; i < body.len(); i += 1)
+    {
+        if (body.data()[i] < 0x20)
+        {
+            parse_fail(parser, body_begin + i, "unescaped control character in string");
+            return false;
+        }
+    }
+
+    // JSON text has to be UTF-8, a string that isn't fails the parse. Escapes only
+    // ever decode to valid UTF-8, checking the raw bytes is enough
+    isize invalid_offset = utf8_find_invalid(body.data(), body.len());
+    if (invalid_offset >= 0)
+    {
+        parse_fail(parser, body_begin + invalid_offset, "invalid UTF-8 in string");
+        return false;
+    }
+
+    String string = body;
+    if (has_escapes)
+    {
+        u8 *buffer = allocate_bytes(parser->allocator, body.len() + 1);
+        isize error_offset = 0;
+        isize size = unescape_to(buffer, body, ESCAPE_JSON, &error_offset);
+        if (size < 0)
+        {
+            allocator_deallocate(parser->allocator, buffer, body.len() + 1, alignof(u8));
+            parse_fail(parser, body_begin + error_offset, "invalid escape sequence");
+            return false;
+        }
+
+        buffer[size] = '\0';
+        string = String(buffer, size);
+    }
+    else if (!(parser->flags & JSON_PARSE_BORROW_STRINGS))
+    {
+        string = body.copy(parser->allocator);
+    }
+
+    *out = string;
+    return true;
+}
+
+// Parses the literal at `input` into `out`, unescaped, and returns what follows the
+// closing quote. Returns `input` when it isn't a valid string literal
+static const char *parse_string_literal(JsonParser *parser, const char *input, String *out)
 {
     const char *rest = input;
 
-    if (rest[0] != '\"')
+    if (peek_char(parser, rest) != '\"')
     {
-        return String::invalid();
+        parse_fail(parser, rest, "expected a string");
+        return input;
     }
     rest += 1;
 
     const char *string_begin = rest;
+    bool has_escapes = false;
+
+    while (true)
+    {
+        if (rest >= parser->end)
+        {
+            parse_fail(parser, input, "unterminated string");
+            return input;
+        }
+        if (rest[0] == '\"') break;
+        if (rest[0] == '\\')
+        {
+            // Whatever follows the backslash can't close the string
+            has_escapes = true;
+            rest += 1;
+        }
+        rest += 1;
+    }
 
-    while (rest[0] != '\"') rest += 1;
-    Assert(rest[0] == '\"');
+    String body = String((u8*)string_begin, rest - string_begin);
+    if (!parse_string_body(parser, body, has_escapes, out))
+    {
+        return input;
+    }
 
-    const char *string_end = rest;
-    int string_len = string_end - string_begin;
-    String substr = String((u8*)string_begin, string_len);
-    return substr.copy(allocator_get_heap());
+    return rest + 1;
 }
 
 static void indent(int indentation, int level, FILE *stream)
@@ -66,57 +212,101 @@ static void indent(int indentation, int level, FILE *stream)
 /****************************************************************
  * Value initializers (internal)
 ****************************************************************/
-static JsonValue* make_json_value(JsonType type)
+static JsonValue* make_json_value(Allocator *allocator, JsonType type)
 {
-    JsonValue *value = (JsonValue*)calloc(1, sizeof(JsonValue));
+    JsonValue *value = allocate<JsonValue>(allocator);
+    MemoryZero((void*)value, sizeof(JsonValue));
     value->type = type;
     return value;
 }
 
-static JsonValue* make_json_null()
+static JsonValue* make_json_null(Allocator *allocator)
 {
-    return make_json_value(JSON_NULL);
+    return make_json_value(allocator, JSON_NULL);
 }
 
-static JsonValue* make_json_bool(bool boolean_value)
+static JsonValue* make_json_bool(Allocator *allocator, bool boolean_value)
 {
-    JsonValue *value = make_json_value(JSON_BOOL);
+    JsonValue *value = make_json_value(allocator, JSON_BOOL);
     value->as.boolean = boolean_value;
     return value;
 }
 
-static JsonValue *make_json_number(double number)
+static JsonValue *make_json_number(Allocator *allocator, double number)
 {
-    JsonValue *value = make_json_value(JSON_NUMBER);
+    JsonValue *value = make_json_value(allocator, JSON_NUMBER);
     value->as.number = number;
     return value;
 }
 
-static JsonValue *make_json_string(String string)
+static JsonValue *make_json_string(Allocator *allocator, String string)
 {
-    JsonValue *value = make_json_value(JSON_STRING);
+    JsonValue *value = make_json_value(allocator, JSON_STRING);
     value->as.string = string;
     return value;
 }
 
-static JsonValue* make_json_array(JsonArray array)
+// Moves the items pushed since `first_item` into a new array value
+static JsonValue* make_json_array(JsonParser *parser, isize first_item)
 {
-    JsonValue *value = make_json_value(JSON_ARRAY);
-    value->as.array = array;
+    Array<JsonValue*> *items = &parser->array_items;
+
+    JsonValue *value = make_json_value(parser->allocator, JSON_ARRAY);
+    value->as.array = JsonArray::from_pointer(parser->allocator, items->data() + first_item,
+                                              items->size() - first_item);
+    items->resize(first_item);
     return value;
 }
 
-static JsonValue *make_object(JsonPair *first_pair)
+static JsonValue *make_object(Allocator *allocator, JsonPair *first_pair, isize pair_count)
 {
-    JsonValue *value = make_json_value(JSON_OBJECT);
-    value->as.object = first_pair;
+    JsonValue *value = make_json_value(allocator, JSON_OBJECT);
+    value->as.object.first = first_pair;
+    value->as.object.index = NULL;
+
+    if (pair_count >= JSON_OBJECT_INDEX_MIN_KEYS)
+    {
+        StringMap<JsonValue*> *index = allocate<StringMap<JsonValue*>>(allocator);
+        *index = StringMap<JsonValue*>::init_with_capacity(allocator, pair_count);
+
+        for (JsonPair *pair = first_pair; pair != NULL; pair = pair->next)
+        {
+            bool inserted = false;
+            JsonValue **slot = index->get_or_insert(pair->key, &inserted);
+            if (inserted) *slot = pair->value;
+        }
+
+        value->as.object.index = index;
+    }
+
     return value;
 }
 
+static JsonValue *json_object_lookup(JsonValue *value, String key)
+{
+    Assert(json_value_is_object(value));
+
+    if (value->as.object.index != NULL)
+    {
+        JsonValue **found = value->as.object.index->get(key);
+        return found != NULL ? *found : NULL;
+    }
+
+    for (JsonPair *pair = value->as.object.first; pair != NULL; pair = pair->next)
+    {
+        if (pair->key == key)
+        {
+            return pair->value;
+        }
+    }
+
+    return NULL;
+}
+
 // steals the buffers
-static JsonPair *make_pair(String key, JsonValue *value)
+static JsonPair *make_pair(Allocator *allocator, String key, JsonValue *value)
 {
-    JsonPair *pair = (JsonPair*)calloc(1, sizeof(JsonPair));
+    JsonPair *pair = allocate<JsonPair>(allocator);
     pair->key = key;
     pair->value = value;
     pair->next = NULL;
@@ -125,438 +315,849 @@ static JsonPair *make_pair(String key, JsonValue *value)
 
 /****************************************************************
  * Value parsers (internal)
+ *
+ * Each one starts at the first character of its value, fills in
+ * `out` and returns what follows the value. On failure `out` is
+ * left NULL and the parser's error says what went wrong.
 ****************************************************************/
-static const char *parse_value(const char *input, JsonValue **out);
+static const char *parse_value(JsonParser *parser, const char *input, JsonValue **out);
 
-static const char* parse_null(const char *input, JsonValue **out)
+static const char* parse_null(JsonParser *parser, const char *input, JsonValue **out)
 {
-    input = skip_whitespace(input);
-
-    if (strncmp(input, "null", 4) == 0)
+    if (starts_with(parser, input, "null", 4))
     {
-        input += 4;
-        *out = make_json_null();
+        *out = make_json_null(parser->allocator);
+        return input + 4;
     }
 
+    parse_fail(parser, input, "expected null");
     return input;
 }
 
-static const char* parse_boolean(const char *input, JsonValue **out)
+static const char* parse_boolean(JsonParser *parser, const char *input, JsonValue **out)
 {
-    input = skip_whitespace(input);
-
-    if (strncmp(input, "true", 4) == 0)
+    if (starts_with(parser, input, "true", 4))
     {
-        input += 4;
-        *out = make_json_bool(true);
+        *out = make_json_bool(parser->allocator, true);
+        return input + 4;
     }
-    else if (strncmp(input, "false", 5) == 0)
+    else if (starts_with(parser, input, "false", 5))
     {
-        input += 5;
-        *out = make_json_bool(false);
+        *out = make_json_bool(parser->allocator, false);
+        return input + 5;
     }
 
+    parse_fail(parser, input, "expected true or false");
     return input;
 }
 
-static const char* parse_number(const char *input, JsonValue **out)
+static bool is_number_char(char ch)
 {
-    input = skip_whitespace(input);
-
-    char *end;
-    double number = strtod(input, &end);
-    if (end != input)
-    {
-        *out = make_json_number(number);
-        input = end;
-    }
+    return is_digit(ch) || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+}
 
+static const char* skip_digits(const char *input, const char *end)
+{
+    while (input < end && is_digit(*input)) input += 1;
     return input;
 }
 
-static const char *parse_string(const char *input, JsonValue **out)
+// RFC 8259: -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?, returns where
+// the number ends or NULL when it doesn't start with one
+static const char* match_number(const char *input, const char *end)
 {
-    const char *rest = input;
-    rest = skip_whitespace(rest);
+    const char *at = input;
+    if (at < end && *at == '-') at += 1;
+
+    if (at == end || !is_digit(*at)) return NULL;
+    at = *at == '0' ? at + 1 : skip_digits(at, end);
 
-    String string = parse_string_literal(rest);
-    if (string.is_valid())
+    if (at < end && *at == '.')
     {
-        *out = make_json_string(string);
-        return rest + string.len() + 2; // 2 for the quotes
+        at += 1;
+        if (at == end || !is_digit(*at)) return NULL;
+        at = skip_digits(at, end);
     }
 
-    return input;
+    if (at < end && (*at == 'e' || *at == 'E'))
+    {
+        at += 1;
+        if (at < end && (*at == '+' || *at == '-')) at += 1;
+        if (at == end || !is_digit(*at)) return NULL;
+        at = skip_digits(at, end);
+    }
+
+    return at;
 }
 
-static const char *parse_array(const char *input, JsonValue **out)
+// Returns what follows the number, or `input` when there isn't one. The whole run
+// of number characters has to be one number, so "01" or "1-2" fail here and not at
+// whatever comes after the first part
+static const char* scan_number(JsonParser *parser, const char *input, f64 *out)
 {
-    input = skip_whitespace(input);
+    const char *end = input;
+    while (end < parser->end && is_number_char(*end)) end += 1;
 
-    const char *rest = input;
+    if (match_number(input, end) != end)
+    {
+        parse_fail(parser, input, "invalid number");
+        return input;
+    }
 
-    if (rest[0] != '[')
+    isize length;
+    ParseNumberStatus status = parse_f64_prefix((const u8 *)input, end - input, out, &length);
+    Assert(status == PARSE_NUMBER_INVALID || length == end - input);
+    if (status != PARSE_NUMBER_OK)
     {
+        // Infinity has no JSON spelling, json_write_value couldn't write it back
+        parse_fail(parser, input, status == PARSE_NUMBER_OUT_OF_RANGE ? "number out of range" : "invalid number");
         return input;
     }
 
-    rest += 1; // skip [
+    return end;
+}
 
-    JsonArray array = JsonArray::init(allocator_get_heap());
+static const char* parse_number(JsonParser *parser, const char *input, JsonValue **out)
+{
+    f64 number;
+    const char *rest = scan_number(parser, input, &number);
+    if (rest != input)
+    {
+        *out = make_json_number(parser->allocator, number);
+    }
 
-    while (true)
+    return rest;
+}
+
+static const char *parse_string(JsonParser *parser, const char *input, JsonValue **out)
+{
+    String string;
+    const char *end_of_string = parse_string_literal(parser, input, &string);
+    if (end_of_string != input)
     {
-        rest = skip_whitespace(rest);
-        if (rest[0] == ']') break;
+        *out = make_json_string(parser->allocator, string);
+        return end_of_string;
+    }
 
-        JsonValue *value = NULL;
-        const char *end_of_value = parse_value(rest, &value);
+    return input;
+}
 
-        if (value == NULL)
-        {
-            array.deinit();
-            return input;
-        }
-        else
+static const char *parse_array(JsonParser *parser, const char *input, JsonValue **out)
+{
+    Assert(peek_char(parser, input) == '[');
+    const char *rest = input + 1; // skip [
+
+    isize first_item = parser->array_items.size();
+
+    rest = skip_whitespace(parser, rest);
+    if (peek_char(parser, rest) != ']')
+    {
+        while (true)
         {
-            array.append(value);
-            rest = end_of_value;
-            rest = skip_whitespace(rest);
-            if (rest[0] == ',')
+            JsonValue *value = NULL;
+            rest = parse_value(parser, rest, &value);
+            if (value == NULL)
             {
-                rest += 1; // skip ,
-
-                // There must not be a comma before ]
-                rest = skip_whitespace(rest);
-                if (rest[0] == ']')
-                {
-                    return NULL;
-                }
+                return input;
             }
-            else
+            parser->array_items.append(value);
+
+            // There must be a comma if this item is not the last one, and no comma
+            // before ], which parse_value reports as a missing value
+            rest = skip_whitespace(parser, rest);
+            char next = peek_char(parser, rest);
+            if (next == ']') break;
+            if (next != ',')
             {
-                // There must be a comma if this item is not the last one
-                rest = skip_whitespace(rest);
-                if (rest[0] != ']')
-                {
-                    return NULL;
-                }
+                parse_fail(parser, rest, "expected ',' or ']' after array item");
+                return input;
             }
+            rest += 1; // skip ,
         }
-
-        rest = skip_whitespace(rest);
     }
 
     // We parsed the array successfully and the next character is ]
-    Assert(rest[0] == ']');
+    Assert(peek_char(parser, rest) == ']');
     rest += 1; // skip ]
-    *out = make_json_array(array);
+    *out = make_json_array(parser, first_item);
 
     return rest;
 }
 
-static const char *parse_object(const char *input, JsonValue **out)
+static const char *parse_object(JsonParser *parser, const char *input, JsonValue **out)
 {
-    const char *rest = input;
-    rest = skip_whitespace(rest);
-
-    if (rest[0] != '{')
-    {
-        return input;
-    }
-    rest += 1; // skip {
+    Assert(peek_char(parser, input) == '{');
+    const char *rest = input + 1; // skip {
 
     JsonPair *first_pair = NULL;
     JsonPair *last_pair = NULL;
+    isize pair_count = 0;
 
-    while (true)
+    rest = skip_whitespace(parser, rest);
+    if (peek_char(parser, rest) != '}')
     {
-        rest = skip_whitespace(rest);
-        if (rest[0] == '}') break;
-
-        // key
-        String key = parse_string_literal(rest);
-        if (key.is_invalid())
-        {
-            printf("ERROR while parsing object: key is not a string\n");
-            return input;
-        }
-        rest += key.len() + 2; // 2 for the quotes
-
-        // in-between
-        rest = skip_whitespace(rest);
-        if (rest[0] != ':')
-        {
-            printf("ERROR while parsing object: missing colon\n");
-            return input;
-        }
-        rest += 1; // skip :
-        rest = skip_whitespace(rest);
-
-        // value
-        JsonValue *value = NULL;
-        rest = parse_value(rest, &value);
-        if (value != NULL)
+        while (true)
         {
-            JsonPair *pair = make_pair(key, value);
-            SLLQueuePush(first_pair, last_pair, pair);
-        }
+            // key
+            rest = skip_whitespace(parser, rest);
+            String key;
+            const char *end_of_key = parse_string_literal(parser, rest, &key);
+            if (end_of_key == rest)
+            {
+                return input;
+            }
+            rest = end_of_key;
 
-        rest = skip_whitespace(rest);
-        if (rest[0] == ',')
-        {
-            rest += 1; // skip ,
+            // in-between
+            rest = skip_whitespace(parser, rest);
+            if (peek_char(parser, rest) != ':')
+            {
+                parse_fail(parser, rest, "expected ':' after object key");
+                return input;
+            }
+            rest += 1; // skip :
 
-            // There must not be a comma before }
-            rest = skip_whitespace(rest);
-            if (rest[0] == '}')
+            // value
+            JsonValue *value = NULL;
+            rest = parse_value(parser, rest, &value);
+            if (value == NULL)
             {
-                return NULL;
+                return input;
             }
-        }
-        else
-        {
-            // There must be a comma if this pair is not the last one
-            rest = skip_whitespace(rest);
-            if (rest[0] != '}')
+
+            JsonPair *pair = make_pair(parser->allocator, key, value);
+            SLLQueuePush(first_pair, last_pair, pair);
+            pair_count += 1;
+
+            // There must be a comma if this pair is not the last one, and no comma
+            // before }, which the key reports as a missing string
+            rest = skip_whitespace(parser, rest);
+            char next = peek_char(parser, rest);
+            if (next == '}') break;
+            if (next != ',')
             {
-                return NULL;
+                parse_fail(parser, rest, "expected ',' or '}' after object member");
+                return input;
             }
+            rest += 1; // skip ,
         }
     }
 
     // We parsed the object successfully and the next character is }
-    Assert(rest[0] == '}');
+    Assert(peek_char(parser, rest) == '}');
     rest += 1; // skip the }
-    *out = make_object(first_pair);
+    *out = make_object(parser->allocator, first_pair, pair_count);
 
     return rest;
 }
 
-static const char *parse_value(const char *input, JsonValue **out)
+static const char *parse_value(JsonParser *parser, const char *input, JsonValue **out)
 {
-    JsonValue *value = NULL;
-
-    const char *rest = input;
-
-    rest = parse_null(input, &value);
-    if (value != NULL)
-    {
-        *out = value;
-        return rest;
-    }
-
-    rest = parse_boolean(input, &value);
-    if (value != NULL)
-    {
-        *out = value;
-        return rest;
-    }
-
-    rest = parse_number(input, &value);
-    if (value != NULL)
-    {
-        *out = value;
-        return rest;
-    }
+    const char *rest = skip_whitespace(parser, input);
 
-    rest = parse_string(input, &value);
-    if (value != NULL)
+    // The first character decides what the value has to be
+    char first = peek_char(parser, rest);
+    switch (first)
     {
-        *out = value;
-        return rest;
-    }
-
-    rest = parse_array(input, &value);
-    if (value != NULL)
-    {
-        *out = value;
-        return rest;
+        case 'n': return parse_null(parser, rest, out);
+        case 't':
+        case 'f': return parse_boolean(parser, rest, out);
+        case '\"': return parse_string(parser, rest, out);
+        case '[':
+        case '{':
+        {
+            if (!parse_enter(parser, rest)) return input;
+            const char *end = first == '[' ? parse_array(parser, rest, out) : parse_object(parser, rest, out);
+            parse_leave(parser);
+            return end;
+        }
+        default: break;
     }
 
-    rest = parse_object(input, &value);
-    if (value != NULL)
+    if (is_digit(first) || first == '-' || first == '+' || first == '.')
     {
-        *out = value;
-        return rest;
+        return parse_number(parser, rest, out);
     }
 
+    parse_fail(parser, rest, rest < parser->end ? "expected a value" : "unexpected end of input");
     return input;
 }
 
 /****************************************************************
- * Parsing API
+ * Indexed value parsers (internal)
+ *
+ * Stage 2 of the indexed parser, stage 1 is in json_index.cpp.
+ * Same grammar and values as the parsers above, and errors at the
+ * same offsets, but they jump from one structural character to the
+ * next instead of stepping over whitespace and string bodies byte
+ * by byte. Each one gets the offset of its value's first character,
+ * already taken from the index, or -1 when the index ran out.
 ****************************************************************/
-JsonValue *json_parse(const char *input)
+
+static const char *index_at(JsonParser *parser, isize offset)
 {
-    JsonValue *value = NULL;
-    input = parse_value(input, &value);
-    return value;
+    return offset >= 0 ? parser->begin + offset : parser->end;
 }
 
-JsonValue *json_parse_file(String filepath)
+// Numbers and literals run until whitespace, a quote or a structural character
+static bool is_scalar_end(JsonParser *parser, const char *at)
 {
-    Allocator *heap_allocator = allocator_get_heap();
+    char c = peek_char(parser, at);
+    return at == parser->end || is_whitespace(c) || c == '\"' || c == ',' || c == ':'
+        || c == '[' || c == ']' || c == '{' || c == '}';
+}
+
+static bool index_parse_value(JsonParser *parser, JsonIndex *index, isize offset, JsonValue **out);
 
-    String content = os::read_entire_file(heap_allocator, filepath);
-    if (content.is_invalid()) return NULL;
+static bool index_parse_string_literal(JsonParser *parser, JsonIndex *index, isize offset, String *out)
+{
+    const char *input = index_at(parser, offset);
+    if (peek_char(parser, input) != '\"')
+    {
+        parse_fail(parser, input, "expected a string");
+        return false;
+    }
 
-    JsonValue *value = json_parse((const char *)content.data());
-    // TODO: Implement deinit for StringBuf and make allocating functions return StringBuf
-    // str_free(heap_allocator, content);
+    // Nothing inside a string is indexed, the next position is the closing quote
+    isize close = json_index_next(index);
+    if (close < 0)
+    {
+        parse_fail(parser, input, "unterminated string");
+        return false;
+    }
+    Assert(parser->begin[close] == '\"');
 
-    return value;
+    String body = String((u8*)input + 1, close - offset - 1);
+    bool has_escapes = memchr(body.data(), '\\', body.len()) != NULL;
+    return parse_string_body(parser, body, has_escapes, out);
 }
 
-/****************************************************************
- * Getters
-****************************************************************/
-JsonValue *json_object_get_key(JsonValue *value, const char *key)
+// A number or literal, before there's a JsonValue for it
+struct JsonScalar
 {
-    Assert(json_value_is_object(value));
-    for (JsonPair *pair = value->as.object; pair != NULL; pair = pair->next)
+    JsonType type;
+    bool boolean;
+    f64 number;
+};
+
+static bool index_scan_scalar(JsonParser *parser, const char *input, JsonScalar *out)
+{
+    if (input == parser->end)
+    {
+        parse_fail(parser, input, "unexpected end of input");
+        return false;
+    }
+
+    const char *rest = input;
+    char first = input[0];
+    if (first == 'n')
     {
-        if (pair->key == String::from_cstr(key))
+        if (!starts_with(parser, input, "null", 4))
         {
-            return pair->value;
+            parse_fail(parser, input, "expected null");
+            return false;
         }
+        out->type = JSON_NULL;
+        rest = input + 4;
     }
-
-    return NULL;
-}
-
-// Length terminated version of `json_object_get_key`
-JsonValue *json_object_get_key_lt(JsonValue *value, const char *key, int length)
-{
-    Assert(json_value_is_object(value));
-    for (JsonPair *pair = value->as.object; pair != NULL; pair = pair->next)
+    else if (first == 't' || first == 'f')
     {
-        if (pair->key == String((u8*)key, length))
+        out->type = JSON_BOOL;
+        if (starts_with(parser, input, "true", 4))
         {
-            return pair->value;
+            out->boolean = true;
+            rest = input + 4;
+        }
+        else if (starts_with(parser, input, "false", 5))
+        {
+            out->boolean = false;
+            rest = input + 5;
+        }
+        else
+        {
+            parse_fail(parser, input, "expected true or false");
+            return false;
         }
     }
-
-    return NULL;
-}
-
-JsonValue *json_array_get_index(JsonValue *value, size_t index)
-{
-    Assert(json_value_is_array(value));
-    if ((isize)index < value->as.array.size())
+    else if (is_digit(first) || first == '-' || first == '+' || first == '.')
     {
-        return value->as.array[index];
+        out->type = JSON_NUMBER;
+        rest = scan_number(parser, input, &out->number);
+        if (rest == input) return false;
     }
     else
     {
-        return NULL;
+        parse_fail(parser, input, "expected a value");
+        return false;
     }
-}
 
-JsonValue *json_object_get_key_chain(JsonValue *value, const char *key)
-{
-    if (value == NULL) return NULL;
-    return json_object_get_key(value, key);
-}
+    // The plain parsers leave this to whoever expects a separator next, here nothing
+    // looks at the bytes between two positions
+    if (!is_scalar_end(parser, rest))
+    {
+        parse_fail(parser, rest, "unexpected character after value");
+        return false;
+    }
 
-// Length terminated version of `json_object_get_key_chain`
-JsonValue *json_object_get_key_lt_chain(JsonValue *value, const char *key, int length)
-{
-    if (value == NULL) return NULL;
-    return json_object_get_key_lt(value, key, length);
+    return true;
 }
 
-JsonValue *json_array_get_index_chain(JsonValue *value, size_t index)
+static bool index_parse_scalar(JsonParser *parser, const char *input, JsonValue **out)
 {
-    if (value == NULL) return NULL;
-    return json_array_get_index(value, index);
+    JsonScalar scalar;
+    if (!index_scan_scalar(parser, input, &scalar)) return false;
+
+    switch (scalar.type)
+    {
+        case JSON_NULL: *out = make_json_null(parser->allocator); break;
+        case JSON_BOOL: *out = make_json_bool(parser->allocator, scalar.boolean); break;
+        default: *out = make_json_number(parser->allocator, scalar.number); break;
+    }
+    return true;
 }
 
-JsonValue *json_query(JsonValue *value, const char *query)
+static bool index_parse_array(JsonParser *parser, JsonIndex *index, JsonValue **out)
 {
-    while (true)
+    isize first_item = parser->array_items.size();
+
+    isize next = json_index_next(index);
+    if (peek_char(parser, index_at(parser, next)) != ']')
     {
-        query = skip_whitespace(query);
+        while (true)
+        {
+            JsonValue *value = NULL;
+            if (!index_parse_value(parser, index, next, &value))
+            {
+                return false;
+            }
+            parser->array_items.append(value);
+
+            next = json_index_next(index);
+            char separator = peek_char(parser, index_at(parser, next));
+            if (separator == ']') break;
+            if (separator != ',')
+            {
+                parse_fail(parser, index_at(parser, next), "expected ',' or ']' after array item");
+                return false;
+            }
+            next = json_index_next(index);
+        }
+    }
+
+    *out = make_json_array(parser, first_item);
+    return true;
+}
+
+static bool index_parse_object(JsonParser *parser, JsonIndex *index, JsonValue **out)
+{
+    JsonPair *first_pair = NULL;
+    JsonPair *last_pair = NULL;
+    isize pair_count = 0;
 
-        if (query[0] == '.')
+    isize next = json_index_next(index);
+    if (peek_char(parser, index_at(parser, next)) != '}')
+    {
+        while (true)
         {
-            query++; // skip .
+            // key
+            String key;
+            if (!index_parse_string_literal(parser, index, next, &key))
+            {
+                return false;
+            }
 
-            const char *key_begin = query;
+            // in-between
+            next = json_index_next(index);
+            if (peek_char(parser, index_at(parser, next)) != ':')
+            {
+                parse_fail(parser, index_at(parser, next), "expected ':' after object key");
+                return false;
+            }
 
-            while (query[0] != '.' && query[0] != '[' && query[0] != '\0' && !is_whitespace(query[0]))
+            // value
+            JsonValue *value = NULL;
+            if (!index_parse_value(parser, index, json_index_next(index), &value))
             {
-                query++;
+                return false;
             }
 
-            int key_len = query - key_begin;
-            value = json_object_get_key_lt_chain(value, key_begin, key_len);
+            JsonPair *pair = make_pair(parser->allocator, key, value);
+            SLLQueuePush(first_pair, last_pair, pair);
+            pair_count += 1;
+
+            next = json_index_next(index);
+            char separator = peek_char(parser, index_at(parser, next));
+            if (separator == '}') break;
+            if (separator != ',')
+            {
+                parse_fail(parser, index_at(parser, next), "expected ',' or '}' after object member");
+                return false;
+            }
+            next = json_index_next(index);
+        }
+    }
+
+    *out = make_object(parser->allocator, first_pair, pair_count);
+    return true;
+}
+
+static bool index_parse_value(JsonParser *parser, JsonIndex *index, isize offset, JsonValue **out)
+{
+    const char *input = index_at(parser, offset);
+    char first = peek_char(parser, input);
+    switch (first)
+    {
+        case '\"':
+        {
+            String string;
+            if (!index_parse_string_literal(parser, index, offset, &string)) return false;
+            *out = make_json_string(parser->allocator, string);
+            return true;
+        }
+        case '[':
+        case '{':
+        {
+            if (!parse_enter(parser, input)) return false;
+            bool parsed = first == '[' ? index_parse_array(parser, index, out) : index_parse_object(parser, index, out);
+            parse_leave(parser);
+            return parsed;
+        }
+        default: return index_parse_scalar(parser, input, out);
+    }
+}
+
+// The positions only live for the parse, however big the document is they're indexed
+// a batch at a time. index_end gives them back
+static void index_begin(JsonParser *parser, JsonIndex *index)
+{
+    isize size = parser->end - parser->begin;
+    isize capacity = Min((size + 64) & ~(isize)63, (isize)JSON_INDEX_BATCH_SIZE);
+    u32 *positions = allocate_array<u32>(allocator_get_heap(), capacity);
+    json_index_init(index, (const u8 *)parser->begin, size, positions, capacity);
+}
+
+static void index_end(JsonIndex *index)
+{
+    allocator_deallocate(allocator_get_heap(), index->positions, index->capacity * sizeof(u32), alignof(u32));
+}
+
+// Only whitespace may follow the document's value
+static bool index_expect_end(JsonParser *parser, JsonIndex *index)
+{
+    isize trailing = json_index_next(index);
+    if (trailing >= 0)
+    {
+        parse_fail(parser, parser->begin + trailing, "unexpected data after the value");
+        return false;
+    }
+
+    return true;
+}
+
+static JsonValue *index_parse(JsonParser *parser)
+{
+    JsonIndex index;
+    index_begin(parser, &index);
+
+    JsonValue *value = NULL;
+    if (!index_parse_value(parser, &index, json_index_next(&index), &value) || !index_expect_end(parser, &index))
+    {
+        value = NULL;
+    }
+
+    index_end(&index);
+    return value;
+}
+
+static JsonParseError make_parse_error(JsonParser *parser)
+{
+    Assert(parser->error_at != NULL);
+
+    JsonParseError error = {};
+    error.message = parser->error_message;
+    error.offset = parser->error_at - parser->begin;
+    error.line = 1;
+    error.column = 1;
+
+    for (const char *c = parser->begin; c < parser->error_at; ++c)
+    {
+        if (*c == '\n')
+        {
+            error.line += 1;
+            error.column = 1;
         }
-        else if (query[0] == '[')
+        else
         {
-            query++; // skip [
+            error.column += 1;
+        }
+    }
+
+    return error;
+}
+
+/****************************************************************
+ * Parsing API
+****************************************************************/
+JsonValue *json_parse(String input, Arena *arena, Flags32 flags, JsonParseError *error)
+{
+    TempArena before = temp_arena_new(arena);
+
+    JsonParser parser = {};
+    parser.begin = (const char *)input.data();
+    parser.end = parser.begin + input.len();
+    parser.allocator = &arena->allocator;
+    parser.flags = flags;
+    parser.array_items = Array<JsonValue*>::init(allocator_get_heap());
+
+    JsonValue *value = NULL;
+    if (input.len() >= JSON_INDEX_MIN_SIZE && json_index_is_vectorized())
+    {
+        value = index_parse(&parser);
+    }
+    else
+    {
+        const char *rest = parse_value(&parser, parser.begin, &value);
 
-            if (is_digit(query[0]))
+        // Only whitespace may follow the document's value
+        if (value != NULL)
+        {
+            rest = skip_whitespace(&parser, rest);
+            if (rest != parser.end)
             {
-                // array index
-                char *end;
-                size_t index = strtol(query, &end, 10);
-                query = end;
+                parse_fail(&parser, rest, "unexpected data after the value");
+                value = NULL;
+            }
+        }
+    }
 
-                if (query[0] == ']')
-                {
-                    value = json_array_get_index_chain(value, index);
-                    query++; // skip ]
-                }
-                else
-                {
-                    return NULL;
-                }
+    parser.array_items.deinit();
+
+    if (value == NULL)
+    {
+        // Drops whatever part of the document was built before the failure
+        temp_arena_release(before);
+
+        if (error != NULL)
+        {
+            *error = make_parse_error(&parser);
+        }
+    }
+
+    return value;
+}
+
+JsonValue *json_parse(const char *input, Arena *arena, Flags32 flags)
+{
+    return json_parse(String::from_cstr(input), arena, flags);
+}
+
+JsonValue *json_parse(const char *input)
+{
+    Arena *arena = arena_new(Kilobytes(16));
+    JsonValue *value = json_parse(String::from_cstr(input), arena);
+    if (value == NULL) arena_release(arena);
+
+    return value;
+}
+
+JsonValue *json_parse_file(String filepath, Arena *arena, Flags32 flags, JsonParseError *error)
+{
+    TempArena before = temp_arena_new(arena);
+
+    // Borrowed strings point into the text, so it has to live as long as the document.
+    // Otherwise every string is copied out and the text is only needed during the parse
+    ScratchScope scratch(&arena->allocator);
+    Arena *content_arena = (flags & JSON_PARSE_BORROW_STRINGS) ? arena : *scratch;
+
+    String content = os::read_entire_file(&content_arena->allocator, filepath);
+    if (content.is_invalid())
+    {
+        if (error != NULL)
+        {
+            *error = {};
+            error->message = "couldn't read the file";
+        }
+        return NULL;
+    }
+
+    JsonValue *value = json_parse(content, arena, flags, error);
+    if (value == NULL) temp_arena_release(before);
+
+    return value;
+}
+
+JsonValue *json_parse_file(String filepath)
+{
+    Arena *arena = arena_new(Kilobytes(16));
+    JsonValue *value = json_parse_file(filepath, arena);
+    if (value == NULL) arena_release(arena);
+
+    return value;
+}
+
+/****************************************************************
+ * Getters
+****************************************************************/
+JsonValue *json_object_get_key(JsonValue *value, const char *key)
+{
+    return json_object_lookup(value, String::from_cstr(key));
+}
+
+// Length terminated version of `json_object_get_key`
+JsonValue *json_object_get_key_lt(JsonValue *value, const char *key, int length)
+{
+    return json_object_lookup(value, String((u8*)key, length));
+}
+
+JsonValue *json_array_get_index(JsonValue *value, size_t index)
+{
+    Assert(json_value_is_array(value));
+    if ((isize)index < value->as.array.size())
+    {
+        return value->as.array[index];
+    }
+    else
+    {
+        return NULL;
+    }
+}
+
+JsonValue *json_object_get_key_chain(JsonValue *value, const char *key)
+{
+    if (value == NULL) return NULL;
+    return json_object_get_key(value, key);
+}
+
+// Length terminated version of `json_object_get_key_chain`
+JsonValue *json_object_get_key_lt_chain(JsonValue *value, const char *key, int length)
+{
+    if (value == NULL) return NULL;
+    return json_object_get_key_lt(value, key, length);
+}
+
+JsonValue *json_array_get_index_chain(JsonValue *value, size_t index)
+{
+    if (value == NULL) return NULL;
+    return json_array_get_index(value, index);
+}
+
+enum JsonQueryStepKind
+{
+    JSON_QUERY_KEY,
+    JSON_QUERY_INDEX,
+    JSON_QUERY_END,
+    JSON_QUERY_INVALID,
+};
+
+struct JsonQueryStep
+{
+    JsonQueryStepKind kind;
+
+    String key;
+    u64 index;
+};
+
+// Reads one `.key`, `["key"]` or `[N]` off the front of a query and returns the rest.
+// json_query and json_cursor_query both walk their documents with it
+static const char *query_next_step(const char *query, JsonQueryStep *step)
+{
+    query = skip_whitespace(query);
+    step->kind = JSON_QUERY_INVALID;
+
+    if (query[0] == '.')
+    {
+        query++; // skip .
+
+        const char *key_begin = query;
+
+        while (query[0] != '.' && query[0] != '[' && query[0] != '\0' && !is_whitespace(query[0]))
+        {
+            query++;
+        }
+
+        step->kind = JSON_QUERY_KEY;
+        step->key = String((u8*)key_begin, query - key_begin);
+    }
+    else if (query[0] == '[')
+    {
+        query++; // skip [
+
+        if (is_digit(query[0]))
+        {
+            // array index
+            const char *digits_end = query;
+            while (is_digit(*digits_end)) digits_end += 1;
+
+            isize length;
+            if (parse_u64_prefix((const u8 *)query, digits_end - query, &step->index, &length) != PARSE_NUMBER_OK)
+            {
+                return query;
             }
-            else if (query[0] == '\"')
+            query += length;
+
+            if (query[0] == ']')
             {
-                // object key
-                query++; // skip "
+                step->kind = JSON_QUERY_INDEX;
+                query++; // skip ]
+            }
+        }
+        else if (query[0] == '\"')
+        {
+            // object key
+            query++; // skip "
 
-                const char *key_begin = query;
+            const char *key_begin = query;
 
-                while (query[0] != '\"' && query[0] != '\0')
-                {
-                    query++;
-                }
+            while (query[0] != '\"' && query[0] != '\0')
+            {
+                query++;
+            }
 
-                if (query[0] == '\"')
-                {
-                    int key_len = query - key_begin;
-                    query++; // skip "
+            if (query[0] == '\"')
+            {
+                String key = String((u8*)key_begin, query - key_begin);
+                query++; // skip "
 
-                    if (query[0] == ']')
-                    {
-                        value = json_object_get_key_lt_chain(value, key_begin, key_len);
-                        query++; // skip ]
-                    }
-                    else
-                    {
-                        return NULL;
-                    }
-                }
-                else
+                if (query[0] == ']')
                 {
-                    return NULL;
+                    step->kind = JSON_QUERY_KEY;
+                    step->key = key;
+                    query++; // skip ]
                 }
             }
         }
-        else if (query[0] == '\0')
-        {
-            break;
-        }
-        else
+    }
+    else if (query[0] == '\0')
+    {
+        step->kind = JSON_QUERY_END;
+    }
+
+    return query;
+}
+
+JsonValue *json_query(JsonValue *value, const char *query)
+{
+    while (true)
+    {
+        JsonQueryStep step;
+        query = query_next_step(query, &step);
+
+        switch (step.kind)
         {
-            return NULL;
+            case JSON_QUERY_KEY:
+            {
+                value = json_object_get_key_lt_chain(value, (const char *)step.key.data(), step.key.len());
+            } break;
+
+            case JSON_QUERY_INDEX:
+            {
+                value = json_array_get_index_chain(value, step.index);
+            } break;
+
+            case JSON_QUERY_END: return value;
+            case JSON_QUERY_INVALID: return NULL;
         }
     }
-
-    return value;
 }
 
 size_t json_array_get_length(const JsonValue *value)
@@ -571,7 +1172,7 @@ size_t json_object_get_num_keys(const JsonValue *value)
     if (!json_value_is_object(value)) return 0;
 
     size_t count = 0;
-    for (JsonPair *pair = value->as.object; pair != NULL; pair = pair->next)
+    for (JsonPair *pair = value->as.object.first; pair != NULL; pair = pair->next)
     {
         count++;
     }
@@ -716,67 +1317,88 @@ bool json_array_contains_object(const JsonValue *value)
 /****************************************************************
  * Pretty printing
 ****************************************************************/
-void json_print_value(const JsonValue *value, FILE *stream)
+void json_write_value(const JsonValue *value, StringBuilder *builder)
 {
     switch (value->type)
     {
         case JSON_NULL:
         {
-            fprintf(stream, "null");
+            builder->append("null");
         } break;
 
         case JSON_BOOL:
         {
-            fprintf(stream, "%s", value->as.boolean ? "true" : "false");
+            builder->append(value->as.boolean ? String("true") : String("false"));
         } break;
 
         case JSON_NUMBER:
         {
-            fprintf(stream, "%lf", value->as.number);
+            builder->append_format("{:f}", value->as.number);
         } break;
 
         case JSON_STRING:
         {
-            fprintf(stream, "\"%s\"", value->as.string.data());
+            builder->append('"');
+            escape_append(builder, value->as.string, ESCAPE_JSON);
+            builder->append('"');
         } break;
 
         case JSON_ARRAY:
         {
-            fprintf(stream, "[");
+            builder->append('[');
             for (int i = 0; i < value->as.array.size(); ++i)
             {
-                json_print_value(value->as.array[i], stream);
+                json_write_value(value->as.array[i], builder);
                 if (i != value->as.array.size() - 1)
                 {
-                    fprintf(stream, ", ");
+                    builder->append(", ");
                 }
             }
-            fprintf(stream, "]");
+            builder->append(']');
         } break;
 
         case JSON_OBJECT:
         {
-            fprintf(stream, "{");
-            for (JsonPair *pair = value->as.object; pair != NULL; pair = pair->next)
+            builder->append('{');
+            for (JsonPair *pair = value->as.object.first; pair != NULL; pair = pair->next)
             {
-                fprintf(stream, "\"%s\": ", pair->key.data());
-                json_print_value(pair->value, stream);
+                builder->append('"');
+                escape_append(builder, pair->key, ESCAPE_JSON);
+                builder->append("\": ");
+                json_write_value(pair->value, builder);
 
                 if (pair->next != NULL)
                 {
-                    fprintf(stream, ", ");
+                    builder->append(", ");
                 }
             }
-            fprintf(stream, "}");
+            builder->append('}');
         } break;
 
         default:
         {
-           fprintf(stream, "UNKNOWN");
+           builder->append("UNKNOWN");
         } break;
     }
 }
 
+void json_print_value(const JsonValue *value, FILE *stream)
+{
+    ScratchScope scratch;
+    StringBuilder builder = StringBuilder::init(*scratch);
+    json_write_value(value, &builder);
+    builder.write_to_file(stream);
+}
+
+// Escaped like json_write_value does, so the output still parses. Borrowed strings
+// aren't NUL terminated, the escaped copy is printed by length
+static void pretty_print_string(FILE *stream, const char *ansi_seq, String string)
+{
+    ScratchScope scratch;
+    String escaped = escape(&scratch->allocator, string, ESCAPE_JSON);
+    ansi_print_style(stream, ansi_seq, "\"%.*s\"", (int)escaped.len(), (const char *)escaped.data());
+}
+
 static void pretty_print_value_recursive(const JsonValue *value, int indent_spaces, int indent_level, FILE *stream)
 {
     switch (value->type)
@@ -798,7 +1420,7 @@ static void pretty_print_value_recursive(const JsonValue *value, int indent_spac
 
         case JSON_STRING:
         {
-            ansi_print_bright_green(stream, "\"%s\"", value->as.string);
+            pretty_print_string(stream, HGRN, value->as.string);
         } break;
 
         case JSON_ARRAY:
@@ -852,11 +1474,11 @@ static void pretty_print_value_recursive(const JsonValue *value, int indent_spac
         {
             fprintf(stream, "{");
 
-            for (JsonPair *pair = value->as.object; pair != NULL; pair = pair->next)
+            for (JsonPair *pair = value->as.object.first; pair != NULL; pair = pair->next)
             {
                 fprintf(stream, "\n");
                 indent(indent_spaces, indent_level + 1, stream);
-                ansi_print_green(stream, "\"%s\"", pair->key);
+                pretty_print_string(stream, GRN, pair->key);
                 fprintf(stream, ": ");
                 pretty_print_value_recursive(pair->value, indent_spaces, indent_level + 1, stream);
 
@@ -885,4 +1507,631 @@ void json_pretty_print_value(const JsonValue *value, int indent_spaces, FILE *st
     pretty_print_value_recursive(value, indent_spaces, 0, stream);
 }
 
+/****************************************************************
+ * Tape builder (internal)
+ *
+ * Runs over the structural index like the indexed parsers and
+ * checks the grammar with the same helpers. The entries of an open
+ * container's children wait on `pending` and move to `entries` as
+ * one run when it closes, after the runs of any containers inside
+ * it. Unescaped strings go to scratch on their way into the pool,
+ * and everything is copied into the tape's allocation at the end.
+****************************************************************/
+// An entry is its JsonType << JSON_TAPE_TYPE_SHIFT | payload. Numbers whose low 8 bits
+// are 0, every integer up to 2^44 among them, are stored in the payload shifted right
+// by 8 and carry JSON_TAPE_INLINE_NUMBER in the type byte
+#define JSON_TAPE_TYPE_SHIFT 56
+#define JSON_TAPE_PAYLOAD_MASK ((1ull << JSON_TAPE_TYPE_SHIFT) - 1)
+#define JSON_TAPE_INLINE_NUMBER 0x80
+
+// A container's run starts with a header entry, the number of items or members in the
+// low 32 bits and the capacity of the object's hash table in the high 32. The table
+// comes next, two u32 slots per entry, low half first, each holding a member's position + 1 or 0 when
+// it's empty. Then the items, or the key and value entries of every member
+#define JSON_TAPE_KEY_INDEX_MIN_CAPACITY 16
+
+struct JsonTapeBuilder
+{
+    JsonParser *parser;
+    JsonIndex *index;
+
+    Array<u64> entries;
+    // Children of the containers still open, innermost last
+    Array<u64> pending;
+    Array<f64> numbers;
+    Array<u8> string_pool;
+    // Where each key went in the pool
+    StringMap<u64> keys;
+};
+
+static u64 tape_entry(u32 type, u64 payload)
+{
+    Assert(payload <= JSON_TAPE_PAYLOAD_MASK);
+    return ((u64)type << JSON_TAPE_TYPE_SHIFT) | payload;
+}
+
+static JsonType tape_entry_type(u64 entry)
+{
+    return (JsonType)((entry >> JSON_TAPE_TYPE_SHIFT) & ~JSON_TAPE_INLINE_NUMBER);
+}
+
+static u64 tape_entry_payload(u64 entry)
+{
+    return entry & JSON_TAPE_PAYLOAD_MASK;
+}
+
+static isize tape_header_count(u64 header)
+{
+    return (isize)(u32)header;
+}
+
+static isize tape_header_key_index_capacity(u64 header)
+{
+    return (isize)(header >> 32);
+}
+
+// Entries the header and hash table take up before the first child
+static isize tape_header_size(u64 header)
+{
+    return 1 + tape_header_key_index_capacity(header) / 2;
+}
+
+// A pooled string is its u32 length, its bytes and a NUL, padded to 4 bytes so the
+// next length is aligned. The entry's payload is where the length is
+static String tape_string(const u8 *string_pool, u64 entry)
+{
+    const u8 *record = string_pool + tape_entry_payload(entry);
+    u32 len;
+    MemoryCopy(&len, record, sizeof(u32));
+    return String((u8*)record + sizeof(u32), len);
+}
+
+static u64 tape_add_string(JsonTapeBuilder *builder, String string)
+{
+    Assert(string.len() <= (isize)UINT32_MAX);
+
+    u32 len = (u32)string.len();
+    isize offset = builder->string_pool.size();
+    isize record_size = (sizeof(u32) + len + 1 + 3) & ~(isize)3;
+    builder->string_pool.resize(offset + record_size);
+
+    u8 *record = builder->string_pool.data() + offset;
+    MemoryCopy(record, &len, sizeof(u32));
+    MemoryCopy(record + sizeof(u32), string.data(), len);
+    return tape_entry(JSON_STRING, offset);
+}
+
+// Keys repeat from one object to the next, each is pooled once. Lookups then keep
+// comparing against the same few bytes and equal keys have equal entries
+static u64 tape_add_key(JsonTapeBuilder *builder, String key)
+{
+    bool inserted;
+    u64 *entry = builder->keys.get_or_insert(key, &inserted);
+    if (inserted) *entry = tape_add_string(builder, key);
+    return *entry;
+}
+
+static u64 tape_add_number(JsonTapeBuilder *builder, f64 number)
+{
+    u64 bits;
+    MemoryCopy(&bits, &number, sizeof(u64));
+    if ((bits & 0xFF) == 0)
+    {
+        return tape_entry(JSON_NUMBER | JSON_TAPE_INLINE_NUMBER, bits >> 8);
+    }
+
+    u64 entry = tape_entry(JSON_NUMBER, builder->numbers.size());
+    builder->numbers.append(number);
+    return entry;
+}
+
+// Slot `slot` of the hash table in the entries at `table`
+static u32 tape_slot(const u64 *table, isize slot)
+{
+    return (u32)(table[slot / 2] >> (32 * (slot & 1)));
+}
+
+static void tape_fill_key_index(JsonTapeBuilder *builder, u64 *table, isize capacity, const u64 *members, isize count)
+{
+    const u8 *string_pool = builder->string_pool.data();
+    for (isize member = 0; member < count; ++member)
+    {
+        String key = tape_string(string_pool, members[2 * member]);
+        isize slot = (isize)(hash(key) & (capacity - 1));
+        while (tape_slot(table, slot) != 0)
+        {
+            // The first member with this key is the one lookups find
+            if (members[2 * (tape_slot(table, slot) - 1)] == members[2 * member]) break;
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        if (tape_slot(table, slot) == 0)
+        {
+            table[slot / 2] |= (u64)(member + 1) << (32 * (slot & 1));
+        }
+    }
+}
+
+// Moves the children pending since `mark` into a run and leaves the container's
+// entry in their place
+static void tape_close_container(JsonTapeBuilder *builder, JsonType type, isize mark)
+{
+    isize child_count = builder->pending.size() - mark;
+    isize count = type == JSON_OBJECT ? child_count / 2 : child_count;
+    Assert(count < (isize)UINT32_MAX);
+
+    // At most 3/4 full
+    isize capacity = 0;
+    if (type == JSON_OBJECT && count >= JSON_OBJECT_INDEX_MIN_KEYS)
+    {
+        capacity = JSON_TAPE_KEY_INDEX_MIN_CAPACITY;
+        while (capacity * 3 < count * 4) capacity *= 2;
+    }
+
+    isize run = builder->entries.size();
+    u64 header = (u64)count | ((u64)capacity << 32);
+    isize children_at = run + tape_header_size(header);
+    builder->entries.resize(children_at + child_count);
+    builder->entries[run] = header;
+
+    u64 *children = builder->entries.data() + children_at;
+    if (child_count > 0)
+    {
+        MemoryCopy(children, builder->pending.data() + mark, child_count * sizeof(u64));
+    }
+    if (capacity > 0)
+    {
+        tape_fill_key_index(builder, builder->entries.data() + run + 1, capacity, children, count);
+    }
+
+    builder->pending.resize(mark);
+    builder->pending.append(tape_entry(type, run));
+}
+
+static bool tape_parse_value(JsonTapeBuilder *builder, isize offset);
+
+static bool tape_parse_array(JsonTapeBuilder *builder)
+{
+    JsonParser *parser = builder->parser;
+    JsonIndex *index = builder->index;
+    isize mark = builder->pending.size();
+
+    isize next = json_index_next(index);
+    if (peek_char(parser, index_at(parser, next)) != ']')
+    {
+        while (true)
+        {
+            if (!tape_parse_value(builder, next)) return false;
+
+            next = json_index_next(index);
+            char separator = peek_char(parser, index_at(parser, next));
+            if (separator == ']') break;
+            if (separator != ',')
+            {
+                parse_fail(parser, index_at(parser, next), "expected ',' or ']' after array item");
+                return false;
+            }
+            next = json_index_next(index);
+        }
+    }
+
+    tape_close_container(builder, JSON_ARRAY, mark);
+    return true;
+}
+
+static bool tape_parse_object(JsonTapeBuilder *builder)
+{
+    JsonParser *parser = builder->parser;
+    JsonIndex *index = builder->index;
+    isize mark = builder->pending.size();
+
+    isize next = json_index_next(index);
+    if (peek_char(parser, index_at(parser, next)) != '}')
+    {
+        while (true)
+        {
+            // key
+            String key;
+            if (!index_parse_string_literal(parser, index, next, &key)) return false;
+            builder->pending.append(tape_add_key(builder, key));
+
+            // in-between
+            next = json_index_next(index);
+            if (peek_char(parser, index_at(parser, next)) != ':')
+            {
+                parse_fail(parser, index_at(parser, next), "expected ':' after object key");
+                return false;
+            }
+
+            // value
+            if (!tape_parse_value(builder, json_index_next(index))) return false;
+
+            next = json_index_next(index);
+            char separator = peek_char(parser, index_at(parser, next));
+            if (separator == '}') break;
+            if (separator != ',')
+            {
+                parse_fail(parser, index_at(parser, next), "expected ',' or '}' after object member");
+                return false;
+            }
+            next = json_index_next(index);
+        }
+    }
+
+    tape_close_container(builder, JSON_OBJECT, mark);
+    return true;
+}
+
+// Leaves the value's entry on `pending`
+static bool tape_parse_value(JsonTapeBuilder *builder, isize offset)
+{
+    JsonParser *parser = builder->parser;
+    const char *input = index_at(parser, offset);
+    char first = peek_char(parser, input);
+    switch (first)
+    {
+        case '\"':
+        {
+            String string;
+            if (!index_parse_string_literal(parser, builder->index, offset, &string)) return false;
+            builder->pending.append(tape_add_string(builder, string));
+            return true;
+        }
+        case '[':
+        case '{':
+        {
+            if (!parse_enter(parser, input)) return false;
+            bool parsed = first == '[' ? tape_parse_array(builder) : tape_parse_object(builder);
+            parse_leave(parser);
+            return parsed;
+        }
+        default: break;
+    }
+
+    JsonScalar scalar;
+    if (!index_scan_scalar(parser, input, &scalar)) return false;
+
+    switch (scalar.type)
+    {
+        case JSON_NULL: builder->pending.append(tape_entry(JSON_NULL, 0)); break;
+        case JSON_BOOL: builder->pending.append(tape_entry(JSON_BOOL, scalar.boolean)); break;
+        default: builder->pending.append(tape_add_number(builder, scalar.number)); break;
+    }
+    return true;
+}
+
+// Copies the array to `*cursor`, moves the cursor past it and returns the copy
+template <typename T>
+static const T *tape_pack_array(u8 **cursor, const Array<T>& array)
+{
+    T *copy = (T *)*cursor;
+    if (array.size() > 0)
+    {
+        MemoryCopy(copy, array.data(), array.size() * sizeof(T));
+    }
+    *cursor += array.size() * sizeof(T);
+    return copy;
+}
+
+static JsonTape *tape_pack(JsonTapeBuilder *builder, Allocator *allocator)
+{
+    // Laid out from the widest alignment down, nothing needs padding
+    isize size = sizeof(JsonTape)
+        + builder->entries.size() * sizeof(u64)
+        + builder->numbers.size() * sizeof(f64)
+        + builder->string_pool.size();
+
+    u8 *block = (u8 *)allocator_allocate(allocator, size, alignof(JsonTape));
+    Assert(block != NULL);
+
+    JsonTape *tape = (JsonTape *)block;
+    u8 *cursor = block + sizeof(JsonTape);
+    tape->entries = tape_pack_array(&cursor, builder->entries);
+    tape->numbers = tape_pack_array(&cursor, builder->numbers);
+    tape->string_pool = tape_pack_array(&cursor, builder->string_pool);
+    Assert(cursor == block + size);
+
+    tape->entry_count = builder->entries.size();
+    tape->number_count = builder->numbers.size();
+    tape->string_pool_size = builder->string_pool.size();
+    tape->root = builder->pending[0];
+    tape->allocation_size = size;
+    return tape;
+}
+
+static String tape_key(const JsonTape *tape, const u64 *members, isize member)
+{
+    return tape_string(tape->string_pool, members[2 * member]);
+}
+
+// Position of the first object member with `key`, -1 if there's none
+static isize tape_find_member(const JsonTape *tape, isize run, String key)
+{
+    u64 header = tape->entries[run];
+    const u64 *members = tape->entries + run + tape_header_size(header);
+
+    isize capacity = tape_header_key_index_capacity(header);
+    if (capacity > 0)
+    {
+        const u64 *table = tape->entries + run + 1;
+        for (isize slot = (isize)(hash(key) & (capacity - 1)); tape_slot(table, slot) != 0; slot = (slot + 1) & (capacity - 1))
+        {
+            isize member = tape_slot(table, slot) - 1;
+            if (tape_key(tape, members, member) == key) return member;
+        }
+        return -1;
+    }
+
+    isize count = tape_header_count(header);
+    for (isize member = 0; member < count; ++member)
+    {
+        if (tape_key(tape, members, member) == key) return member;
+    }
+    return -1;
+}
+
+static JsonCursor make_cursor(const JsonTape *tape, u64 entry)
+{
+    JsonCursor cursor;
+    cursor.tape = tape;
+    cursor.entry = entry;
+    return cursor;
+}
+
+// The run behind a container cursor, or -1 when it's invalid or not of that type
+static isize cursor_run(JsonCursor cursor, JsonType type)
+{
+    if (cursor.tape == NULL || tape_entry_type(cursor.entry) != type) return -1;
+    return (isize)tape_entry_payload(cursor.entry);
+}
+
+// The children of the container at `run`, items or key, value pairs
+static const u64 *cursor_children(JsonCursor cursor, isize run)
+{
+    return cursor.tape->entries + run + tape_header_size(cursor.tape->entries[run]);
+}
+
+/****************************************************************
+ * Tape API
+****************************************************************/
+JsonTape *json_tape_parse(String input, Allocator *allocator, JsonParseError *error)
+{
+    // Strings are copied into the pool either way, escaped ones are unescaped into
+    // scratch on the way
+    ScratchScope scratch(allocator);
+
+    JsonParser parser = {};
+    parser.begin = (const char *)input.data();
+    parser.end = parser.begin + input.len();
+    parser.allocator = &scratch->allocator;
+    parser.flags = JSON_PARSE_BORROW_STRINGS;
+
+    JsonIndex index;
+    index_begin(&parser, &index);
+
+    // The arrays grow the whole time, the heap reallocates them in place more often
+    // than an arena can
+    Allocator *heap_allocator = allocator_get_heap();
+    JsonTapeBuilder builder = {};
+    builder.parser = &parser;
+    builder.index = &index;
+    builder.entries = Array<u64>::init(heap_allocator);
+    builder.pending = Array<u64>::init(heap_allocator);
+    builder.numbers = Array<f64>::init(heap_allocator);
+    builder.string_pool = Array<u8>::init(heap_allocator);
+    builder.keys = StringMap<u64>::init(heap_allocator);
+
+    JsonTape *tape = NULL;
+    if (tape_parse_value(&builder, json_index_next(&index)) && index_expect_end(&parser, &index))
+    {
+        tape = tape_pack(&builder, allocator);
+    }
+    else if (error != NULL)
+    {
+        *error = make_parse_error(&parser);
+    }
+
+    builder.entries.deinit();
+    builder.pending.deinit();
+    builder.numbers.deinit();
+    builder.string_pool.deinit();
+    builder.keys.deinit();
+    index_end(&index);
+    return tape;
+}
+
+JsonTape *json_tape_parse(String input, Arena *arena, JsonParseError *error)
+{
+    return json_tape_parse(input, &arena->allocator, error);
+}
+
+void json_tape_free(JsonTape *tape, Allocator *allocator)
+{
+    if (tape == NULL) return;
+    allocator_deallocate(allocator, tape, tape->allocation_size, alignof(JsonTape));
+}
+
+JsonCursor json_tape_root(const JsonTape *tape)
+{
+    return make_cursor(tape, tape->root);
+}
+
+bool json_cursor_is_valid(JsonCursor cursor)
+{
+    return cursor.tape != NULL;
+}
+
+JsonType json_cursor_type(JsonCursor cursor)
+{
+    Assert(json_cursor_is_valid(cursor));
+    return tape_entry_type(cursor.entry);
+}
+
+bool json_cursor_get_bool(JsonCursor cursor)
+{
+    Assert(json_cursor_type(cursor) == JSON_BOOL);
+    return tape_entry_payload(cursor.entry) != 0;
+}
+
+f64 json_cursor_get_number(JsonCursor cursor)
+{
+    Assert(json_cursor_type(cursor) == JSON_NUMBER);
+    if ((cursor.entry >> JSON_TAPE_TYPE_SHIFT) & JSON_TAPE_INLINE_NUMBER)
+    {
+        u64 bits = tape_entry_payload(cursor.entry) << 8;
+        f64 number;
+        MemoryCopy(&number, &bits, sizeof(f64));
+        return number;
+    }
+
+    return cursor.tape->numbers[tape_entry_payload(cursor.entry)];
+}
+
+String json_cursor_get_string(JsonCursor cursor)
+{
+    Assert(json_cursor_type(cursor) == JSON_STRING);
+    return tape_string(cursor.tape->string_pool, cursor.entry);
+}
+
+size_t json_cursor_array_get_length(JsonCursor cursor)
+{
+    isize run = cursor_run(cursor, JSON_ARRAY);
+    Assert(run >= 0);
+    return run >= 0 ? tape_header_count(cursor.tape->entries[run]) : 0;
+}
+
+size_t json_cursor_object_get_num_keys(JsonCursor cursor)
+{
+    isize run = cursor_run(cursor, JSON_OBJECT);
+    Assert(run >= 0);
+    return run >= 0 ? tape_header_count(cursor.tape->entries[run]) : 0;
+}
+
+JsonCursor json_cursor_array_get_index(JsonCursor cursor, size_t index)
+{
+    isize run = cursor_run(cursor, JSON_ARRAY);
+    if (run < 0 || index >= (size_t)tape_header_count(cursor.tape->entries[run])) return {};
+
+    return make_cursor(cursor.tape, cursor_children(cursor, run)[index]);
+}
+
+JsonCursor json_cursor_object_get_key(JsonCursor cursor, const char *key)
+{
+    return json_cursor_object_get_key(cursor, String::from_cstr(key));
+}
+
+JsonCursor json_cursor_object_get_key(JsonCursor cursor, String key)
+{
+    isize run = cursor_run(cursor, JSON_OBJECT);
+    if (run < 0) return {};
+
+    isize member = tape_find_member(cursor.tape, run, key);
+    if (member < 0) return {};
+
+    return make_cursor(cursor.tape, cursor_children(cursor, run)[2 * member + 1]);
+}
+
+String json_cursor_object_key_at(JsonCursor cursor, size_t index)
+{
+    isize run = cursor_run(cursor, JSON_OBJECT);
+    Assert(run >= 0 && index < (size_t)tape_header_count(cursor.tape->entries[run]));
+
+    return tape_key(cursor.tape, cursor_children(cursor, run), index);
+}
+
+JsonCursor json_cursor_object_value_at(JsonCursor cursor, size_t index)
+{
+    isize run = cursor_run(cursor, JSON_OBJECT);
+    if (run < 0 || index >= (size_t)tape_header_count(cursor.tape->entries[run])) return {};
+
+    return make_cursor(cursor.tape, cursor_children(cursor, run)[2 * index + 1]);
+}
+
+JsonCursor json_cursor_query(JsonCursor cursor, const char *query)
+{
+    while (true)
+    {
+        JsonQueryStep step;
+        query = query_next_step(query, &step);
+
+        switch (step.kind)
+        {
+            case JSON_QUERY_KEY:
+            {
+                cursor = json_cursor_object_get_key(cursor, step.key);
+            } break;
+
+            case JSON_QUERY_INDEX:
+            {
+                cursor = json_cursor_array_get_index(cursor, step.index);
+            } break;
+
+            case JSON_QUERY_END: return cursor;
+            case JSON_QUERY_INVALID: return {};
+        }
+    }
+}
+
+void json_write_cursor(JsonCursor cursor, StringBuilder *builder)
+{
+    switch (json_cursor_type(cursor))
+    {
+        case JSON_NULL:
+        {
+            builder->append("null");
+        } break;
+
+        case JSON_BOOL:
+        {
+            builder->append(json_cursor_get_bool(cursor) ? String("true") : String("false"));
+        } break;
+
+        case JSON_NUMBER:
+        {
+            builder->append_format("{:f}", json_cursor_get_number(cursor));
+        } break;
+
+        case JSON_STRING:
+        {
+            builder->append('"');
+            escape_append(builder, json_cursor_get_string(cursor), ESCAPE_JSON);
+            builder->append('"');
+        } break;
+
+        case JSON_ARRAY:
+        {
+            size_t length = json_cursor_array_get_length(cursor);
+            builder->append('[');
+            for (size_t i = 0; i < length; ++i)
+            {
+                json_write_cursor(json_cursor_array_get_index(cursor, i), builder);
+                if (i != length - 1)
+                {
+                    builder->append(", ");
+                }
+            }
+            builder->append(']');
+        } break;
+
+        case JSON_OBJECT:
+        {
+            size_t num_keys = json_cursor_object_get_num_keys(cursor);
+            builder->append('{');
+            for (size_t i = 0; i < num_keys; ++i)
+            {
+                builder->append('"');
+                escape_append(builder, json_cursor_object_key_at(cursor, i), ESCAPE_JSON);
+                builder->append("\": ");
+                json_write_cursor(json_cursor_object_value_at(cursor, i), builder);
+
+                if (i != num_keys - 1)
+                {
+                    builder->append(", ");
+                }
+            }
+            builder->append('}');
+        } break;
+    }
+}
+
 }
@@ -3,6 +3,9 @@
 
 #include <xtb_core/string.h>
 #include <xtb_core/array.h>
+#include <xtb_core/hash_map.h>
+#include <xtb_core/string_builder.h>
+#include <xtb_core/arena.h>
 #include <stdbool.h>
 #include <stdio.h>
 
@@ -21,6 +24,7 @@ enum JsonType
 
 struct JsonValue;
 
+// Allocated at its final size by the parser
 using JsonArray = Array<JsonValue*>;
 
 struct JsonPair
@@ -30,6 +34,17 @@ struct JsonPair
     struct JsonPair *next;
 };
 
+// Objects with at least this many keys get a hash index, smaller ones are
+// faster to scan
+#define JSON_OBJECT_INDEX_MIN_KEYS 8
+
+struct JsonObject
+{
+    JsonPair *first;
+    // Key -> value of the first pair with that key, NULL for small objects
+    StringMap<JsonValue*> *index;
+};
+
 struct JsonValue
 {
     JsonType type;
@@ -38,14 +53,54 @@ struct JsonValue
         bool boolean;
         String string;
         JsonArray array;
-        JsonPair* object; // TODO: think if this should be pointer
+        JsonObject object;
     } as;
 };
 
 /****************************************************************
  * Parsing API
 ****************************************************************/
+enum JsonParseFlags
+{
+    // String values and keys without escapes point straight into the input instead
+    // of being copied, the input has to outlive the document and they aren't NUL
+    // terminated. Strings with escapes are still unescaped into the arena
+    JSON_PARSE_BORROW_STRINGS = 0b0001,
+};
+
+// Deeper nesting fails the parse instead of running the recursive parsers out of stack
+#define JSON_MAX_DEPTH 1024
+
+struct JsonParseError
+{
+    const char *message;
+    // Byte offset of the failure into the input. Line and column count from 1, the
+    // column in bytes. All three are 0 when the input couldn't be read at all
+    isize offset;
+    isize line;
+    isize column;
+};
+
+// Parses exactly input.len() bytes, no NUL terminator needed and nothing past the end
+// is read. Only whitespace may follow the value. On failure returns NULL and, if
+// `error` is given, fills it in. Large inputs get a SIMD structural index first when
+// the machine has AVX2 (json_index.h), the result is the same either way.
+//
+// Every value, pair, array buffer, object index and string of the document comes
+// from `arena` and goes away with it, there's no freeing a document on its own. A
+// failed parse rewinds the arena to where it was. Nothing in the document points
+// back into `input` unless it's parsed with JSON_PARSE_BORROW_STRINGS
+JsonValue *json_parse(String input, Arena *arena, Flags32 flags = 0, JsonParseError *error = NULL);
+
+// NUL-terminated versions. The one without an arena gives each document an arena of
+// its own that's never released, only use it for documents that live until exit
+JsonValue *json_parse(const char *input, Arena *arena, Flags32 flags = 0);
 JsonValue *json_parse(const char *input);
+
+// The file's text goes to a scratch arena and is gone by the time this returns. With
+// JSON_PARSE_BORROW_STRINGS it's read into `arena` instead, for the strings to point
+// into. The one without an arena is like json_parse(const char*)
+JsonValue *json_parse_file(String filepath, Arena *arena, Flags32 flags = 0, JsonParseError *error = NULL);
 JsonValue *json_parse_file(String filepath);
 
 /****************************************************************
@@ -91,9 +146,86 @@ bool json_array_contains_object(const JsonValue *value);
 /****************************************************************
  * Pretty printing
 ****************************************************************/
+// Appends the compact form of `value`, json_print_value writes the same text out
+void json_write_value(const JsonValue *value, StringBuilder *builder);
 void json_print_value(const JsonValue *value, FILE *stream);
 void json_pretty_print_value(const JsonValue *value, int indent, FILE *stream);
 
+/****************************************************************
+ * Tape
+ *
+ * A flat, read-only layout for documents that are parsed once and
+ * looked into a lot. Every value is one 64-bit entry, its JsonType
+ * in the top byte and a payload below it: 0 or 1 for a bool, most
+ * numbers themselves and the rest an index into `numbers`, where a
+ * string starts in `string_pool`, or for an array or object where
+ * its children start in `entries`. A container's children sit next
+ * to each other behind a header entry with their count, items for
+ * an array and key, value entry pairs for an object, so indexing an
+ * array is O(1) and nothing is reached through a per-value pointer.
+ * Objects with at least JSON_OBJECT_INDEX_MIN_KEYS keys also have
+ * an open-addressing hash table between the header and the members,
+ * where the first of several equal keys wins like in a JsonObject.
+ *
+ * The tape, its arrays and all of its strings are one allocation.
+ * Every key is pooled once however many objects have it.
+****************************************************************/
+struct JsonTape
+{
+    const u64 *entries;
+    const f64 *numbers;
+    // Every string is a u32 length followed by its bytes and a NUL
+    const u8 *string_pool;
+    isize entry_count;
+    isize number_count;
+    isize string_pool_size;
+
+    // The document's value, an entry like the ones in `entries`
+    u64 root;
+    // Size of the allocation the tape lives in, for json_tape_free
+    isize allocation_size;
+};
+
+// A value in a tape. Looking up a key or index that isn't there, or one in a value
+// of the wrong type, gives a cursor without a tape, and lookups on that give another
+// one, so they chain without checks in between
+struct JsonCursor
+{
+    const JsonTape *tape;
+    u64 entry;
+};
+
+// Same input and errors as json_parse, the grammar is checked by the same code.
+// Nothing in the tape points into `input`
+JsonTape *json_tape_parse(String input, Allocator *allocator, JsonParseError *error = NULL);
+JsonTape *json_tape_parse(String input, Arena *arena, JsonParseError *error = NULL);
+void json_tape_free(JsonTape *tape, Allocator *allocator);
+
+JsonCursor json_tape_root(const JsonTape *tape);
+bool json_cursor_is_valid(JsonCursor cursor);
+JsonType json_cursor_type(JsonCursor cursor);
+
+bool json_cursor_get_bool(JsonCursor cursor);
+f64 json_cursor_get_number(JsonCursor cursor);
+String json_cursor_get_string(JsonCursor cursor);
+
+size_t json_cursor_array_get_length(JsonCursor cursor);
+size_t json_cursor_object_get_num_keys(JsonCursor cursor);
+
+JsonCursor json_cursor_array_get_index(JsonCursor cursor, size_t index);
+JsonCursor json_cursor_object_get_key(JsonCursor cursor, const char *key);
+JsonCursor json_cursor_object_get_key(JsonCursor cursor, String key);
+
+// Members in document order, for walking an object
+String json_cursor_object_key_at(JsonCursor cursor, size_t index);
+JsonCursor json_cursor_object_value_at(JsonCursor cursor, size_t index);
+
+// Same syntax as json_query
+JsonCursor json_cursor_query(JsonCursor cursor, const char *query);
+
+// Same text as json_write_value writes for the equivalent JsonValue
+void json_write_cursor(JsonCursor cursor, StringBuilder *builder);
+
 }
 
 #endif // _XTB_JSON_H_
@@ -0,0 +1,305 @@
+#include "json_index.h"
+#include <xtb_core/contract.h>
+
+#include <string.h>
+
+#if ARCH_X64 || ARCH_X86
+#include <immintrin.h>
+#define JSON_INDEX_X86 1
+#else
+#define JSON_INDEX_X86 0
+#endif
+
+#if COMPILER_GCC || COMPILER_CLANG
+#define JSON_INDEX_TARGET(isa) __attribute__((target(isa)))
+#else
+#define JSON_INDEX_TARGET(isa)
+#endif
+
+namespace xtb
+{
+
+/****************************
+ * Internals
+ ***************************/
+// Bit i of each mask is byte i of the block
+struct JsonBlock
+{
+    u64 backslash;
+    u64 quote;
+    u64 whitespace;
+    u64 structural;
+};
+
+// Every kernel indexes [index->indexed, end) and returns how many positions it wrote.
+// `end` is a multiple of 64 unless it's the end of the input
+using JsonIndexBatchFn = isize (*)(JsonIndex *index, isize end);
+
+struct JsonIndexer
+{
+    const char *name;
+    JsonIndexBatchFn index_batch;
+};
+
+static const u64 g_json_even_bits = 0x5555555555555555ull;
+
+// Characters escaped by a backslash. A run of backslashes escapes every other
+// character in it, starting with the second, and the one after it when the run has
+// odd length. Adding the run's start to it carries to the end of the run, which lands
+// on the escaped character exactly when start and end have different parity
+static u64 json_escaped_mask(u64 backslash, u64 *prev_escaped)
+{
+    backslash &= ~*prev_escaped;
+    u64 follows_escape = (backslash << 1) | *prev_escaped;
+
+    u64 odd_sequence_starts = backslash & ~g_json_even_bits & ~follows_escape;
+    u64 sequences_starting_on_even_bits;
+    *prev_escaped = __builtin_add_overflow(odd_sequence_starts, backslash, &sequences_starting_on_even_bits);
+    u64 invert_mask = sequences_starting_on_even_bits << 1;
+
+    return (g_json_even_bits ^ invert_mask) & follows_escape;
+}
+
+// Bit i is the XOR of bits 0..i, every quote flips whether the bytes after it are
+// inside a string
+static u64 json_prefix_xor(u64 bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static inline isize json_index_block(JsonIndex *index, JsonBlock block, isize block_offset, isize count)
+{
+    u64 escaped = json_escaped_mask(block.backslash, &index->prev_escaped);
+    u64 quotes = block.quote & ~escaped;
+
+    // Includes the opening quote, not the closing one
+    u64 in_string = json_prefix_xor(quotes) ^ index->prev_in_string;
+    index->prev_in_string = (u64)((i64)in_string >> 63);
+
+    // Anything else outside a string belongs to a number or a literal, the first byte
+    // of each run is where that value starts
+    u64 scalar = ~(block.structural | block.whitespace | quotes | in_string);
+    u64 scalar_starts = scalar & ~((scalar << 1) | index->prev_scalar);
+    index->prev_scalar = scalar >> 63;
+
+    u64 structurals = (block.structural & ~in_string) | quotes | scalar_starts;
+
+    u32 base = (u32)(block_offset - index->batch_offset);
+    u32 *positions = index->positions;
+    while (structurals != 0)
+    {
+        positions[count++] = base + (u32)__builtin_ctzll(structurals);
+        structurals &= structurals - 1;
+    }
+
+    return count;
+}
+
+// The block at `offset`, or for the last one a copy in `tail` padded with whitespace,
+// which never shows up in the index
+static const u8 *json_index_block_data(JsonIndex *index, isize offset, isize end, u8 *tail)
+{
+    if (end - offset >= 64) return index->data + offset;
+
+    memset(tail, ' ', 64);
+    MemoryCopy(tail, index->data + offset, end - offset);
+    return tail;
+}
+
+/****************************
+ * Scalar indexer
+ ***************************/
+#define JSON_CLASS_WHITESPACE (1 << 0)
+#define JSON_CLASS_STRUCTURAL (1 << 1)
+#define JSON_CLASS_QUOTE      (1 << 2)
+#define JSON_CLASS_BACKSLASH  (1 << 3)
+
+struct JsonClassTable
+{
+    u8 classes[256];
+};
+
+static constexpr JsonClassTable json_make_class_table()
+{
+    JsonClassTable table = {};
+    table.classes[(u8)' '] = JSON_CLASS_WHITESPACE;
+    table.classes[(u8)'\t'] = JSON_CLASS_WHITESPACE;
+    table.classes[(u8)'\n'] = JSON_CLASS_WHITESPACE;
+    table.classes[(u8)'\r'] = JSON_CLASS_WHITESPACE;
+
+    const char structural[] = { '{', '}', '[', ']', ':', ',' };
+    for (char c : structural)
+    {
+        table.classes[(u8)c] = JSON_CLASS_STRUCTURAL;
+    }
+
+    table.classes[(u8)'"'] = JSON_CLASS_QUOTE;
+    table.classes[(u8)'\\'] = JSON_CLASS_BACKSLASH;
+    return table;
+}
+
+static constexpr JsonClassTable g_json_class_table = json_make_class_table();
+
+static JsonBlock json_classify_scalar(const u8 *data)
+{
+    JsonBlock block = {};
+    for (isize i = 0; i < 64; ++i)
+    {
+        u64 bit = 1ull << i;
+        u8 c = g_json_class_table.classes[data[i]];
+        if (c & JSON_CLASS_WHITESPACE) block.whitespace |= bit;
+        if (c & JSON_CLASS_STRUCTURAL) block.structural |= bit;
+        if (c & JSON_CLASS_QUOTE) block.quote |= bit;
+        if (c & JSON_CLASS_BACKSLASH) block.backslash |= bit;
+    }
+    return block;
+}
+
+static isize json_index_batch_scalar(JsonIndex *index, isize end)
+{
+    isize count = 0;
+    u8 tail[64];
+
+    for (isize i = index->indexed; i < end; i += 64)
+    {
+        const u8 *block = json_index_block_data(index, i, end, tail);
+        count = json_index_block(index, json_classify_scalar(block), i, count);
+    }
+
+    return count;
+}
+
+static const JsonIndexer g_json_indexer_scalar = {
+    "scalar", json_index_batch_scalar,
+};
+
+#if JSON_INDEX_X86
+#if COMPILER_GCC || COMPILER_CLANG
+/****************************
+ * AVX2 indexer
+ *
+ * Whitespace is a single shuffle: the four whitespace characters
+ * have different low nibbles, so a table indexed by the low nibble
+ * gives back the byte itself exactly when it's whitespace. The
+ * other slots hold 0xFF, which no byte that reaches them can equal
+ * since the shuffle zeroes bytes with the high bit set. Setting bit
+ * 5 folds [ into { and ] into }.
+ ***************************/
+JSON_INDEX_TARGET("avx2")
+static JsonBlock json_classify_avx2(const u8 *data)
+{
+    const __m256i whitespace_table = _mm256_setr_epi8(
+        ' ', -1, -1, -1, -1, -1, -1, -1, -1, '\t', '\n', -1, -1, '\r', -1, -1,
+        ' ', -1, -1, -1, -1, -1, -1, -1, -1, '\t', '\n', -1, -1, '\r', -1, -1);
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i open_brace = _mm256_set1_epi8('{');
+    const __m256i close_brace = _mm256_set1_epi8('}');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+
+    JsonBlock block = {};
+    for (i32 half = 0; half < 2; ++half)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + 32 * half));
+
+        __m256i whitespace = _mm256_cmpeq_epi8(_mm256_shuffle_epi8(whitespace_table, chunk), chunk);
+
+        __m256i folded = _mm256_or_si256(chunk, case_bit);
+        __m256i structural = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, open_brace), _mm256_cmpeq_epi8(folded, close_brace)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, comma), _mm256_cmpeq_epi8(chunk, colon)));
+
+        i32 shift = 32 * half;
+        block.whitespace |= (u64)(u32)_mm256_movemask_epi8(whitespace) << shift;
+        block.structural |= (u64)(u32)_mm256_movemask_epi8(structural) << shift;
+        block.quote |= (u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)) << shift;
+        block.backslash |= (u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash)) << shift;
+    }
+
+    return block;
+}
+
+JSON_INDEX_TARGET("avx2")
+static isize json_index_batch_avx2(JsonIndex *index, isize end)
+{
+    isize count = 0;
+    u8 tail[64];
+
+    for (isize i = index->indexed; i < end; i += 64)
+    {
+        const u8 *block = json_index_block_data(index, i, end, tail);
+        count = json_index_block(index, json_classify_avx2(block), i, count);
+    }
+
+    return count;
+}
+
+static const JsonIndexer g_json_indexer_avx2 = {
+    "avx2", json_index_batch_avx2,
+};
+#endif // COMPILER_GCC || COMPILER_CLANG
+#endif // JSON_INDEX_X86
+
+static const JsonIndexer *json_select_indexer(void)
+{
+#if JSON_INDEX_X86 && (COMPILER_GCC || COMPILER_CLANG)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &g_json_indexer_avx2;
+#endif
+    return &g_json_indexer_scalar;
+}
+
+static const JsonIndexer *json_indexer(void)
+{
+    static const JsonIndexer *indexer = json_select_indexer();
+    return indexer;
+}
+
+/****************************
+ * API
+ ***************************/
+void json_index_init(JsonIndex *index, const u8 *data, isize size, u32 *positions, isize capacity)
+{
+    Assert(capacity >= 64);
+
+    *index = {};
+    index->data = data;
+    index->size = size;
+    index->positions = positions;
+    index->capacity = capacity;
+}
+
+bool json_index_fill(JsonIndex *index)
+{
+    if (index->indexed >= index->size) return false;
+
+    // Every byte adds at most one position
+    isize batch_size = index->capacity & ~(isize)63;
+    isize end = Min(index->size, index->indexed + batch_size);
+
+    index->batch_offset = index->indexed;
+    index->count = json_indexer()->index_batch(index, end);
+    index->cursor = 0;
+    index->indexed = end;
+    return true;
+}
+
+const char *json_index_backend(void)
+{
+    return json_indexer()->name;
+}
+
+bool json_index_is_vectorized(void)
+{
+    return json_indexer() != &g_json_indexer_scalar;
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef _XTB_JSON_INDEX_H_
+#define _XTB_JSON_INDEX_H_
+
+#include <xtb_core/core.h>
+
+namespace xtb
+{
+
+/****************************************************************
+ * Structural index
+ *
+ * Stage 1 of the indexed parser, after simdjson (Langdale and
+ * Lemire, "Parsing Gigabytes of JSON per Second"). The input is
+ * classified 64 bytes at a time into bitmasks of quotes,
+ * backslashes, whitespace and {}[]:, from which plain integer
+ * operations find the escaped characters, the bytes inside strings
+ * and the first byte of every number and literal. What's left are
+ * the offsets stage 2 needs: every structural character outside a
+ * string, both quotes of every string and the start of every other
+ * value. Nothing is validated here, stage 2 checks the grammar.
+ *
+ * The input is indexed in batches of JSON_INDEX_BATCH_SIZE bytes
+ * as stage 2 asks for more, so the position buffer stays small no
+ * matter how big the document is.
+****************************************************************/
+#define JSON_INDEX_BATCH_SIZE Kilobytes(64)
+
+// json_parse only indexes inputs at least this big. Indexing pays off once there's
+// enough whitespace and string data to skip, and only with a vectorized stage 1,
+// below this the plain parsers are as fast
+#define JSON_INDEX_MIN_SIZE Kilobytes(64)
+
+struct JsonIndex
+{
+    const u8 *data;
+    isize size;
+    // Bytes indexed so far, a multiple of 64 until the last batch
+    isize indexed;
+
+    // Carried from one 64 byte block to the next
+    u64 prev_escaped;   // 1 when the block starts with an escaped character
+    u64 prev_in_string; // All ones when the block starts inside a string
+    u64 prev_scalar;    // 1 when the previous block ended inside a number or literal
+
+    // Offsets in the current batch, relative to batch_offset. The buffer needs at
+    // least 64 entries, a batch covers as many input bytes as it has entries
+    u32 *positions;
+    isize capacity;
+    isize count;
+    isize cursor;
+    isize batch_offset;
+};
+
+void json_index_init(JsonIndex *index, const u8 *data, isize size, u32 *positions, isize capacity);
+
+// Indexes the next batch, false once the whole input has been
+bool json_index_fill(JsonIndex *index);
+
+// Offset of the next structural character, -1 after the last one
+inline isize json_index_next(JsonIndex *index)
+{
+    while (index->cursor == index->count)
+    {
+        if (!json_index_fill(index)) return -1;
+    }
+
+    return index->batch_offset + index->positions[index->cursor++];
+}
+
+// "avx2" or "scalar", whichever classifies the blocks on this machine
+const char *json_index_backend(void);
+
+// False on machines that only have the scalar backend, which is slower than parsing
+// without an index
+bool json_index_is_vectorized(void);
+
+}
+
+#endif // _XTB_JSON_INDEX_H_
@@ -3,6 +3,7 @@
 #include "xtb_core/string.h"
 #include <xtb_core/thread_context.h>
 #include <xtb_core/contract.h>
+#include <xtb_core/utf8.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -86,6 +87,20 @@ String read_entire_file(Allocator *allocator, String filepath)
     }
 }
 
+String read_entire_text_file(Allocator *allocator, String filepath)
+{
+    String content = read_entire_file(allocator, filepath);
+    if (content.is_invalid()) return content;
+
+    if (!utf8_is_valid(content))
+    {
+        allocator_deallocate(allocator, content.data(), content.len() + 1, alignof(u8));
+        return String::invalid();
+    }
+
+    return content;
+}
+
 size_t write_file(FileHandle *handle, const u8 *buffer, size_t size)
 {
     return fwrite(buffer, sizeof(char), size, (FILE*)handle);
@@ -43,6 +43,8 @@ size_t get_file_size(FileHandle* handle);
 
 size_t read_file(FileHandle* handle, const u8* buffer, size_t size);
 String read_entire_file(Allocator* allcoator, String filepath);
+// Like read_entire_file, but also fails when the content isn't valid UTF-8
+String read_entire_text_file(Allocator* allocator, String filepath);
 
 size_t write_file(FileHandle* handle, const u8* buffer, size_t size);
 size_t write_entire_file(String filepath, const u8* buffer, size_t size);
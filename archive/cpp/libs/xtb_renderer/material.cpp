@@ -39,16 +39,14 @@ void material_set_defaults(Material *mat)
 
 i32 MaterialTemplate::find_param(const char *name) const
 {
-    for (i32 i = 0; i < this->params.size(); ++i)
-    {
-        const MaterialParamDesc *desc = &this->params[i];
-        if (desc->name == String::from_cstr(name))
-        {
-            return i;
-        }
-    }
+    StrId name_id = str_find(String::from_cstr(name));
+    return name_id.is_valid() ? this->find_param(name_id) : -1;
+}
 
-    return -1;
+i32 MaterialTemplate::find_param(StrId name) const
+{
+    const i32 *index = this->param_indices.get(name);
+    return index != NULL ? *index : -1;
 }
 
 /****************************************************************
@@ -169,6 +167,14 @@ MaterialTemplate MaterialTemplate::init(Allocator *allocator, ShaderProgram prog
     MaterialTemplate templ = {};
     templ.program = program;
     templ.params = material_params_from_program(allocator, program.id);;
+    templ.param_indices = HashMap<StrId, i32>::init_with_capacity(allocator, templ.params.size());
+    for (i32 i = 0; i < templ.params.size(); ++i)
+    {
+        // Keep the first of any duplicate names, like the linear search did
+        bool inserted = false;
+        i32 *index = templ.param_indices.get_or_insert(templ.params[i].name_id, &inserted);
+        if (inserted) *index = i;
+    }
     return templ;
 }
 
@@ -176,7 +182,7 @@ Material Material::create_from_template(Allocator* allocator, MaterialTemplate*
 {
     Material mat = {};
     mat.templ = templ;
-    mat.values = Array<MaterialParamValue>::init(allocator); // TODO: Make init_with_size
+    mat.values = MaterialParamValues::init(allocator); // TODO: Make init_with_size
     mat.values.resize(templ->params.size());
     material_set_defaults(&mat);
     return mat;
@@ -194,7 +200,7 @@ Material Material::copy(Allocator* allocator) const
 {
     Material res = {};
     res.templ = this->templ;
-    res.values = Array<MaterialParamValue>::init(allocator);
+    res.values = MaterialParamValues::init(allocator);
     for (isize i = 0; i < this->values.size(); ++i)
     {
         res.values.append(this->values[i]);
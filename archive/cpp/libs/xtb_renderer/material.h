@@ -6,6 +6,9 @@
 #include <xtb_core/core.h>
 #include <xtb_core/string.h>
 #include <xtb_core/array.h>
+#include <xtb_core/hash_map.h>
+#include <xtb_core/string_interner.h>
+#include <xtb_core/small_array.h>
 #include <xtbm/xtbm.h>
 
 namespace xtb
@@ -42,6 +45,8 @@ static inline const char *material_param_type_to_string(MaterialParamKind type)
 
 struct MaterialParamDesc
 {
+    StrId name_id;
+    // Interned, lives as long as the global interner
     String name;
     MaterialParamKind kind;
     i32 uniform_location;
@@ -52,10 +57,13 @@ struct MaterialTemplate
 {
     ShaderProgram program;
     Array<MaterialParamDesc> params;
+    // Parameter name -> index into `params`
+    HashMap<StrId, i32> param_indices;
 
     static MaterialTemplate init(Allocator *allocator, ShaderProgram program);
 
     i32 find_param(const char *name) const;
+    i32 find_param(StrId name) const;
 };
 
 struct MaterialParamValue
@@ -73,10 +81,13 @@ struct MaterialParamValue
     } as;
 };
 
+// Most shaders take a handful of parameters, keep those inside the material
+using MaterialParamValues = SmallArray<MaterialParamValue, 4>;
+
 struct Material
 {
     MaterialTemplate *templ;
-    Array<MaterialParamValue> values;
+    MaterialParamValues values;
 
     u32 textures[8];
 
@@ -54,8 +54,10 @@ Array<MaterialParamDesc> material_params_from_program(Allocator *allocator, Shad
 
             if (uniform_is_material_param(param_name))
             {
+                StrId name_id = str_intern(param_name);
                 MaterialParamDesc param = {
-                    .name = param_name.copy(allocator),
+                    .name_id = name_id,
+                    .name = str_id_string(name_id),
                     .kind = opengl_type_to_material_param_type(type),
                     .uniform_location = glGetUniformLocation(program, (GLchar*)uniform_name),
                     .array_size = count,
@@ -163,7 +163,10 @@ Renderer::Renderer(f32 width, f32 height)
 {
     this->persistent_arena = arena_new(Kilobytes(4));
     this->mesh_cache.arena = arena_new(Kilobytes(4));
+    arena_set_name(this->persistent_arena, "renderer persistent");
+    arena_set_name(this->mesh_cache.arena, "renderer mesh cache");
     this->mesh_cache.models = Array<ModelEntry>::init(&this->mesh_cache.arena->allocator);
+    this->mesh_cache.model_indices = HashMap<StrId, isize>::init(&this->mesh_cache.arena->allocator);
 
     this->shaders.test = create_shader_program("test", test_vertex_source, test_fragment_source);
     this->shaders.polyline = create_shader_program("polyline", polyline_2d_instanced_vertex_source, test_fragment_source);
@@ -183,6 +186,7 @@ Renderer::Renderer(f32 width, f32 height)
     init_default_textured_material(this);
 
     this->textures = Array<TextureEntry>::init(&this->persistent_arena->allocator);
+    this->texture_indices = HashMap<StrId, isize>::init(&this->persistent_arena->allocator);
 }
 
 void Renderer::deinit()
@@ -193,15 +197,15 @@ void Renderer::deinit()
 
 isize Renderer::find_model(String name) const
 {
-    for (isize i = 0; i < this->mesh_cache.models.size(); ++i)
-    {
-        if (this->mesh_cache.models[i].name == name)
-        {
-            return i;
-        }
-    }
+    // A name that was never interned can't have been loaded
+    StrId name_id = str_find(name);
+    return name_id.is_valid() ? this->find_model(name_id) : -1;
+}
 
-    return -1;
+isize Renderer::find_model(StrId name) const
+{
+    const isize *index = this->mesh_cache.model_indices.get(name);
+    return index != NULL ? *index : -1;
 }
 
 isize Renderer::load_model(String name, String path)
@@ -215,12 +219,16 @@ isize Renderer::load_model(String name, String path)
         mesh_upload(meshes[i], &gpu_meshes[i]);
     }
 
+    StrId name_id = str_intern(name);
     this->mesh_cache.models.append(ModelEntry{
-        .name = name.copy(&this->mesh_cache.arena->allocator),
+        .name_id = name_id,
+        .name = str_id_string(name_id),
         .meshes = gpu_meshes,
     });
 
-    return this->mesh_cache.models.size() - 1;
+    isize index = this->mesh_cache.models.size() - 1;
+    this->mesh_cache.model_indices.put(name_id, index);
+    return index;
 }
 
 bool Renderer::model_loaded(String name)
@@ -244,15 +252,14 @@ isize Renderer::ensure_model(String name, String path)
 
 isize Renderer::find_texture(String name) const
 {
-    for (isize i = 0; i < this->textures.size(); ++i)
-    {
-        if (this->textures[i].name == name)
-        {
-            return i;
-        }
-    }
+    StrId name_id = str_find(name);
+    return name_id.is_valid() ? this->find_texture(name_id) : -1;
+}
 
-    return -1;
+isize Renderer::find_texture(StrId name) const
+{
+    const isize *index = this->texture_indices.get(name);
+    return index != NULL ? *index : -1;
 }
 
 isize Renderer::load_texture(String name, String path)
@@ -279,12 +286,16 @@ isize Renderer::load_texture(String name, String path)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
+    StrId name_id = str_intern(name);
     this->textures.append(TextureEntry{
-        .name = name.copy(&this->mesh_cache.arena->allocator),
+        .name_id = name_id,
+        .name = str_id_string(name_id),
         .id = tex_id,
     });
 
-    return this->textures.size() - 1;
+    isize index = this->textures.size() - 1;
+    this->texture_indices.put(name_id, index);
+    return index;
 }
 
 bool Renderer::texture_loaded(String name)
@@ -25,12 +25,16 @@ struct GpuMesh
 
 struct ModelEntry
 {
+    StrId name_id;
+    // Interned, lives as long as the global interner
     String name;
     Array<GpuMesh> meshes;
 };
 
 struct TextureEntry
 {
+    StrId name_id;
+    // Interned, lives as long as the global interner
     String name;
     u32 id;
 };
@@ -43,6 +47,8 @@ struct GeometryCache
     GpuMesh *cube;
 
     Array<ModelEntry> models;
+    // Model name -> index into `models`
+    HashMap<StrId, isize> model_indices;
 };
 
 struct ShaderRegistry
@@ -93,6 +99,8 @@ struct Renderer
     ShaderRegistry shaders{};
 
     Array<TextureEntry> textures{};
+    // Texture name -> index into `textures`
+    HashMap<StrId, isize> texture_indices{};
 
     PolylineRenderData polyline_render_data{};
 
@@ -111,11 +119,13 @@ struct Renderer
     Renderer(f32 width, f32 height);
 
     isize find_model(String name) const;
+    isize find_model(StrId name) const;
     isize load_model(String name, String path);
     bool model_loaded(String name);
     isize ensure_model(String name, String path);
 
     isize find_texture(String name) const;
+    isize find_texture(StrId name) const;
     isize load_texture(String name, String path);
     bool texture_loaded(String name);
 
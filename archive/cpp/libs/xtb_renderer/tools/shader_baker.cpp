@@ -1,4 +1,5 @@
 #include <xtb_core/string.h>
+#include <xtb_core/escape.h>
 #include <xtb_os/os.h>
 #include <xtb_core/thread_context.h>
 #include <xtb_core/core.h>
@@ -30,18 +31,18 @@ void append_shader_source(StringBuf& builder, String ident, String source)
     String prologue = String::format(allocator, "const char *%s = \"\"\n", ident.data());
     builder.append(prologue);
 
-    StringList lines = source.split_by_lines(allocator);
-
-    IterateList(&lines)
+    bool first_line = true;
+    for (String line : source.lines())
     {
-        builder.append("   \"");
-        builder.append(it->string);
-        builder.append("\\n\"");
-
-        if (it->next)
+        if (!first_line)
         {
             builder.append('\n');
         }
+        first_line = false;
+
+        builder.append("   \"");
+        escape_append(builder, line, ESCAPE_C);
+        builder.append("\\n\"");
     }
 
     builder.append(";\n\n");